@@ -1,12 +1,19 @@
 #version 450 core
 
-layout(location = 1) uniform sampler2D u_Texture;
+layout(binding = 0) uniform sampler2DArray u_Texture;
 
 layout(location = 0) out vec4 o_Color;
 
-in vec2 v_UvCoords;
+in vec3 v_TexCoords;
+in float v_Light;
+flat in float v_AlphaCutoff;
 
 void main()
 {
-    o_Color = texture(u_Texture, v_UvCoords);
+    o_Color = texture(u_Texture, v_TexCoords);
+    if (o_Color.a < v_AlphaCutoff)
+    {
+        discard;
+    }
+    o_Color.rgb *= v_Light;
 }
@@ -1,14 +1,43 @@
 #version 450 core
 
-layout(location = 0) uniform mat4 u_ViewProjection;
+layout(std140, binding = 0) uniform FrameConstants
+{
+    mat4 u_ViewProjection;
+};
+
+struct DrawConstants
+{
+    vec4 origin;
+};
+
+layout(std430, binding = 1) readonly buffer DrawConstantsBuffer
+{
+    DrawConstants u_Draws[];
+};
 
 layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec2 a_UvCoords;
+layout(location = 1) in uint a_TexCoords;
+layout(location = 2) in uint a_DrawIndex;
+layout(location = 3) in uint a_Light;
+
+out vec3 v_TexCoords;
+out float v_Light;
+flat out float v_AlphaCutoff;
 
-out vec2 v_UvCoords;
+// Every light level is 80% as bright as the one above it.
+float GetBrightness(float level)
+{
+    return mix(0.05, 1.0, pow(0.8, 15.0 - level));
+}
 
 void main()
 {
-    v_UvCoords = a_UvCoords;
-    gl_Position = u_ViewProjection * vec4(a_Position, 1.0);
+    v_TexCoords = vec3(a_TexCoords & 0xFFu, (a_TexCoords >> 8) & 0xFFu, (a_TexCoords >> 16) & 0x7FFFu);
+    v_AlphaCutoff = (a_TexCoords >> 31) != 0u ? 0.5 : 0.0;
+    // Levels have four fractional bits from the smooth lighting, and every
+    // step of ambient occlusion darkens by a fifth.
+    float level = float(max(a_Light & 0xFFu, (a_Light >> 8) & 0xFFu)) / 16.0;
+    float occlusion = float(a_Light >> 16);
+    v_Light = GetBrightness(level) * (0.4 + 0.2 * occlusion);
+    gl_Position = u_ViewProjection * vec4(u_Draws[a_DrawIndex].origin.xyz + a_Position, 1.0);
 }
@@ -0,0 +1,18 @@
+#version 450 core
+
+layout(binding = 0) uniform sampler2DArray u_Texture;
+
+layout(location = 0) out vec4 o_Color;
+
+in vec3 v_TexCoords;
+in vec4 v_Color;
+
+void main()
+{
+    o_Color = texture(u_Texture, v_TexCoords);
+    if (o_Color.a < 0.5)
+    {
+        discard;
+    }
+    o_Color *= v_Color;
+}
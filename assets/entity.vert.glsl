@@ -0,0 +1,36 @@
+#version 450 core
+
+layout(std140, binding = 0) uniform FrameConstants
+{
+    mat4 u_ViewProjection;
+};
+
+layout(location = 0) uniform float u_Interpolation;
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec2 a_TexCoords;
+layout(location = 2) in float a_Shade;
+// Per instance: the position with the yaw in w at the previous and current
+// tick, the scale, the texture layer and the tint.
+layout(location = 3) in vec4 a_PreviousTransform;
+layout(location = 4) in vec4 a_Transform;
+layout(location = 5) in vec3 a_Scale;
+layout(location = 6) in uint a_Layer;
+layout(location = 7) in vec4 a_Tint;
+
+out vec3 v_TexCoords;
+out vec4 v_Color;
+
+void main()
+{
+    vec4 transform = mix(a_PreviousTransform, a_Transform, u_Interpolation);
+    float c = cos(transform.w);
+    float s = sin(transform.w);
+
+    vec3 position = a_Position * a_Scale;
+    position.xz = vec2(position.x * c - position.z * s, position.x * s + position.z * c);
+
+    v_TexCoords = vec3(a_TexCoords, float(a_Layer));
+    v_Color = vec4(a_Tint.rgb * a_Shade, a_Tint.a);
+    gl_Position = u_ViewProjection * vec4(transform.xyz + position, 1.0);
+}
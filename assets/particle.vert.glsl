@@ -0,0 +1,43 @@
+#version 450 core
+
+layout(std140, binding = 0) uniform FrameConstants
+{
+    mat4 u_ViewProjection;
+};
+
+struct Particle
+{
+    vec4 position;
+    vec4 velocity;
+    uint layer;
+    uint tint;
+    float gravity;
+    uint seed;
+};
+
+layout(std430, binding = 1) readonly buffer Particles
+{
+    Particle u_Particles[];
+};
+
+layout(location = 0) uniform vec4 u_CameraRight;
+layout(location = 1) uniform vec4 u_CameraUp;
+
+out vec3 v_TexCoords;
+out vec4 v_Tint;
+
+void main()
+{
+    Particle particle = u_Particles[gl_InstanceID];
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    // Shrinks away over its last half second instead of popping.
+    float size = particle.velocity.w * clamp(particle.position.w * 2.0, 0.0, 1.0);
+    vec3 offset = (u_CameraRight.xyz * (corner.x - 0.5) + u_CameraUp.xyz * (corner.y - 0.5)) * size;
+
+    // A random sixteenth of the tile, one cell of a 4x4 grid, so they look like fragments of it.
+    vec2 cell = vec2(particle.seed & 3u, (particle.seed >> 2) & 3u) * 0.25;
+    v_TexCoords = vec3(cell + corner * 0.25, float(particle.layer));
+    v_Tint = unpackUnorm4x8(particle.tint);
+    gl_Position = u_ViewProjection * vec4(particle.position.xyz + offset, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+struct Particle
+{
+    vec4 position;
+    vec4 velocity;
+    uint layer;
+    uint tint;
+    float gravity;
+    uint seed;
+};
+
+layout(std430, binding = 1) readonly buffer Particles
+{
+    Particle u_Particles[];
+};
+
+layout(std430, binding = 2) writeonly buffer CompactedParticles
+{
+    Particle u_CompactedParticles[];
+};
+
+layout(std430, binding = 3) buffer Counters
+{
+    uint u_ElementCount;
+    uint u_AliveCount;
+    uint u_FirstIndex;
+    int u_BaseVertex;
+    uint u_BaseInstance;
+    uint u_GroupCountX;
+    uint u_GroupCountY;
+    uint u_GroupCountZ;
+    uint u_CompactedCount;
+};
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= u_AliveCount || u_Particles[index].position.w <= 0.0)
+    {
+        return;
+    }
+
+    u_CompactedParticles[atomicAdd(u_CompactedCount, 1u)] = u_Particles[index];
+}
@@ -0,0 +1,34 @@
+#version 450 core
+
+layout(local_size_x = 1) in;
+
+layout(std430, binding = 3) buffer Counters
+{
+    // Read by glDrawElementsIndirect().
+    uint u_ElementCount;
+    uint u_AliveCount;
+    uint u_FirstIndex;
+    int u_BaseVertex;
+    uint u_BaseInstance;
+    // Read by glDispatchComputeIndirect().
+    uint u_GroupCountX;
+    uint u_GroupCountY;
+    uint u_GroupCountZ;
+    uint u_CompactedCount;
+};
+
+layout(location = 0) uniform uint u_MaxParticleCount;
+// After compacting, the survivors become the alive particles.
+layout(location = 1) uniform uint u_UseCompacted;
+
+void main()
+{
+    uint count = u_UseCompacted != 0u ? u_CompactedCount : min(u_AliveCount, u_MaxParticleCount);
+
+    u_ElementCount = 6u;
+    u_AliveCount = count;
+    u_GroupCountX = (count + 63u) / 64u;
+    u_GroupCountY = 1u;
+    u_GroupCountZ = 1u;
+    u_CompactedCount = 0u;
+}
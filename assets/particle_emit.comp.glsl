@@ -0,0 +1,104 @@
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+struct Particle
+{
+    // xyz is the position, w the remaining life in seconds.
+    vec4 position;
+    // xyz is the velocity, w the size.
+    vec4 velocity;
+    uint layer;
+    uint tint;
+    float gravity;
+    uint seed;
+};
+
+struct Emitter
+{
+    vec4 position;
+    vec4 velocity;
+    uint count;
+    uint layer;
+    uint tint;
+    float life;
+    float size;
+    float gravity;
+    uint seed;
+    float padding;
+};
+
+layout(std430, binding = 1) writeonly buffer Particles
+{
+    Particle u_Particles[];
+};
+
+layout(std430, binding = 3) buffer Counters
+{
+    uint u_ElementCount;
+    uint u_AliveCount;
+};
+
+layout(std430, binding = 4) readonly buffer Emitters
+{
+    Emitter u_Emitters[];
+};
+
+layout(location = 0) uniform uint u_EmitterCount;
+layout(location = 1) uniform uint u_MaxParticleCount;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state >> 8) / 16777216.0;
+}
+
+void main()
+{
+    // Emitters are few, so finding the one this invocation belongs to by
+    // walking them is cheap.
+    uint index = gl_GlobalInvocationID.x;
+    uint emitterIndex = 0;
+    while (emitterIndex < u_EmitterCount && index >= u_Emitters[emitterIndex].count)
+    {
+        index -= u_Emitters[emitterIndex].count;
+        emitterIndex++;
+    }
+    if (emitterIndex == u_EmitterCount)
+    {
+        return;
+    }
+
+    // Slots past the end are counted but never written; the count pass
+    // clamps the total.
+    uint slot = atomicAdd(u_AliveCount, 1u);
+    if (slot >= u_MaxParticleCount)
+    {
+        return;
+    }
+
+    Emitter emitter = u_Emitters[emitterIndex];
+    uint state = Hash(emitter.seed ^ Hash(index));
+
+    vec3 offset = vec3(Random(state), Random(state), Random(state)) * 2.0 - 1.0;
+    vec3 direction = vec3(Random(state), Random(state), Random(state)) * 2.0 - 1.0;
+
+    Particle particle;
+    particle.position = vec4(emitter.position.xyz + offset * emitter.position.w, emitter.life * (0.5 + 0.5 * Random(state)));
+    particle.velocity = vec4(emitter.velocity.xyz + direction * emitter.velocity.w, emitter.size);
+    particle.layer = emitter.layer;
+    particle.tint = emitter.tint;
+    particle.gravity = emitter.gravity;
+    particle.seed = Hash(state);
+    u_Particles[slot] = particle;
+}
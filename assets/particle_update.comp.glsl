@@ -0,0 +1,75 @@
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+struct Particle
+{
+    vec4 position;
+    vec4 velocity;
+    uint layer;
+    uint tint;
+    float gravity;
+    uint seed;
+};
+
+layout(std430, binding = 1) buffer Particles
+{
+    Particle u_Particles[];
+};
+
+layout(std430, binding = 3) readonly buffer Counters
+{
+    uint u_ElementCount;
+    uint u_AliveCount;
+};
+
+// 1 for every solid block in a cube around the camera.
+layout(binding = 1) uniform usampler3D u_Occupancy;
+
+layout(location = 0) uniform float u_Delta;
+layout(location = 1) uniform vec4 u_OccupancyOrigin;
+
+bool IsSolid(vec3 position)
+{
+    ivec3 coords = ivec3(floor(position)) - ivec3(u_OccupancyOrigin.xyz);
+    if (any(lessThan(coords, ivec3(0))) || any(greaterThanEqual(coords, textureSize(u_Occupancy, 0))))
+    {
+        return false;
+    }
+    return texelFetch(u_Occupancy, coords, 0).r != 0u;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= u_AliveCount)
+    {
+        return;
+    }
+
+    Particle particle = u_Particles[index];
+    particle.position.w -= u_Delta;
+    particle.velocity.y += particle.gravity * u_Delta;
+
+    // One axis at a time, so particles bounce off the face they hit and
+    // slide along the others.
+    for (int axis = 0; axis < 3; axis++)
+    {
+        vec3 next = particle.position.xyz;
+        next[axis] += particle.velocity[axis] * u_Delta;
+        if (IsSolid(next))
+        {
+            if (axis == 1 && particle.velocity.y < 0.0)
+            {
+                particle.velocity.xz *= 0.7;
+            }
+            particle.velocity[axis] *= -0.3;
+        }
+        else
+        {
+            particle.position[axis] = next[axis];
+        }
+    }
+
+    u_Particles[index] = particle;
+}
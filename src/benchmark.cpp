@@ -0,0 +1,614 @@
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "timer.h"
+#include "world.h"
+#include "chunk_mesher.h"
+#include "physics.h"
+#include "entities.h"
+#include "chunk_codec.h"
+#include "thread_pool.h"
+#include "texture_cache.h"
+#include "benchmark.h"
+
+namespace Krafter
+{
+
+struct Samples
+{
+    void Add(double milliseconds)
+    {
+        total += milliseconds;
+        max = glm::max(max, milliseconds);
+        count++;
+    }
+
+    void Print(const char* name) const
+    {
+        std::cout << "[BENCH] " << name << ": avg " << total / count << " ms, max " << max
+            << " ms over " << count << " runs" << std::endl;
+    }
+
+    double total = 0.0;
+    double max = 0.0;
+    uint32_t count = 0;
+};
+
+bool Benchmark::Run(const std::string& name)
+{
+    if (name == "lighting")
+    {
+        RunLighting();
+        return true;
+    }
+    else if (name == "meshing")
+    {
+        RunMeshing();
+        return true;
+    }
+    else if (name == "lod")
+    {
+        RunLod();
+        return true;
+    }
+    else if (name == "raycast")
+    {
+        RunRaycast();
+        return true;
+    }
+    else if (name == "physics")
+    {
+        RunPhysics();
+        return true;
+    }
+    else if (name == "entities")
+    {
+        RunEntities();
+        return true;
+    }
+    else if (name == "encoding")
+    {
+        RunEncoding();
+        return true;
+    }
+    else if (name == "texture")
+    {
+        RunTexture();
+        return true;
+    }
+
+    std::cerr << "[BENCH] Unknown benchmark: " << name << std::endl;
+    return false;
+}
+
+void Benchmark::RunLighting()
+{
+    constexpr uint32_t ITERATIONS = 100;
+
+    Samples fullChunk;
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(glm::ivec2(0));
+
+        Timer timer;
+        LightEngine::LightChunk(*chunk);
+        fullChunk.Add(timer.GetElapsedMilliseconds());
+    }
+    fullChunk.Print("Light full chunk");
+
+    World::Init();
+    World* world = World::Get();
+
+    // Enough neighbors that no edit is cut short by the edge of the world.
+    Timer loadTimer;
+    for (int32_t x = -2; x <= 2; x++)
+    {
+        for (int32_t z = -2; z <= 2; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+    std::cout << "[BENCH] Load and stitch 25 chunks: " << loadTimer.GetElapsedMilliseconds() << " ms" << std::endl;
+
+    struct Edit
+    {
+        const char* name;
+        glm::ivec3 position;
+        Block block;
+    };
+
+    // The world is a grid of spheres: the corners of a chunk are open sky
+    // down to the bottom, and the spheres touch at the middle of the chunk.
+    const Edit edits[] = {
+        { "Shade open sky column", glm::ivec3(0, 200, 0), Block::DIRT },
+        { "Break sphere side", glm::ivec3(1, 200, 8), Block::AIR },
+        { "Place lamp between spheres", glm::ivec3(8, 128, 8), Block::LAMP }
+    };
+
+    for (const Edit& edit : edits)
+    {
+        const Block original = world->GetBlock(edit.position);
+
+        Samples apply;
+        Samples revert;
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+        {
+            Timer timer;
+            world->SetBlock(edit.position, edit.block);
+            apply.Add(timer.GetElapsedMilliseconds());
+
+            timer.Reset();
+            world->SetBlock(edit.position, original);
+            revert.Add(timer.GetElapsedMilliseconds());
+        }
+
+        std::cout << "[BENCH] " << edit.name << ":" << std::endl;
+        apply.Print("  Apply");
+        revert.Print("  Revert");
+    }
+
+    World::Deinit();
+}
+
+void Benchmark::RunMeshing()
+{
+    constexpr uint32_t ITERATIONS = 100;
+
+    BlockAtlas::LoadAtlases();
+    World::Init();
+    World* world = World::Get();
+    for (int32_t x = -1; x <= 1; x++)
+    {
+        for (int32_t z = -1; z <= 1; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+
+    const Chunk& chunk = *world->GetChunk(glm::ivec2(0));
+
+    Samples snapshot;
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        Timer timer;
+        ChunkSnapshot taken = ChunkSnapshot(*world, chunk);
+        snapshot.Add(timer.GetElapsedMilliseconds());
+    }
+    snapshot.Print("Snapshot chunk");
+
+    const ChunkSnapshot copy = ChunkSnapshot(*world, chunk);
+    for (uint32_t lod = 0; lod < ChunkMesher::LOD_COUNT; lod++)
+    {
+        Samples build;
+        size_t vertexCount = 0;
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+        {
+            Timer timer;
+            ChunkMeshData data = ChunkMesher::Build(copy, lod);
+            build.Add(timer.GetElapsedMilliseconds());
+            vertexCount = data.vertices.size();
+        }
+
+        std::cout << "[BENCH] LOD " << lod << ": " << vertexCount << " vertices" << std::endl;
+        build.Print("  Build");
+    }
+
+    // Water fills the open corners of the chunk below the water level.
+    const ChunkMeshData data = ChunkMesher::Build(copy, 0);
+    const glm::vec3 viewPosition = glm::vec3(0.0f, Chunk::WATER_LEVEL + 8.0f, 0.0f);
+
+    Samples fullSort;
+    Samples resort;
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        TranslucentOrder order;
+
+        Timer timer;
+        ChunkMesher::SortTranslucentFaces(data.translucentFaces, viewPosition, order);
+        fullSort.Add(timer.GetElapsedMilliseconds());
+
+        timer.Reset();
+        ChunkMesher::SortTranslucentFaces(data.translucentFaces, viewPosition + glm::vec3(1.0f, 0.0f, 0.0f), order);
+        resort.Add(timer.GetElapsedMilliseconds());
+    }
+
+    std::cout << "[BENCH] " << data.translucentFaces.centers.size() << " translucent faces:" << std::endl;
+    fullSort.Print("  Sort");
+    resort.Print("  Resort after moving a block");
+
+    World::Deinit();
+}
+
+void Benchmark::RunLod()
+{
+    BlockAtlas::LoadAtlases();
+    World::Init();
+    World* world = World::Get();
+    for (int32_t x = -1; x <= 1; x++)
+    {
+        for (int32_t z = -1; z <= 1; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+
+    // Every chunk is generated the same, so one surrounded by others stands
+    // for all of them.
+    const ChunkSnapshot snapshot = ChunkSnapshot(*world, *world->GetChunk(glm::ivec2(0)));
+    std::array<uint64_t, ChunkMesher::LOD_COUNT> triangleCounts;
+    for (uint32_t lod = 0; lod < ChunkMesher::LOD_COUNT; lod++)
+    {
+        triangleCounts[lod] = ChunkMesher::Build(snapshot, lod).elements.size() / 3;
+        std::cout << "[BENCH] LOD " << lod << ": " << triangleCounts[lod] << " triangles per chunk" << std::endl;
+    }
+
+    // The chunks loaded around a camera in the middle of a chunk, at the
+    // level the renderer would pick with the default LOD distance.
+    for (int32_t viewDistance : { 8, 16, 32 })
+    {
+        uint32_t chunkCount = 0;
+        uint64_t fullTriangleCount = 0;
+        uint64_t lodTriangleCount = 0;
+        for (int32_t x = -viewDistance; x <= viewDistance; x++)
+        {
+            for (int32_t z = -viewDistance; z <= viewDistance; z++)
+            {
+                if (x * x + z * z > viewDistance * viewDistance)
+                {
+                    continue;
+                }
+
+                const uint32_t lod = ChunkMesher::GetLod(glm::length(glm::vec2(x, z)), ChunkMesher::DEFAULT_LOD_DISTANCE);
+                chunkCount++;
+                fullTriangleCount += triangleCounts[0];
+                lodTriangleCount += triangleCounts[lod];
+            }
+        }
+
+        std::cout << "[BENCH] View distance " << viewDistance << ", " << chunkCount << " chunks: "
+            << fullTriangleCount << " triangles at full detail, " << lodTriangleCount << " with LOD" << std::endl;
+    }
+
+    World::Deinit();
+}
+
+void Benchmark::RunRaycast()
+{
+    constexpr uint32_t RAY_COUNT = 1 << 20;
+    constexpr float MAX_DISTANCE = 64.0f;
+
+    World::Init();
+    World* world = World::Get();
+    for (int32_t x = -4; x <= 4; x++)
+    {
+        for (int32_t z = -4; z <= 4; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+
+    // The rays are made up front so only the raycasts are timed.
+    struct Ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+    };
+
+    std::mt19937 random = std::mt19937(35);
+    std::uniform_real_distribution<float> unit = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+    std::vector<Ray> rays = std::vector<Ray>(RAY_COUNT);
+    for (Ray& ray : rays)
+    {
+        // Rays start in the open, like they would from a player.
+        do
+        {
+            ray.origin = glm::vec3(unit(random) * 16.0f, (unit(random) + 1.0f) * 128.0f, unit(random) * 16.0f);
+        }
+        while (BlockInfo::GetInfoOf(world->GetBlock(glm::ivec3(glm::floor(ray.origin)))).isSolid);
+
+        do
+        {
+            ray.direction = glm::vec3(unit(random), unit(random), unit(random));
+        }
+        while (glm::dot(ray.direction, ray.direction) < 0.01f);
+        ray.direction = glm::normalize(ray.direction);
+    }
+
+    uint32_t hitCount = 0;
+    double totalDistance = 0.0;
+
+    Timer timer;
+    for (const Ray& ray : rays)
+    {
+        if (std::optional<RaycastHit> hit = world->Raycast(ray.origin, ray.direction, MAX_DISTANCE))
+        {
+            hitCount++;
+            totalDistance += hit->distance;
+        }
+    }
+    double seconds = timer.GetElapsedSeconds();
+
+    std::cout << "[BENCH] Raycast: " << RAY_COUNT << " rays of up to " << MAX_DISTANCE << " blocks in "
+        << seconds * 1000.0 << " ms, " << RAY_COUNT / seconds / 1e6 << " million rays/s" << std::endl;
+    std::cout << "[BENCH]   " << hitCount << " hits, " << totalDistance / glm::max(hitCount, 1u)
+        << " blocks away on average" << std::endl;
+
+    World::Deinit();
+}
+
+void Benchmark::RunPhysics()
+{
+    constexpr uint32_t BODY_COUNT = 1000;
+    constexpr uint32_t TICK_COUNT = 600;
+    constexpr float SPEED = 4.3f;
+
+    World::Init();
+    World* world = World::Get();
+    for (int32_t x = -4; x <= 4; x++)
+    {
+        for (int32_t z = -4; z <= 4; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+
+    std::mt19937 random = std::mt19937(36);
+    std::uniform_real_distribution<float> unit = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+    auto isInsideBlock = [&](const PhysicsBody& body)
+    {
+        glm::ivec3 min = glm::ivec3(glm::floor(body.position - glm::vec3(body.size.x, 0.0f, body.size.z) * 0.5f));
+        glm::ivec3 max = glm::ivec3(glm::floor(body.position + glm::vec3(body.size.x * 0.5f, body.size.y, body.size.z * 0.5f)));
+        for (int32_t x = min.x; x <= max.x; x++)
+        {
+            for (int32_t y = min.y; y <= max.y; y++)
+            {
+                for (int32_t z = min.z; z <= max.z; z++)
+                {
+                    if (world->IsSolid(glm::ivec3(x, y, z)) && Physics::IsOverlapping(body, glm::ivec3(x, y, z)))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    };
+
+    // Bodies drop into the world anywhere in the open and wander around,
+    // turning every second and jumping now and then.
+    std::vector<PhysicsBody> bodies = std::vector<PhysicsBody>(BODY_COUNT);
+    for (PhysicsBody& body : bodies)
+    {
+        body.size = glm::vec3(0.6f, 1.8f, 0.6f);
+        do
+        {
+            body.position = glm::vec3(unit(random) * 64.0f, (unit(random) + 1.0f) * 120.0f, unit(random) * 64.0f);
+        }
+        while (isInsideBlock(body));
+    }
+
+    Samples ticks;
+    for (uint32_t tick = 0; tick < TICK_COUNT; tick++)
+    {
+        Timer timer;
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            PhysicsBody& body = bodies[i];
+            if ((tick + i) % 60 == 0)
+            {
+                float angle = unit(random) * glm::radians(180.0f);
+                body.velocity.x = glm::cos(angle) * SPEED;
+                body.velocity.z = glm::sin(angle) * SPEED;
+                if (body.isOnGround && unit(random) > 0.5f)
+                {
+                    body.velocity.y = 8.5f;
+                }
+            }
+
+            Physics::Step(*world, body, Physics::TIMESTEP);
+        }
+        ticks.Add(timer.GetElapsedMilliseconds());
+    }
+
+    uint32_t groundedCount = 0;
+    uint32_t stuckCount = 0;
+    for (const PhysicsBody& body : bodies)
+    {
+        groundedCount += body.isOnGround;
+        stuckCount += isInsideBlock(body);
+    }
+
+    std::cout << "[BENCH] Physics: " << BODY_COUNT << " bodies for " << TICK_COUNT << " ticks" << std::endl;
+    ticks.Print("  Tick");
+    std::cout << "[BENCH]   " << ticks.total / ticks.count / BODY_COUNT * 1000.0 << " us per body, "
+        << groundedCount << " on the ground, " << stuckCount << " inside blocks at the end" << std::endl;
+
+    World::Deinit();
+}
+
+void Benchmark::RunEntities()
+{
+    constexpr uint32_t ENTITY_COUNTS[] = { 10000, 50000 };
+    constexpr uint32_t TICK_COUNT = 300;
+
+    ThreadPool::Init();
+    World::Init();
+    World* world = World::Get();
+    for (int32_t x = -4; x <= 4; x++)
+    {
+        for (int32_t z = -4; z <= 4; z++)
+        {
+            world->LoadChunk(glm::ivec2(x, z));
+        }
+    }
+    BlockAtlas::LoadAtlases();
+
+    std::cout << "[BENCH] Entities on " << ThreadPool::Get()->GetThreadCount() << " workers and this thread" << std::endl;
+
+    for (uint32_t entityCount : ENTITY_COUNTS)
+    {
+        EntityRegistry registry;
+        uint32_t spawned = EntitySystems::SpawnMobsAround(registry, *world, glm::vec3(0.0f), 64.0f, entityCount, 38);
+
+        // Items make a second archetype that physics runs over too.
+        for (uint32_t i = 0; i < entityCount / 10; i++)
+        {
+            EntitySystems::SpawnItem(registry, glm::vec3((float)(i % 100) - 50.0f, 200.0f, (float)(i / 100) - 50.0f), Block::DIRT);
+        }
+
+        Samples wander;
+        Samples physics;
+        Samples collect;
+        EntityInstances instances;
+        for (uint32_t tick = 0; tick < TICK_COUNT; tick++)
+        {
+            Timer timer;
+            EntitySystems::UpdateOrientation(registry, Physics::TIMESTEP);
+            EntitySystems::UpdateWander(registry, Physics::TIMESTEP);
+            wander.Add(timer.GetElapsedMilliseconds());
+
+            timer.Reset();
+            EntitySystems::UpdatePhysics(registry, *world, Physics::TIMESTEP);
+            physics.Add(timer.GetElapsedMilliseconds());
+
+            timer.Reset();
+            EntitySystems::CollectInstances(registry, instances);
+            collect.Add(timer.GetElapsedMilliseconds());
+        }
+
+        std::cout << "[BENCH] " << registry.GetCount() << " entities (" << spawned << " mobs) in "
+            << registry.GetArchetypeCount() << " archetypes for " << TICK_COUNT << " ticks" << std::endl;
+        wander.Print("  Wander");
+        physics.Print("  Physics");
+        collect.Print("  Collect instances");
+        std::cout << "[BENCH]   " << (wander.total + physics.total + collect.total) / TICK_COUNT
+            << " ms per tick of " << Physics::TIMESTEP * 1000.0f << " ms" << std::endl;
+    }
+
+    World::Deinit();
+    ThreadPool::Deinit();
+}
+
+void Benchmark::RunEncoding()
+{
+    constexpr uint32_t ITERATIONS = 200;
+
+    // Generated terrain as it is sent, the same after a lot of building, and
+    // noise that no encoding can do much with.
+    struct Case
+    {
+        const char* name;
+        uint32_t editCount;
+    };
+    const Case cases[] = {
+        { "Generated", 0 },
+        { "Edited", 2000 },
+        { "Noise", Chunk::VOLUME }
+    };
+
+    std::mt19937 random = std::mt19937(42);
+    for (const Case& test : cases)
+    {
+        std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(glm::ivec2(0));
+        for (uint32_t i = 0; i < test.editCount; i++)
+        {
+            glm::ivec3 coords = glm::ivec3(random() % Chunk::WIDTH, random() % Chunk::HEIGHT, random() % Chunk::WIDTH);
+            chunk->SetBlock(coords, (Block)(random() % BLOCK_COUNT));
+        }
+
+        std::vector<uint8_t> sections;
+        ChunkCodec::EncodeSections(chunk->GetBlocks(), sections);
+
+        Samples encode;
+        Samples decode;
+        std::vector<uint8_t> data;
+        std::vector<Block> blocks = std::vector<Block>(Chunk::VOLUME);
+        bool isIntact = true;
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+        {
+            data.clear();
+
+            Timer timer;
+            ChunkCodec::Encode(chunk->GetBlocks(), data);
+            encode.Add(timer.GetElapsedMilliseconds());
+
+            timer.Reset();
+            isIntact &= ChunkCodec::Decode(data.data(), data.size(), blocks.data());
+            decode.Add(timer.GetElapsedMilliseconds());
+        }
+        isIntact &= std::equal(blocks.begin(), blocks.end(), chunk->GetBlocks());
+
+        std::cout << "[BENCH] " << test.name << " chunk: " << Chunk::VOLUME << " B raw, " << sections.size()
+            << " B in sections, " << data.size() << " B compressed" << (isIntact ? "" : ", DECODED WRONG") << std::endl;
+        encode.Print("  Encode");
+        decode.Print("  Decode");
+        std::cout << "[BENCH]   " << Chunk::VOLUME / (encode.total / encode.count) / 1000.0 << " MB/s encoded, "
+            << Chunk::VOLUME / (decode.total / decode.count) / 1000.0 << " MB/s decoded" << std::endl;
+    }
+}
+
+void Benchmark::RunTexture()
+{
+    constexpr uint32_t ITERATIONS = 5;
+    constexpr const char* ATLAS_PATH = "assets/texture.png";
+
+    const auto getByteSize = [](const TextureArrayImage& image)
+    {
+        size_t byteSize = 0;
+        for (uint32_t level = 0; level < image.GetMipLevelCount(); level++)
+        {
+            byteSize += image.GetMipLevel(level).byteSize;
+        }
+        return byteSize;
+    };
+
+    // Without the cache the atlas is decoded and mipmapped every launch, as
+    // RGBA8; a miss also compresses it, a hit only reads the result back.
+    // The upload itself needs a context and is left out.
+    const uint64_t sourceStamp = TextureArrayImage::GetSourceStamp(ATLAS_PATH);
+    const std::string cachePath = (std::filesystem::temp_directory_path() / "krafter_bench_texture.bin").string();
+
+    Samples uncompressed;
+    Samples miss;
+    Samples hit;
+    size_t uncompressedByteSize = 0;
+    size_t compressedByteSize = 0;
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        Timer timer;
+        std::optional<TextureArrayImage> image = TextureArrayImage::LoadFromAtlas(ATLAS_PATH, BlockAtlas::TILES_PER_ROW,
+            false, sourceStamp);
+        uncompressed.Add(timer.GetElapsedMilliseconds());
+        if (!image)
+        {
+            std::cerr << "[BENCH] Could not load " << ATLAS_PATH << std::endl;
+            return;
+        }
+        uncompressedByteSize = getByteSize(*image);
+
+        timer.Reset();
+        image = TextureArrayImage::LoadFromAtlas(ATLAS_PATH, BlockAtlas::TILES_PER_ROW, true, sourceStamp);
+        image->SaveToCache(cachePath);
+        miss.Add(timer.GetElapsedMilliseconds());
+        compressedByteSize = getByteSize(*image);
+
+        timer.Reset();
+        image = TextureArrayImage::LoadFromCache(cachePath, sourceStamp);
+        hit.Add(timer.GetElapsedMilliseconds());
+    }
+
+    std::error_code error;
+    std::filesystem::remove(cachePath, error);
+
+    uncompressed.Print("Decode and mipmap atlas, RGBA8");
+    miss.Print("Cache miss, BC7");
+    hit.Print("Cache hit, BC7");
+    std::cout << "[BENCH] Texture memory: " << uncompressedByteSize / 1024.0 << " KB RGBA8, "
+        << compressedByteSize / 1024.0 << " KB BC7" << std::endl;
+}
+
+} // namespace Krafter
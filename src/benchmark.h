@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+namespace Krafter
+{
+
+// Measures the engine's hot paths without opening a window. They are run
+// with `krafter --bench <name>` and print their results.
+class Benchmark
+{
+public:
+    // Returns false if there is no benchmark with the given name.
+    static bool Run(const std::string& name);
+
+private:
+    static void RunLighting();
+    static void RunMeshing();
+    // The triangles drawn at a few view distances, with every chunk at full
+    // detail and with the levels of detail.
+    static void RunLod();
+    static void RunRaycast();
+    static void RunPhysics();
+    static void RunEntities();
+    static void RunEncoding();
+    static void RunTexture();
+};
+
+} // namespace Krafter
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
 
 #include "block.h"
 
@@ -9,15 +10,39 @@ namespace Krafter
 void BlockAtlas::LoadAtlases()
 {
     _blockAtlases[Block::DIRT] = {
-        .top = glm::vec2(0.0f / 16.0f, 0.0f / 16.0f),
-        .side = glm::vec2(0.0f / 16.0f, 0.0f / 16.0f),
-        .bottom = glm::vec2(0.0f / 16.0f, 0.0f / 16.0f)
+        .top = GetLayer(0, 0),
+        .side = GetLayer(0, 0),
+        .bottom = GetLayer(0, 0)
     };
 
     _blockAtlases[Block::GRASS] = {
-        .top = glm::vec2(2.0f / 16.0f, 0.0f / 16.0f),
-        .side = glm::vec2(1.0f / 16.0f, 0.0f / 16.0f),
-        .bottom = glm::vec2(0.0f / 16.0f, 0.0f / 16.0f)
+        .top = GetLayer(2, 0),
+        .side = GetLayer(1, 0),
+        .bottom = GetLayer(0, 0)
+    };
+
+    _blockAtlases[Block::LAMP] = {
+        .top = GetLayer(3, 0),
+        .side = GetLayer(3, 0),
+        .bottom = GetLayer(3, 0)
+    };
+
+    _blockAtlases[Block::WATER] = {
+        .top = GetLayer(4, 0),
+        .side = GetLayer(4, 0),
+        .bottom = GetLayer(4, 0)
+    };
+
+    _blockAtlases[Block::GLASS] = {
+        .top = GetLayer(5, 0),
+        .side = GetLayer(5, 0),
+        .bottom = GetLayer(5, 0)
+    };
+
+    _blockAtlases[Block::LEAVES] = {
+        .top = GetLayer(6, 0),
+        .side = GetLayer(6, 0),
+        .bottom = GetLayer(6, 0)
     };
 }
 
@@ -35,9 +60,10 @@ const BlockAtlas& BlockAtlas::GetAtlasOf(Block block)
 }
 
 Chunk::Chunk(const glm::ivec2& position)
-    : _position(position)
+    : _position(position), _revision(0), _blockRevision(0)
 {
     _blocks = new Block[WIDTH * WIDTH * HEIGHT];
+    _light = new uint8_t[WIDTH * WIDTH * HEIGHT]();
 
     for (int32_t y = HEIGHT - 1; y >= 0; y--)
     {
@@ -47,7 +73,11 @@ Chunk::Chunk(const glm::ivec2& position)
             {
                 if ((x - 8.5f) * (x - 8.5f) + (y % 16 - 8.5f) * (y % 16 - 8.5f) + (z - 8.5f) * (z - 8.5f) <= 8.5f * 8.5f)
                 {
-                    if (y + 1 >= HEIGHT || GetBlock(glm::ivec3(x, y + 1, z)) == Block::AIR)
+                    if (y >= HEIGHT - 16)
+                    {
+                        SetBlock(glm::ivec3(x, y, z), Block::LEAVES);
+                    }
+                    else if (y + 1 >= HEIGHT || GetBlock(glm::ivec3(x, y + 1, z)) == Block::AIR)
                     {
                         SetBlock(glm::ivec3(x, y, z), Block::GRASS);
                     }
@@ -56,6 +86,10 @@ Chunk::Chunk(const glm::ivec2& position)
                         SetBlock(glm::ivec3(x, y, z), Block::DIRT);
                     }
                 }
+                else if (y < WATER_LEVEL)
+                {
+                    SetBlock(glm::ivec3(x, y, z), Block::WATER);
+                }
                 else
                 {
                     SetBlock(glm::ivec3(x, y, z), Block::AIR);
@@ -67,17 +101,27 @@ Chunk::Chunk(const glm::ivec2& position)
 
 Chunk::~Chunk()
 {
+    delete[] _light;
     delete[] _blocks;
 }
 
 const Block& Chunk::GetBlock(const glm::ivec3& coords) const
 {
-    return _blocks[(coords.y * WIDTH * WIDTH) + (coords.z * WIDTH) + coords.x];
+    return _blocks[GetIndex(coords)];
 }
 
 void Chunk::SetBlock(const glm::ivec3& coords, Block value)
 {
-    _blocks[(coords.y * WIDTH * WIDTH) + (coords.z * WIDTH) + coords.x] = value;
+    _blocks[GetIndex(coords)] = value;
+    _revision++;
+    _blockRevision++;
+}
+
+void Chunk::SetBlocks(const Block* blocks)
+{
+    std::memcpy(_blocks, blocks, VOLUME * sizeof(Block));
+    _revision++;
+    _blockRevision++;
 }
 
 } // namespace Krafter
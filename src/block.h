@@ -1,30 +1,105 @@
 #pragma once
 
 #include <unordered_map>
+#include <cstdint>
 
 #include "glm/glm.hpp"
 
 namespace Krafter
 {
 
-enum class Block
+enum class Block : uint8_t
 {
     AIR,
     DIRT,
-    GRASS
+    GRASS,
+    LAMP,
+    WATER,
+    GLASS,
+    LEAVES
 };
 
+static constexpr size_t BLOCK_COUNT = 7;
+
+// Which pass draws a block. Cutout blocks are either fully opaque or fully
+// clear per texel and are alpha tested in the opaque pass, translucent ones
+// are blended and have to be drawn back to front.
+enum class RenderLayer : uint8_t
+{
+    OPAQUE,
+    CUTOUT,
+    TRANSLUCENT
+};
+
+struct BlockInfo
+{
+    static const BlockInfo& GetInfoOf(Block block);
+
+    // Whether the face between a block and its neighbor can be seen.
+    static bool IsFaceVisible(Block block, Block neighbor);
+
+    // Opaque blocks stop light, solid ones stop rays and movement.
+    bool isOpaque;
+    bool isSolid;
+    uint8_t lightEmission;
+    RenderLayer layer;
+};
+
+inline const BlockInfo& BlockInfo::GetInfoOf(Block block)
+{
+    static constexpr BlockInfo infos[] = {
+        { .isOpaque = false, .isSolid = false, .lightEmission = 0, .layer = RenderLayer::OPAQUE },        // AIR
+        { .isOpaque = true, .isSolid = true, .lightEmission = 0, .layer = RenderLayer::OPAQUE },          // DIRT
+        { .isOpaque = true, .isSolid = true, .lightEmission = 0, .layer = RenderLayer::OPAQUE },          // GRASS
+        { .isOpaque = true, .isSolid = true, .lightEmission = 15, .layer = RenderLayer::OPAQUE },         // LAMP
+        { .isOpaque = false, .isSolid = false, .lightEmission = 0, .layer = RenderLayer::TRANSLUCENT },   // WATER
+        { .isOpaque = false, .isSolid = true, .lightEmission = 0, .layer = RenderLayer::TRANSLUCENT },    // GLASS
+        { .isOpaque = false, .isSolid = true, .lightEmission = 0, .layer = RenderLayer::CUTOUT }          // LEAVES
+    };
+    return infos[(size_t)block];
+}
+
+inline bool BlockInfo::IsFaceVisible(Block block, Block neighbor)
+{
+    // Transparent blocks hide the faces between blocks of their own kind.
+    return neighbor == Block::AIR || (!GetInfoOf(neighbor).isOpaque && neighbor != block);
+}
+
+enum class BlockFace
+{
+    FRONT,
+    BACK,
+    LEFT,
+    RIGHT,
+    BOTTOM,
+    TOP
+};
+
+// The direction a face of a block looks towards.
+constexpr glm::ivec3 GetNormalOf(BlockFace face)
+{
+    constexpr glm::ivec3 normals[] = {
+        glm::ivec3(-1, 0, 0), glm::ivec3(1, 0, 0),
+        glm::ivec3(0, 0, -1), glm::ivec3(0, 0, 1),
+        glm::ivec3(0, -1, 0), glm::ivec3(0, 1, 0)
+    };
+    return normals[(size_t)face];
+}
+
 class BlockAtlas
 {
 public:
     static void LoadAtlases();
     static const BlockAtlas& GetAtlasOf(Block block);
 
-    static constexpr float STEP = 1.0f / 16.0f;
+    static constexpr uint32_t TILES_PER_ROW = 16;
+    static constexpr uint32_t LAYER_COUNT = TILES_PER_ROW * TILES_PER_ROW;
 
-    glm::vec2 top;
-    glm::vec2 side;
-    glm::vec2 bottom;
+    static constexpr uint32_t GetLayer(uint32_t x, uint32_t y) { return y * TILES_PER_ROW + x; }
+
+    uint32_t top;
+    uint32_t side;
+    uint32_t bottom;
 
 private:
     inline static std::unordered_map<Block, BlockAtlas> _blockAtlases;
@@ -35,18 +110,64 @@ class Chunk
 public:
     static constexpr uint32_t WIDTH = 16;
     static constexpr uint32_t HEIGHT = 256;
+    static constexpr uint8_t MAX_LIGHT = 15;
+    static constexpr int32_t WATER_LEVEL = 24;
+    static constexpr uint32_t VOLUME = WIDTH * WIDTH * HEIGHT;
 
     Chunk(const glm::ivec2& position);
     ~Chunk();
 
+    Chunk(const Chunk&) = delete;
+    Chunk& operator=(const Chunk&) = delete;
+
     inline const glm::ivec2& GetPosition() const { return _position; }
 
     const Block& GetBlock(const glm::ivec3& coords) const;
     void SetBlock(const glm::ivec3& coords, Block value);
 
+    // All VOLUME blocks, y major, then z, then x.
+    inline const Block* GetBlocks() const { return _blocks; }
+    void SetBlocks(const Block* blocks);
+
+    inline uint8_t GetSkyLight(const glm::ivec3& coords) const { return _light[GetIndex(coords)] >> 4; }
+    inline uint8_t GetBlockLight(const glm::ivec3& coords) const { return _light[GetIndex(coords)] & 0xF; }
+    inline uint8_t GetPackedLight(const glm::ivec3& coords) const { return _light[GetIndex(coords)]; }
+
+    inline void SetSkyLight(const glm::ivec3& coords, uint8_t value)
+    {
+        uint8_t& light = _light[GetIndex(coords)];
+        light = (light & 0x0F) | (value << 4);
+        _revision++;
+    }
+
+    inline void SetBlockLight(const glm::ivec3& coords, uint8_t value)
+    {
+        uint8_t& light = _light[GetIndex(coords)];
+        light = (light & 0xF0) | value;
+        _revision++;
+    }
+
+    // Increases whenever the blocks or the light of the chunk change, so
+    // meshes built from an older state can tell they are stale.
+    inline uint32_t GetRevision() const { return _revision; }
+    // Like the revision, but only for changes to the blocks themselves.
+    inline uint32_t GetBlockRevision() const { return _blockRevision; }
+    inline void MarkChanged() { _revision++; }
+
 private:
+    static inline size_t GetIndex(const glm::ivec3& coords)
+    {
+        return (coords.y * WIDTH * WIDTH) + (coords.z * WIDTH) + coords.x;
+    }
+
     glm::ivec2 _position;
     Block* _blocks;
+
+    // Sky light in the high nibble, block light in the low one.
+    uint8_t* _light;
+
+    uint32_t _revision;
+    uint32_t _blockRevision;
 };
 
 } // namespace Krafter
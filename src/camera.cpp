@@ -10,9 +10,9 @@ namespace Krafter
 
 Camera::Camera(const glm::vec3& position, float fov)
     : _speed(50.0f), _sensitivity(50.0f),
-    _isControlled(true), _isSpaceReleased(true),
-    _position(position), _fov(fov),
-    _pitch(0.0f), _yaw(0.0f), _lastCursorPosition(Window::Get()->GetCursorPosition())
+    _isControlled(true), _isSpaceReleased(true), _isFlying(true),
+    _position(position), _direction(1.0f, 0.0f, 0.0f), _fov(fov),
+    _pitch(0.0f), _yaw(0.0f), _hasCursorPosition(false), _lastCursorPosition(0.0f)
 {
     UpdateProjection();
 }
@@ -33,7 +33,14 @@ void Camera::Update()
     {
         float delta = Game::Get()->GetDelta();
 
+        // The cursor is first read here rather than when the camera is made,
+        // which is on the render thread.
         glm::vec2 cursorPosition = Window::Get()->GetCursorPosition();
+        if (!_hasCursorPosition)
+        {
+            _lastCursorPosition = cursorPosition;
+            _hasCursorPosition = true;
+        }
         glm::vec2 cursorOffset = cursorPosition - _lastCursorPosition;
         _lastCursorPosition = cursorPosition;
 
@@ -50,36 +57,47 @@ void Camera::Update()
             _yaw -= glm::radians(360.0f);
         }
 
-        glm::vec3 direction = glm::normalize(glm::vec3(
-            glm::cos(_yaw) * glm::cos(_pitch),
-            glm::sin(_pitch),
-            glm::sin(_yaw) * glm::cos(_pitch)
-        ));
-        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-        glm::vec3 right = glm::normalize(glm::cross(direction, up));
+        _direction = GetDirectionOf(_yaw, _pitch);
+        glm::vec3 right = glm::normalize(glm::cross(_direction, glm::vec3(0.0f, 1.0f, 0.0f)));
 
-        if (Window::Get()->IsKeyDown(Key::W))
+        if (_isFlying)
         {
-            _position += direction * _speed * delta;
-        }
-        if (Window::Get()->IsKeyDown(Key::S))
-        {
-            _position -= direction * _speed * delta;
-        }
-        if (Window::Get()->IsKeyDown(Key::D))
-        {
-            _position += right * _speed * delta;
-        }
-        if (Window::Get()->IsKeyDown(Key::A))
-        {
-            _position -= right * _speed * delta;
+            if (Window::Get()->IsKeyDown(Key::W))
+            {
+                _position += _direction * _speed * delta;
+            }
+            if (Window::Get()->IsKeyDown(Key::S))
+            {
+                _position -= _direction * _speed * delta;
+            }
+            if (Window::Get()->IsKeyDown(Key::D))
+            {
+                _position += right * _speed * delta;
+            }
+            if (Window::Get()->IsKeyDown(Key::A))
+            {
+                _position -= right * _speed * delta;
+            }
         }
 
-        glm::mat4 transform = glm::lookAt(_position, _position + direction, up);
-        _viewProjection = _projection * transform;
+        UpdateViewProjection();
     }
 }
 
+void Camera::SetPosition(const glm::vec3& position)
+{
+    _position = position;
+    UpdateViewProjection();
+}
+
+void Camera::SetOrientation(float yaw, float pitch)
+{
+    _yaw = yaw;
+    _pitch = glm::clamp(pitch, glm::radians(-89.99f), glm::radians(89.99f));
+    _direction = GetDirectionOf(_yaw, _pitch);
+    UpdateViewProjection();
+}
+
 void Camera::UpdateProjection()
 {
     const glm::uvec2& size = Window::Get()->GetSize();
@@ -99,6 +117,12 @@ void Camera::RenderImGui()
     ImGui::Text("Position: %.2f, %.2f, %.2f", _position.x, _position.y, _position.z);
 }
 
+void Camera::UpdateViewProjection()
+{
+    glm::mat4 transform = glm::lookAt(_position, _position + _direction, glm::vec3(0.0f, 1.0f, 0.0f));
+    _viewProjection = _projection * transform;
+}
+
 void Camera::ToggleState()
 {
     if (_isControlled)
@@ -8,28 +8,50 @@ namespace Krafter
 class Camera
 {
 public:
+    // Yaw turns from +x towards +z and pitch up from the horizon, both in
+    // radians.
+    static inline glm::vec3 GetDirectionOf(float yaw, float pitch)
+    {
+        return glm::normalize(glm::vec3(glm::cos(yaw) * glm::cos(pitch), glm::sin(pitch), glm::sin(yaw) * glm::cos(pitch)));
+    }
+
     Camera(const glm::vec3& position, float fov);
 
+    // Turns the camera with the mouse and, while flying, moves it with the
+    // keyboard.
     void Update();
     void UpdateProjection();
     void RenderImGui();
 
+    inline bool IsControlled() const { return _isControlled; }
+    inline void SetFlying(bool isFlying) { _isFlying = isFlying; }
+    inline const glm::vec3& GetPosition() const { return _position; }
+    void SetPosition(const glm::vec3& position);
+    // For moving the camera along a path instead of with the mouse.
+    void SetOrientation(float yaw, float pitch);
+    inline const glm::vec3& GetDirection() const { return _direction; }
+    inline float GetYaw() const { return _yaw; }
+    inline float GetPitch() const { return _pitch; }
     inline const glm::mat4& GetViewProjection() const { return _viewProjection; }
 
 private:
     void ToggleState();
+    void UpdateViewProjection();
 
     float _speed;
     float _sensitivity;
 
     bool _isControlled;
     bool _isSpaceReleased;
+    bool _isFlying;
 
     glm::vec3 _position;
+    glm::vec3 _direction;
     float _fov;
 
     float _pitch;
     float _yaw;
+    bool _hasCursorPosition;
     glm::vec2 _lastCursorPosition;
 
     glm::mat4 _projection;
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cstring>
+
+#include "chunk_codec.h"
+
+namespace Krafter
+{
+
+// Matches are at least this long and at most this far back; the hash table
+// remembers the last position of every hashed run of MIN_MATCH bytes.
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t MAX_OFFSET = 0xFFFF;
+static constexpr uint32_t HASH_BITS = 12;
+
+static void WriteVarint(std::vector<uint8_t>& data, size_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+    {
+        data.push_back((uint8_t)(value | 0x80));
+    }
+    data.push_back((uint8_t)value);
+}
+
+static bool ReadVarint(const uint8_t* data, size_t size, size_t& offset, size_t& value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift <= 28; shift += 7)
+    {
+        if (offset == size)
+        {
+            return false;
+        }
+
+        const uint8_t byte = data[offset++];
+        value |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t HashBytes(const uint8_t* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(uint32_t));
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Indices are packed into 0, 1, 2, 4 or 8 bits, so that none of them
+// straddles a byte.
+static uint32_t GetBitsPerBlock(size_t paletteSize)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < paletteSize)
+    {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    return bits;
+}
+
+void ChunkCodec::Encode(const Block* blocks, std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> sections;
+    EncodeSections(blocks, sections);
+
+    WriteVarint(data, sections.size());
+    Compress(sections.data(), sections.size(), data);
+}
+
+bool ChunkCodec::Decode(const uint8_t* data, size_t size, Block* blocks)
+{
+    size_t offset = 0;
+    size_t sectionsSize;
+    if (!ReadVarint(data, size, offset, sectionsSize) || sectionsSize > MAX_SECTIONS_SIZE)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> sections;
+    sections.reserve(sectionsSize);
+    return Decompress(data + offset, size - offset, sections) && sections.size() == sectionsSize &&
+        DecodeSections(sections.data(), sections.size(), blocks);
+}
+
+// A mask of the sections that are present, then each of them as its
+// palette size, the palette, and the packed indices.
+void ChunkCodec::EncodeSections(const Block* blocks, std::vector<uint8_t>& data)
+{
+    const size_t maskOffset = data.size();
+    uint16_t mask = 0;
+    data.resize(data.size() + sizeof(uint16_t));
+
+    for (uint32_t section = 0; section < SECTION_COUNT; section++)
+    {
+        const Block* sectionBlocks = blocks + section * SECTION_VOLUME;
+
+        uint8_t indices[BLOCK_COUNT];
+        uint8_t palette[BLOCK_COUNT];
+        size_t paletteSize = 0;
+        std::fill(std::begin(indices), std::end(indices), 0xFF);
+        for (uint32_t i = 0; i < SECTION_VOLUME; i++)
+        {
+            uint8_t& index = indices[(size_t)sectionBlocks[i]];
+            if (index == 0xFF)
+            {
+                index = paletteSize;
+                palette[paletteSize++] = (uint8_t)sectionBlocks[i];
+            }
+        }
+
+        if (paletteSize == 1 && palette[0] == (uint8_t)Block::AIR)
+        {
+            continue;
+        }
+        mask |= 1 << section;
+
+        data.push_back(paletteSize);
+        data.insert(data.end(), palette, palette + paletteSize);
+
+        const uint32_t bits = GetBitsPerBlock(paletteSize);
+        if (bits == 0)
+        {
+            continue;
+        }
+
+        const uint32_t blocksPerByte = 8 / bits;
+        const size_t packedOffset = data.size();
+        data.resize(packedOffset + SECTION_VOLUME / blocksPerByte, 0);
+        uint8_t* packed = data.data() + packedOffset;
+        for (uint32_t i = 0; i < SECTION_VOLUME; i++)
+        {
+            packed[i / blocksPerByte] |= indices[(size_t)sectionBlocks[i]] << (i % blocksPerByte * bits);
+        }
+    }
+
+    std::memcpy(data.data() + maskOffset, &mask, sizeof(uint16_t));
+}
+
+bool ChunkCodec::DecodeSections(const uint8_t* data, size_t size, Block* blocks)
+{
+    if (size < sizeof(uint16_t))
+    {
+        return false;
+    }
+
+    uint16_t mask;
+    std::memcpy(&mask, data, sizeof(uint16_t));
+    size_t offset = sizeof(uint16_t);
+
+    for (uint32_t section = 0; section < SECTION_COUNT; section++)
+    {
+        Block* sectionBlocks = blocks + section * SECTION_VOLUME;
+        if (!(mask & (1 << section)))
+        {
+            std::fill(sectionBlocks, sectionBlocks + SECTION_VOLUME, Block::AIR);
+            continue;
+        }
+
+        if (offset == size)
+        {
+            return false;
+        }
+        const size_t paletteSize = data[offset++];
+        if (paletteSize == 0 || paletteSize > BLOCK_COUNT || size - offset < paletteSize)
+        {
+            return false;
+        }
+        const uint8_t* palette = data + offset;
+        offset += paletteSize;
+        for (size_t i = 0; i < paletteSize; i++)
+        {
+            if (palette[i] >= BLOCK_COUNT)
+            {
+                return false;
+            }
+        }
+
+        const uint32_t bits = GetBitsPerBlock(paletteSize);
+        if (bits == 0)
+        {
+            std::fill(sectionBlocks, sectionBlocks + SECTION_VOLUME, (Block)palette[0]);
+            continue;
+        }
+
+        const uint32_t blocksPerByte = 8 / bits;
+        const size_t packedSize = SECTION_VOLUME / blocksPerByte;
+        if (size - offset < packedSize)
+        {
+            return false;
+        }
+        const uint8_t* packed = data + offset;
+        offset += packedSize;
+
+        const uint8_t indexMask = (1 << bits) - 1;
+        for (uint32_t i = 0; i < SECTION_VOLUME; i++)
+        {
+            const uint8_t index = (packed[i / blocksPerByte] >> (i % blocksPerByte * bits)) & indexMask;
+            if (index >= paletteSize)
+            {
+                return false;
+            }
+            sectionBlocks[i] = (Block)palette[index];
+        }
+    }
+
+    return offset == size;
+}
+
+// A sequence of literal runs each followed by a match: the run's length,
+// its bytes, then the match length past MIN_MATCH and its 16-bit offset.
+// The last run has no match after it.
+void ChunkCodec::Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+{
+    std::vector<uint32_t> table = std::vector<uint32_t>(1 << HASH_BITS, UINT32_MAX);
+
+    size_t literalStart = 0;
+    size_t position = 0;
+    while (position + MIN_MATCH <= size)
+    {
+        const uint32_t hash = HashBytes(data + position);
+        const uint32_t candidate = table[hash];
+        table[hash] = position;
+
+        if (candidate == UINT32_MAX || position - candidate > MAX_OFFSET ||
+            std::memcmp(data + candidate, data + position, MIN_MATCH) != 0)
+        {
+            position++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (position + length < size && data[candidate + length] == data[position + length])
+        {
+            length++;
+        }
+
+        WriteVarint(compressed, position - literalStart);
+        compressed.insert(compressed.end(), data + literalStart, data + position);
+        WriteVarint(compressed, length - MIN_MATCH);
+        const uint16_t offset = position - candidate;
+        compressed.push_back(offset & 0xFF);
+        compressed.push_back(offset >> 8);
+
+        // Only the end of a match is hashed; long runs of the same bytes
+        // would otherwise cost as much as not matching them at all.
+        position += length;
+        if (position + MIN_MATCH <= size)
+        {
+            table[HashBytes(data + position - 1)] = position - 1;
+        }
+        literalStart = position;
+    }
+
+    WriteVarint(compressed, size - literalStart);
+    compressed.insert(compressed.end(), data + literalStart, data + size);
+}
+
+bool ChunkCodec::Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed)
+{
+    size_t offset = 0;
+    while (true)
+    {
+        size_t literalLength;
+        if (!ReadVarint(data, size, offset, literalLength) || size - offset < literalLength ||
+            decompressed.size() + literalLength > MAX_SECTIONS_SIZE)
+        {
+            return false;
+        }
+        decompressed.insert(decompressed.end(), data + offset, data + offset + literalLength);
+        offset += literalLength;
+
+        if (offset == size)
+        {
+            return true;
+        }
+
+        size_t matchLength;
+        if (!ReadVarint(data, size, offset, matchLength) || size - offset < 2)
+        {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        const size_t matchOffset = data[offset] | (data[offset + 1] << 8);
+        offset += 2;
+        if (matchOffset == 0 || matchOffset > decompressed.size() || decompressed.size() + matchLength > MAX_SECTIONS_SIZE)
+        {
+            return false;
+        }
+
+        // Matches may overlap what they produce, so they are copied a byte
+        // at a time.
+        const size_t start = decompressed.size() - matchOffset;
+        for (size_t i = 0; i < matchLength; i++)
+        {
+            decompressed.push_back(decompressed[start + i]);
+        }
+    }
+}
+
+} // namespace Krafter
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "block.h"
+
+namespace Krafter
+{
+
+// Turns the blocks of a chunk into bytes and back, for the network and the
+// save files alike.
+//
+// The chunk is split into sections of 16 blocks high. Sections of nothing
+// but air are left out; every other one lists the blocks it uses and stores
+// each of its blocks as an index into that palette, packed into as few bits
+// as the palette needs. Sections repeat a lot, so the result is then run
+// through a small LZ77 compressor.
+class ChunkCodec
+{
+public:
+    // Stored with saved chunks, which are regenerated if it does not match.
+    static constexpr uint8_t VERSION = 2;
+
+    static constexpr uint32_t SECTION_HEIGHT = 16;
+    static constexpr uint32_t SECTION_COUNT = Chunk::HEIGHT / SECTION_HEIGHT;
+    static constexpr uint32_t SECTION_VOLUME = Chunk::WIDTH * Chunk::WIDTH * SECTION_HEIGHT;
+
+    // Appends the encoded blocks to the data.
+    static void Encode(const Block* blocks, std::vector<uint8_t>& data);
+    // Fills all Chunk::VOLUME blocks; returns false if the data is malformed.
+    static bool Decode(const uint8_t* data, size_t size, Block* blocks);
+
+    // The two stages of Encode(), apart for measuring them.
+    static void EncodeSections(const Block* blocks, std::vector<uint8_t>& data);
+    static void Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+
+private:
+    // No section takes more than a palette of every block and a byte per
+    // block, which bounds what a decompressed chunk can claim to be.
+    static constexpr size_t MAX_SECTIONS_SIZE = sizeof(uint16_t) + SECTION_COUNT * (1 + BLOCK_COUNT + SECTION_VOLUME);
+
+    static bool DecodeSections(const uint8_t* data, size_t size, Block* blocks);
+    static bool Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed);
+};
+
+} // namespace Krafter
@@ -0,0 +1,354 @@
+#include <algorithm>
+
+#include "world.h"
+#include "chunk_mesher.h"
+
+namespace Krafter
+{
+
+struct FaceGeometry
+{
+    glm::ivec3 normal;
+    // The first corner of the face within its block and the directions
+    // towards the second and the fourth corner.
+    glm::ivec3 origin;
+    glm::ivec3 dx;
+    glm::ivec3 dy;
+};
+
+// Indexed by BlockFace.
+static constexpr FaceGeometry FACE_GEOMETRIES[] = {
+    { glm::ivec3(-1, 0, 0), glm::ivec3(0, 0, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 1, 0) },
+    { glm::ivec3(1, 0, 0), glm::ivec3(1, 0, 1), glm::ivec3(0, 0, -1), glm::ivec3(0, 1, 0) },
+    { glm::ivec3(0, 0, -1), glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 1, 0) },
+    { glm::ivec3(0, 0, 1), glm::ivec3(0, 0, 1), glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0) },
+    { glm::ivec3(0, -1, 0), glm::ivec3(1, 0, 0), glm::ivec3(0, 0, 1), glm::ivec3(-1, 0, 0) },
+    { glm::ivec3(0, 1, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1), glm::ivec3(1, 0, 0) }
+};
+
+// Where each corner of a face lies along its dx and dy.
+static constexpr glm::ivec2 CORNERS[] = {
+    glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(1, 1), glm::ivec2(0, 1)
+};
+
+ChunkSnapshot::ChunkSnapshot(const World& world, const Chunk& chunk)
+    : _position(chunk.GetPosition()), _revision(chunk.GetRevision()),
+    _blocks((size_t)SIZE * SIZE * SIZE_Y, Block::AIR),
+    _light((size_t)SIZE * SIZE * SIZE_Y, Chunk::MAX_LIGHT << 4)
+{
+    const glm::ivec2 chunkCoords = _position / (int32_t)Chunk::WIDTH;
+
+    std::shared_ptr<const Chunk> neighbors[3][3];
+    for (int32_t x = -1; x <= 1; x++)
+    {
+        for (int32_t z = -1; z <= 1; z++)
+        {
+            neighbors[x + 1][z + 1] = world.GetChunk(chunkCoords + glm::ivec2(x, z));
+        }
+    }
+
+    for (int32_t z = -1; z <= (int32_t)Chunk::WIDTH; z++)
+    {
+        for (int32_t x = -1; x <= (int32_t)Chunk::WIDTH; x++)
+        {
+            // Which chunk this column comes from, and where in it.
+            glm::ivec2 offset = glm::ivec2(
+                x < 0 ? -1 : (x >= Chunk::WIDTH ? 1 : 0),
+                z < 0 ? -1 : (z >= Chunk::WIDTH ? 1 : 0)
+            );
+            const Chunk* source = neighbors[offset.x + 1][offset.y + 1].get();
+            if (!source)
+            {
+                continue;
+            }
+
+            glm::ivec3 sourceCoords = glm::ivec3(x - offset.x * (int32_t)Chunk::WIDTH, 0, z - offset.y * (int32_t)Chunk::WIDTH);
+            for (int32_t y = 0; y < Chunk::HEIGHT; y++)
+            {
+                sourceCoords.y = y;
+                size_t index = GetIndex(glm::ivec3(x, y, z));
+                _blocks[index] = source->GetBlock(sourceCoords);
+                _light[index] = source->GetPackedLight(sourceCoords);
+            }
+        }
+    }
+}
+
+ChunkMeshData ChunkMesher::Build(const ChunkSnapshot& chunk, uint32_t lod)
+{
+    ChunkMeshData data;
+
+    const int32_t scale = 1 << lod;
+    const glm::ivec3 size = glm::ivec3(Chunk::WIDTH, Chunk::HEIGHT, Chunk::WIDTH) / scale;
+    const std::vector<Block> cells = Downsample(chunk, scale);
+
+    auto getCell = [&](int32_t x, int32_t y, int32_t z)
+    {
+        return cells[(y * size.z + z) * size.x + x];
+    };
+
+    // Distant chunks are simply lit by the sky, sampling the light at their
+    // scale would mostly hit blocks.
+    const uint32_t skyLight = ChunkVertex::PackLight(Chunk::MAX_LIGHT * 4, 0, 4, 3);
+    const std::array<uint32_t, 4> skyLights = { skyLight, skyLight, skyLight, skyLight };
+
+    // Coarser faces on the chunk border are always emitted, which hides the
+    // cracks between chunks at different levels of detail.
+    for (int32_t x = 0; x < size.x; x++)
+    {
+        for (int32_t y = 0; y < size.y; y++)
+        {
+            for (int32_t z = 0; z < size.z; z++)
+            {
+                Block block = getCell(x, y, z);
+                if (block == Block::AIR)
+                {
+                    continue;
+                }
+
+                for (size_t k = 0; k < 6; k++)
+                {
+                    const glm::ivec3 front = glm::ivec3(x, y, z) + FACE_GEOMETRIES[k].normal;
+                    if (front.x >= 0 && front.x < size.x &&
+                        front.y >= 0 && front.y < size.y &&
+                        front.z >= 0 && front.z < size.z &&
+                        !BlockInfo::IsFaceVisible(block, getCell(front.x, front.y, front.z)))
+                    {
+                        continue;
+                    }
+
+                    // Nothing can look at the bottom of the world.
+                    if (front.y < 0)
+                    {
+                        continue;
+                    }
+
+                    // At full detail the border is culled against the
+                    // neighbors like the rest. A coarser neighbor is solid
+                    // wherever its blocks are, so this opens no cracks.
+                    if (scale == 1 && !BlockInfo::IsFaceVisible(block, chunk.GetBlock(front)))
+                    {
+                        continue;
+                    }
+
+                    const BlockFace face = (BlockFace)k;
+                    const glm::vec3 position = glm::vec3(x, y, z) * (float)scale;
+                    AddFaceToData(position, scale, block, face,
+                        scale == 1 ? GetCornerLights(chunk, front, face) : skyLights, data);
+                }
+            }
+        }
+    }
+
+    return data;
+}
+
+std::array<uint32_t, 4> ChunkMesher::GetCornerLights(const ChunkSnapshot& chunk, const glm::ivec3& front, BlockFace face)
+{
+    const FaceGeometry& geometry = FACE_GEOMETRIES[(size_t)face];
+    const size_t frontIndex = ChunkSnapshot::GetIndex(front);
+    const uint8_t frontLight = chunk.GetLight(frontIndex);
+    const ptrdiff_t dxStride = ChunkSnapshot::GetStride(geometry.dx);
+    const ptrdiff_t dyStride = ChunkSnapshot::GetStride(geometry.dy);
+
+    std::array<uint32_t, 4> lights;
+    for (size_t i = 0; i < 4; i++)
+    {
+        const ptrdiff_t dx = CORNERS[i].x ? dxStride : -dxStride;
+        const ptrdiff_t dy = CORNERS[i].y ? dyStride : -dyStride;
+
+        // The three blocks around the corner in front of the face.
+        const size_t samples[] = { frontIndex + dx, frontIndex + dy, frontIndex + dx + dy };
+        uint32_t isOpaque[3];
+        for (size_t j = 0; j < 3; j++)
+        {
+            isOpaque[j] = BlockInfo::GetInfoOf(chunk.GetBlock(samples[j])).isOpaque;
+        }
+
+        // With both sides blocked the corner block cannot be seen, nor can
+        // its light get through.
+        isOpaque[2] |= isOpaque[0] & isOpaque[1];
+        uint32_t occlusion = 3 - isOpaque[0] - isOpaque[1] - isOpaque[2];
+
+        // Branchless, since whether a sample counts is hard to predict.
+        uint32_t sky = frontLight >> 4;
+        uint32_t blockLight = frontLight & 0xF;
+        uint32_t count = 1;
+        for (size_t j = 0; j < 3; j++)
+        {
+            const uint32_t mask = isOpaque[j] - 1;
+            const uint8_t light = chunk.GetLight(samples[j]);
+            sky += (light >> 4) & mask;
+            blockLight += light & 0xF & mask;
+            count += 1 - isOpaque[j];
+        }
+
+        lights[i] = ChunkVertex::PackLight(sky, blockLight, count, occlusion);
+    }
+
+    return lights;
+}
+
+uint32_t ChunkMesher::GetLod(float distance, int32_t lodDistance)
+{
+    uint32_t lod = 0;
+    while (lod + 1 < LOD_COUNT && distance > lodDistance * (float)(1 << lod))
+    {
+        lod++;
+    }
+    return lod;
+}
+
+std::vector<Block> ChunkMesher::Downsample(const ChunkSnapshot& chunk, int32_t scale)
+{
+    const glm::ivec3 size = glm::ivec3(Chunk::WIDTH, Chunk::HEIGHT, Chunk::WIDTH) / scale;
+    std::vector<Block> cells = std::vector<Block>((size_t)size.x * size.y * size.z, Block::AIR);
+
+    // A cell is solid if any of its blocks is, so thin features do not
+    // vanish in the distance. It takes the topmost block, which keeps the
+    // grass on top of hills.
+    for (int32_t y = 0; y < size.y; y++)
+    {
+        for (int32_t z = 0; z < size.z; z++)
+        {
+            for (int32_t x = 0; x < size.x; x++)
+            {
+                Block& cell = cells[(y * size.z + z) * size.x + x];
+                for (int32_t by = scale - 1; by >= 0 && cell == Block::AIR; by--)
+                {
+                    for (int32_t bz = 0; bz < scale && cell == Block::AIR; bz++)
+                    {
+                        for (int32_t bx = 0; bx < scale && cell == Block::AIR; bx++)
+                        {
+                            cell = chunk.GetBlock(glm::ivec3(x * scale + bx, y * scale + by, z * scale + bz));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return cells;
+}
+
+void ChunkMesher::SortTranslucentFaces(const TranslucentFaces& faces, const glm::vec3& viewPosition, TranslucentOrder& order)
+{
+    const size_t faceCount = faces.centers.size();
+
+    std::vector<float> distances = std::vector<float>(faceCount);
+    for (size_t i = 0; i < faceCount; i++)
+    {
+        glm::vec3 offset = faces.centers[i] - viewPosition;
+        distances[i] = glm::dot(offset, offset);
+    }
+
+    auto isFarther = [&](uint32_t a, uint32_t b) { return distances[a] > distances[b]; };
+
+    if (order.faces.size() != faceCount)
+    {
+        order.faces.resize(faceCount);
+        for (uint32_t i = 0; i < faceCount; i++)
+        {
+            order.faces[i] = i;
+        }
+        std::sort(order.faces.begin(), order.faces.end(), isFarther);
+    }
+    else
+    {
+        // Insertion sort runs in close to linear time on the nearly sorted
+        // order left by the last view position.
+        for (size_t i = 1; i < faceCount; i++)
+        {
+            uint32_t face = order.faces[i];
+            size_t j = i;
+            for (; j > 0 && isFarther(face, order.faces[j - 1]); j--)
+            {
+                order.faces[j] = order.faces[j - 1];
+            }
+            order.faces[j] = face;
+        }
+    }
+
+    order.viewPosition = viewPosition;
+    order.elements.resize(faces.elements.size());
+    for (size_t i = 0; i < faceCount; i++)
+    {
+        std::copy_n(faces.elements.begin() + order.faces[i] * 6, 6, order.elements.begin() + i * 6);
+    }
+}
+
+void ChunkMesher::AddFaceToData(const std::array<glm::vec3, 4>& positionList, const glm::uvec2& size,
+    uint32_t layer, RenderLayer renderLayer, const std::array<uint32_t, 4>& lights, ChunkMeshData& data)
+{
+    const size_t offset = data.vertices.size();
+    const bool isCutout = renderLayer == RenderLayer::CUTOUT;
+
+    data.vertices.push_back({ positionList[0], ChunkVertex::PackTexCoords(glm::uvec2(0, 0), layer, isCutout), lights[0] });
+    data.vertices.push_back({ positionList[1], ChunkVertex::PackTexCoords(glm::uvec2(size.x, 0), layer, isCutout), lights[1] });
+    data.vertices.push_back({ positionList[2], ChunkVertex::PackTexCoords(glm::uvec2(size.x, size.y), layer, isCutout), lights[2] });
+    data.vertices.push_back({ positionList[3], ChunkVertex::PackTexCoords(glm::uvec2(0, size.y), layer, isCutout), lights[3] });
+
+    // The quad is split along its brighter diagonal. Otherwise the darkening
+    // of a single corner bleeds across the whole triangle and the quad
+    // looks different depending on its orientation. One step of occlusion
+    // weighs about as much as one light level.
+    auto getShade = [&](size_t i)
+    {
+        return ChunkVertex::UnpackOcclusion(lights[i]) * 16 + ChunkVertex::UnpackLight(lights[i]);
+    };
+    const size_t first = getShade(0) + getShade(2) >= getShade(1) + getShade(3) ? 0 : 1;
+
+    std::vector<uint32_t>& elements = renderLayer == RenderLayer::TRANSLUCENT
+        ? data.translucentFaces.elements
+        : data.elements;
+
+    elements.push_back(offset + first);
+    elements.push_back(offset + first + 2);
+    elements.push_back(offset + (first + 1) % 4);
+
+    elements.push_back(offset + first);
+    elements.push_back(offset + first + 2);
+    elements.push_back(offset + (first + 3) % 4);
+
+    if (renderLayer == RenderLayer::TRANSLUCENT)
+    {
+        data.translucentFaces.centers.push_back((positionList[0] + positionList[2]) * 0.5f);
+    }
+}
+
+void ChunkMesher::AddFaceToData(const glm::vec3& position, int32_t scale,
+    const Block block, BlockFace face, const std::array<uint32_t, 4>& lights, ChunkMeshData& data)
+{
+    const FaceGeometry& geometry = FACE_GEOMETRIES[(size_t)face];
+    const BlockAtlas& atlas = BlockAtlas::GetAtlasOf(block);
+
+    uint32_t layer;
+    switch (face)
+    {
+    case BlockFace::BOTTOM:
+        layer = atlas.bottom;
+        break;
+
+    case BlockFace::TOP:
+        layer = atlas.top;
+        break;
+
+    default:
+        layer = atlas.side;
+        break;
+    }
+
+    const glm::vec3 origin = position + glm::vec3(geometry.origin) * (float)scale;
+    const glm::vec3 dx = glm::vec3(geometry.dx) * (float)scale;
+    const glm::vec3 dy = glm::vec3(geometry.dy) * (float)scale;
+
+    std::array<glm::vec3, 4> positionList;
+    positionList[0] = origin;
+    positionList[1] = origin + dx;
+    positionList[2] = origin + dx + dy;
+    positionList[3] = origin + dy;
+
+    AddFaceToData(positionList, glm::uvec2(scale, scale), layer, BlockInfo::GetInfoOf(block).layer, lights, data);
+}
+
+} // namespace Krafter
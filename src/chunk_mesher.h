@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "glm/glm.hpp"
+
+#include "block.h"
+
+namespace Krafter
+{
+
+class World;
+
+struct ChunkVertex
+{
+    // Packs tile-local texture coordinates (which may exceed 1 to tile a
+    // texture across several blocks), the atlas layer and whether the
+    // texture is alpha tested into 32 bits.
+    static constexpr uint32_t PackTexCoords(const glm::uvec2& uvCoords, uint32_t layer, bool isCutout)
+    {
+        return (uvCoords.x & 0xFF) | ((uvCoords.y & 0xFF) << 8) | ((layer & 0x7FFF) << 16) | ((uint32_t)isCutout << 31);
+    }
+
+    // Packs the smooth light of a corner, the sum of the sky and block
+    // light levels of its samples, along with how occluded it is from 0
+    // (fully) to 3 (not at all). Light levels keep four fractional bits.
+    static constexpr uint32_t PackLight(uint32_t sky, uint32_t block, uint32_t sampleCount, uint32_t occlusion)
+    {
+        return (sky * 16 / sampleCount) | ((block * 16 / sampleCount) << 8) | (occlusion << 16);
+    }
+
+    static constexpr uint32_t UnpackLight(uint32_t light)
+    {
+        return (light & 0xFF) > ((light >> 8) & 0xFF) ? light & 0xFF : (light >> 8) & 0xFF;
+    }
+
+    static constexpr uint32_t UnpackOcclusion(uint32_t light)
+    {
+        return light >> 16;
+    }
+
+    glm::vec3 position;
+    uint32_t texCoords;
+    uint32_t light;
+};
+
+// A copy of a chunk and the blocks bordering it in its neighbors, so that
+// it can be meshed on another thread while the world keeps changing.
+class ChunkSnapshot
+{
+public:
+    static constexpr int32_t SIZE = Chunk::WIDTH + 2;
+    static constexpr int32_t SIZE_Y = Chunk::HEIGHT + 2;
+
+    ChunkSnapshot(const World& world, const Chunk& chunk);
+
+    inline const glm::ivec2& GetPosition() const { return _position; }
+    inline uint32_t GetRevision() const { return _revision; }
+
+    // Coordinates are relative to the chunk and may reach one block past it
+    // on every side. Missing neighbors, and the layers above and below the
+    // world, are open sky.
+    static inline size_t GetIndex(const glm::ivec3& coords)
+    {
+        return ((size_t)(coords.y + 1) * SIZE + (coords.z + 1)) * SIZE + (coords.x + 1);
+    }
+
+    // How far apart two neighboring blocks are in index space.
+    static constexpr ptrdiff_t GetStride(const glm::ivec3& direction)
+    {
+        return ((ptrdiff_t)direction.y * SIZE + direction.z) * SIZE + direction.x;
+    }
+
+    inline Block GetBlock(size_t index) const { return _blocks[index]; }
+    inline uint8_t GetLight(size_t index) const { return _light[index]; }
+    inline Block GetBlock(const glm::ivec3& coords) const { return _blocks[GetIndex(coords)]; }
+    inline uint8_t GetLight(const glm::ivec3& coords) const { return _light[GetIndex(coords)]; }
+
+private:
+    glm::ivec2 _position;
+    uint32_t _revision;
+
+    std::vector<Block> _blocks;
+    std::vector<uint8_t> _light;
+};
+
+// Translucent faces have to be drawn back to front, so they are kept apart
+// from the rest with six elements per face, in the order they were built.
+struct TranslucentFaces
+{
+    std::vector<glm::vec3> centers;
+    std::vector<uint32_t> elements;
+};
+
+// The faces of a TranslucentFaces sorted for one view position.
+struct TranslucentOrder
+{
+    glm::vec3 viewPosition;
+    std::vector<uint32_t> faces;
+    std::vector<uint32_t> elements;
+};
+
+struct ChunkMeshData
+{
+    std::vector<ChunkVertex> vertices;
+    std::vector<uint32_t> elements;
+    TranslucentFaces translucentFaces;
+};
+
+// Builds chunk geometry on the CPU, so it can run on any thread.
+class ChunkMesher
+{
+public:
+    static constexpr uint32_t LOD_COUNT = 4;
+    // In chunks, how far the full detail reaches unless changed.
+    static constexpr int32_t DEFAULT_LOD_DISTANCE = 4;
+
+    // At a level of detail of n, every cube of 2^n blocks is merged into a
+    // single block, which is drawn 2^n times larger with its texture tiled.
+    static ChunkMeshData Build(const ChunkSnapshot& chunk, uint32_t lod);
+    // The level of detail of a chunk this many chunks away. Level n is used
+    // up to 2^n times the LOD distance, the last one up to the view distance.
+    static uint32_t GetLod(float distance, int32_t lodDistance);
+
+    // Sorts the faces back to front as seen from a position relative to the
+    // chunk. An order from an earlier sort is a good guess after a small
+    // move, so it is only refined instead of sorted from scratch.
+    static void SortTranslucentFaces(const TranslucentFaces& faces, const glm::vec3& viewPosition, TranslucentOrder& order);
+
+private:
+    static std::vector<Block> Downsample(const ChunkSnapshot& chunk, int32_t scale);
+
+    // Averages the light in front of each corner of a face over the blocks
+    // touching it and counts the opaque ones for ambient occlusion.
+    static std::array<uint32_t, 4> GetCornerLights(const ChunkSnapshot& chunk, const glm::ivec3& front, BlockFace face);
+
+    static void AddFaceToData(const std::array<glm::vec3, 4>& positionList, const glm::uvec2& size,
+        uint32_t layer, RenderLayer renderLayer, const std::array<uint32_t, 4>& lights, ChunkMeshData& data);
+    static void AddFaceToData(const glm::vec3& position, int32_t scale,
+        Block block, BlockFace face, const std::array<uint32_t, 4>& lights, ChunkMeshData& data);
+};
+
+} // namespace Krafter
@@ -0,0 +1,240 @@
+#include "world.h"
+#include "entities.h"
+
+namespace Krafter
+{
+
+// A xorshift step; cheap enough to run per entity and reproducible from
+// the seed alone.
+static uint32_t NextRandom(uint32_t& seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static float NextRandomFloat(uint32_t& seed)
+{
+    return (NextRandom(seed) >> 8) / (float)(1 << 24);
+}
+
+Entity EntitySystems::SpawnMob(EntityRegistry& registry, const glm::vec3& position, uint32_t seed)
+{
+    PhysicsBody body = {
+        .position = position,
+        .velocity = glm::vec3(0.0f),
+        .size = glm::vec3(0.8f),
+        .isOnGround = false
+    };
+    // Every mob is tinted a little differently.
+    uint32_t tintSeed = seed | 1;
+    uint32_t tint = 0xFF000000;
+    for (uint32_t channel = 0; channel < 3; channel++)
+    {
+        tint |= (uint32_t)(200 + NextRandomFloat(tintSeed) * 55.0f) << (channel * 8);
+    }
+
+    return registry.Create(body, PreviousPosition{ position }, Wander{ glm::vec2(0.0f), 0.0f, seed | 1 },
+        Orientation{ 0.0f, 0.0f, 0.0f }, Appearance{ EntityModel::MOB, Block::GRASS, glm::vec3(0.8f), tint });
+}
+
+Entity EntitySystems::SpawnItem(EntityRegistry& registry, const glm::vec3& position, Block block)
+{
+    PhysicsBody body = {
+        .position = position,
+        .velocity = glm::vec3(0.0f),
+        .size = glm::vec3(0.25f),
+        .isOnGround = false
+    };
+    return registry.Create(body, PreviousPosition{ position }, Orientation{ 0.0f, 0.0f, ITEM_SPIN },
+        Appearance{ EntityModel::BLOCK, block, glm::vec3(0.25f), 0xFFFFFFFF }, Lifetime{ ITEM_LIFETIME });
+}
+
+uint32_t EntitySystems::SpawnMobsAround(EntityRegistry& registry, const World& world, const glm::vec3& center,
+    float radius, uint32_t count, uint32_t seed)
+{
+    seed |= 1;
+
+    uint32_t spawned = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float angle = NextRandomFloat(seed) * glm::radians(360.0f);
+        float distance = glm::sqrt(NextRandomFloat(seed)) * radius;
+        glm::ivec3 column = glm::ivec3(glm::floor(center + glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle)) * distance));
+
+        if (!world.GetChunk(World::GetChunkCoords(column)))
+        {
+            continue;
+        }
+
+        column.y = Chunk::HEIGHT;
+        while (column.y > 0 && !world.IsSolid(column - glm::ivec3(0, 1, 0)))
+        {
+            column.y--;
+        }
+
+        SpawnMob(registry, glm::vec3(column) + glm::vec3(0.5f, 0.0f, 0.5f), NextRandom(seed));
+        spawned++;
+    }
+
+    return spawned;
+}
+
+void EntitySystems::UpdateOrientation(EntityRegistry& registry, float delta)
+{
+    registry.ParallelEach<Orientation>(BATCH_SIZE, [delta](size_t count, const Entity*, Orientation* orientations)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Orientation& orientation = orientations[i];
+            orientation.previousYaw = orientation.yaw;
+            orientation.yaw += orientation.spin * delta;
+
+            // Both are wrapped together, so interpolating between them never
+            // goes the long way around.
+            float turns = glm::floor(orientation.yaw / glm::radians(360.0f));
+            orientation.yaw -= turns * glm::radians(360.0f);
+            orientation.previousYaw -= turns * glm::radians(360.0f);
+        }
+    });
+}
+
+void EntitySystems::UpdateWander(EntityRegistry& registry, float delta)
+{
+    registry.ParallelEach<Wander, PhysicsBody, Orientation>(BATCH_SIZE, [delta](size_t count, const Entity*,
+        Wander* wanders, PhysicsBody* bodies, Orientation* orientations)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Wander& wander = wanders[i];
+            PhysicsBody& body = bodies[i];
+            Orientation& orientation = orientations[i];
+
+            // Physics stops the blocked axes, so a velocity short of the
+            // wanted one means a wall.
+            glm::vec2 velocity = wander.direction * WANDER_SPEED;
+            if (body.isOnGround && velocity != glm::vec2(0.0f) && glm::vec2(body.velocity.x, body.velocity.z) != velocity)
+            {
+                body.velocity.y = JUMP_SPEED;
+            }
+
+            wander.timeLeft -= delta;
+            if (wander.timeLeft <= 0.0f)
+            {
+                float angle = NextRandomFloat(wander.seed) * glm::radians(360.0f);
+                bool isWalking = NextRandomFloat(wander.seed) < 0.7f;
+                wander.direction = isWalking ? glm::vec2(glm::cos(angle), glm::sin(angle)) : glm::vec2(0.0f);
+                wander.timeLeft = 1.0f + NextRandomFloat(wander.seed) * 4.0f;
+                velocity = wander.direction * WANDER_SPEED;
+            }
+
+            body.velocity.x = velocity.x;
+            body.velocity.z = velocity.y;
+
+            if (wander.direction != glm::vec2(0.0f))
+            {
+                // Turns the short way, leaving the previous yaw within half
+                // a turn of the new one.
+                float turn = glm::atan(wander.direction.y, wander.direction.x) - orientation.yaw;
+                turn -= glm::floor((turn + glm::radians(180.0f)) / glm::radians(360.0f)) * glm::radians(360.0f);
+                orientation.yaw += glm::clamp(turn, -TURN_SPEED * delta, TURN_SPEED * delta);
+            }
+        }
+    });
+}
+
+void EntitySystems::UpdatePhysics(EntityRegistry& registry, const World& world, float delta)
+{
+    registry.ParallelEach<PhysicsBody, PreviousPosition>(BATCH_SIZE, [&world, delta](size_t count, const Entity*, PhysicsBody* bodies, PreviousPosition* previousPositions)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            previousPositions[i].value = bodies[i].position;
+            Physics::Step(world, bodies[i], delta);
+        }
+    });
+}
+
+uint32_t EntitySystems::Despawn(EntityRegistry& registry, const World& world, const glm::vec3& playerPosition, float delta)
+{
+    // Destroying moves rows around, so the entities are only collected while
+    // iterating.
+    std::vector<Entity> despawned;
+
+    registry.Each<PhysicsBody>([&](size_t count, const Entity* entities, PhysicsBody* bodies)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!world.GetChunk(World::GetChunkCoords(glm::ivec3(glm::floor(bodies[i].position)))))
+            {
+                despawned.push_back(entities[i]);
+            }
+        }
+    });
+
+    registry.Each<Lifetime, PhysicsBody>([&](size_t count, const Entity* entities, Lifetime* lifetimes, PhysicsBody* bodies)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            lifetimes[i].timeLeft -= delta;
+            if (lifetimes[i].timeLeft <= 0.0f || glm::distance(bodies[i].position, playerPosition) < PICKUP_RADIUS)
+            {
+                despawned.push_back(entities[i]);
+            }
+        }
+    });
+
+    registry.Each<Wander, PhysicsBody>([&](size_t count, const Entity* entities, Wander*, PhysicsBody* bodies)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (glm::distance(bodies[i].position, playerPosition) > MOB_DESPAWN_DISTANCE)
+            {
+                despawned.push_back(entities[i]);
+            }
+        }
+    });
+
+    uint32_t destroyed = 0;
+    for (Entity entity : despawned)
+    {
+        // An entity can be collected more than once.
+        if (registry.IsAlive(entity))
+        {
+            registry.Destroy(entity);
+            destroyed++;
+        }
+    }
+    return destroyed;
+}
+
+void EntitySystems::CollectInstances(EntityRegistry& registry, EntityInstances& instances)
+{
+    // Copying is cheap next to the other systems, so it stays on one thread
+    // and the instances of every model end up next to each other.
+    for (std::vector<EntityInstance>& modelInstances : instances)
+    {
+        modelInstances.clear();
+    }
+
+    registry.Each<Appearance, PhysicsBody, PreviousPosition, Orientation>([&instances](size_t count, const Entity*,
+        Appearance* appearances, PhysicsBody* bodies, PreviousPosition* previousPositions, Orientation* orientations)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const Appearance& appearance = appearances[i];
+            instances[(size_t)appearance.model].push_back({
+                .previousPosition = previousPositions[i].value,
+                .previousYaw = orientations[i].previousYaw,
+                .position = bodies[i].position,
+                .yaw = orientations[i].yaw,
+                .scale = appearance.scale,
+                .layer = BlockAtlas::GetAtlasOf(appearance.block).side,
+                .tint = appearance.tint
+            });
+        }
+    });
+}
+
+} // namespace Krafter
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "block.h"
+#include "physics.h"
+#include "entity_registry.h"
+
+namespace Krafter
+{
+
+class World;
+
+// Where an entity was at the start of the last tick, for interpolation.
+struct PreviousPosition
+{
+    glm::vec3 value;
+};
+
+// Walks in a random direction for a while, then picks another one or
+// stands still.
+struct Wander
+{
+    glm::vec2 direction;
+    float timeLeft;
+    uint32_t seed;
+};
+
+// Turns around the vertical axis, with zero facing +x. Spinning entities
+// turn by themselves, the others are turned by their systems.
+struct Orientation
+{
+    float yaw;
+    float previousYaw;
+    float spin;
+};
+
+// Despawns the entity once it runs out.
+struct Lifetime
+{
+    float timeLeft;
+};
+
+enum class EntityModel : uint8_t
+{
+    BLOCK,
+    MOB
+};
+
+static constexpr size_t ENTITY_MODEL_COUNT = 2;
+
+// Drawn as the given model, textured like the side of a block.
+struct Appearance
+{
+    EntityModel model;
+    Block block;
+    glm::vec3 scale;
+    // RGBA, multiplied with the texture.
+    uint32_t tint;
+};
+
+// What the renderer needs of an entity, packed for an instance buffer. The
+// transform is kept at both of the last two ticks for interpolation.
+struct EntityInstance
+{
+    glm::vec3 previousPosition;
+    float previousYaw;
+    glm::vec3 position;
+    float yaw;
+    glm::vec3 scale;
+    uint32_t layer;
+    uint32_t tint;
+};
+
+// The instances of every model, each drawn with a single call.
+using EntityInstances = std::array<std::vector<EntityInstance>, ENTITY_MODEL_COUNT>;
+
+// Mobs wander around and items just fall, both collide with the world
+// like the player does.
+class EntitySystems
+{
+public:
+    static constexpr float WANDER_SPEED = 2.0f;
+    static constexpr float JUMP_SPEED = 8.5f;
+    static constexpr float TURN_SPEED = 8.0f;
+    static constexpr float ITEM_SPIN = 2.0f;
+    // In seconds.
+    static constexpr float ITEM_LIFETIME = 300.0f;
+    // Items this close to the player are picked up.
+    static constexpr float PICKUP_RADIUS = 1.5f;
+    // Mobs farther than this from the player despawn.
+    static constexpr float MOB_DESPAWN_DISTANCE = 128.0f;
+    static constexpr size_t BATCH_SIZE = 1024;
+
+    static Entity SpawnMob(EntityRegistry& registry, const glm::vec3& position, uint32_t seed);
+    static Entity SpawnItem(EntityRegistry& registry, const glm::vec3& position, Block block);
+
+    // Spawns the given number of mobs on the surface around a position,
+    // skipping columns in chunks that are not loaded. Returns how many
+    // were spawned.
+    static uint32_t SpawnMobsAround(EntityRegistry& registry, const World& world, const glm::vec3& center,
+        float radius, uint32_t count, uint32_t seed);
+
+    // Remembers the last yaw for interpolation and turns spinning entities.
+    static void UpdateOrientation(EntityRegistry& registry, float delta);
+    // Steers the wandering entities; they turn towards where they walk and
+    // jump when walking into a wall.
+    static void UpdateWander(EntityRegistry& registry, float delta);
+    static void UpdatePhysics(EntityRegistry& registry, const World& world, float delta);
+    // Destroys items that ran out of time or were picked up, mobs too far
+    // from the player and anything in a chunk that is no longer loaded.
+    // Returns how many were destroyed.
+    static uint32_t Despawn(EntityRegistry& registry, const World& world, const glm::vec3& playerPosition, float delta);
+
+    // Fills the instances of every entity with an appearance, grouped by
+    // model, replacing what was there.
+    static void CollectInstances(EntityRegistry& registry, EntityInstances& instances);
+};
+
+} // namespace Krafter
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+#include "thread_pool.h"
+
+namespace Krafter
+{
+
+struct Entity
+{
+    uint32_t index;
+    // Tells a destroyed entity apart from the one that reused its index.
+    uint32_t generation;
+
+    inline bool operator==(const Entity&) const = default;
+};
+
+// One bit per component type, in the order the types are first used.
+using ComponentMask = uint32_t;
+
+class ComponentType
+{
+public:
+    static constexpr uint32_t MAX_COUNT = 32;
+
+    template<typename T>
+    static uint32_t GetId()
+    {
+        // Columns are moved around with memcpy.
+        static_assert(std::is_trivially_copyable_v<T>);
+        static const uint32_t id = _nextId++;
+        assert(id < MAX_COUNT);
+        return id;
+    }
+
+    template<typename... Components>
+    static ComponentMask GetMask() { return ((1u << GetId<Components>()) | ... | 0u); }
+
+private:
+    inline static std::atomic<uint32_t> _nextId;
+};
+
+// Holds every entity with exactly the same set of components, one tightly
+// packed column per component, so systems stream through only the data
+// they use.
+class Archetype
+{
+public:
+    template<typename... Components>
+    static std::unique_ptr<Archetype> Create()
+    {
+        std::unique_ptr<Archetype> archetype = std::unique_ptr<Archetype>(new Archetype(ComponentType::GetMask<Components...>()));
+        (archetype->AddColumn(ComponentType::GetId<Components>(), sizeof(Components)), ...);
+        return archetype;
+    }
+
+    inline ComponentMask GetMask() const { return _mask; }
+    inline size_t GetSize() const { return _entities.size(); }
+    inline const Entity* GetEntities() const { return _entities.data(); }
+
+    template<typename T>
+    inline T* GetColumn()
+    {
+        Column& column = _columns[_columnIndices[ComponentType::GetId<T>()]];
+        return (T*)column.data.data();
+    }
+
+    // Appends a row with uninitialized components and returns its index.
+    size_t AddRow(Entity entity)
+    {
+        for (Column& column : _columns)
+        {
+            column.data.resize(column.data.size() + column.size);
+        }
+        _entities.push_back(entity);
+        return _entities.size() - 1;
+    }
+
+    // Moves the last row into the removed one and returns the entity that
+    // moved, which is the removed one itself if it was last.
+    Entity RemoveRow(size_t row)
+    {
+        const size_t last = _entities.size() - 1;
+        for (Column& column : _columns)
+        {
+            if (row != last)
+            {
+                std::memcpy(column.data.data() + row * column.size, column.data.data() + last * column.size, column.size);
+            }
+            column.data.resize(column.data.size() - column.size);
+        }
+
+        Entity moved = _entities[last];
+        _entities[row] = moved;
+        _entities.pop_back();
+        return moved;
+    }
+
+private:
+    struct Column
+    {
+        size_t size;
+        std::vector<std::byte> data;
+    };
+
+    Archetype(ComponentMask mask) : _mask(mask), _columnIndices{} {}
+
+    void AddColumn(uint32_t componentId, size_t size)
+    {
+        _columnIndices[componentId] = _columns.size();
+        _columns.push_back({ size, {} });
+    }
+
+    ComponentMask _mask;
+    std::vector<Entity> _entities;
+    std::vector<Column> _columns;
+    uint8_t _columnIndices[ComponentType::MAX_COUNT];
+};
+
+// Entities are only handles; their components live in the archetype that
+// matches their exact set of components. Components are plain data and
+// systems are functions run over every archetype that has the components
+// they need.
+class EntityRegistry
+{
+public:
+    EntityRegistry() : _count(0) {}
+
+    template<typename... Components>
+    Entity Create(const Components&... components)
+    {
+        Archetype& archetype = GetArchetype<Components...>();
+
+        Entity entity;
+        if (!_freeIndices.empty())
+        {
+            entity = { _freeIndices.back(), _locations[_freeIndices.back()].generation };
+            _freeIndices.pop_back();
+        }
+        else
+        {
+            entity = { (uint32_t)_locations.size(), 0 };
+            _locations.push_back({});
+        }
+
+        size_t row = archetype.AddRow(entity);
+        ((archetype.GetColumn<Components>()[row] = components), ...);
+        _locations[entity.index] = { entity.generation, &archetype, row };
+        _count++;
+        return entity;
+    }
+
+    void Destroy(Entity entity)
+    {
+        assert(IsAlive(entity));
+        Location& location = _locations[entity.index];
+
+        Entity moved = location.archetype->RemoveRow(location.row);
+        _locations[moved.index].row = location.row;
+
+        location.generation++;
+        location.archetype = nullptr;
+        _freeIndices.push_back(entity.index);
+        _count--;
+    }
+
+    inline bool IsAlive(Entity entity) const
+    {
+        return entity.index < _locations.size() && _locations[entity.index].archetype &&
+            _locations[entity.index].generation == entity.generation;
+    }
+
+    template<typename T>
+    inline T& Get(Entity entity)
+    {
+        assert(IsAlive(entity));
+        const Location& location = _locations[entity.index];
+        return location.archetype->GetColumn<T>()[location.row];
+    }
+
+    inline size_t GetCount() const { return _count; }
+    inline size_t GetArchetypeCount() const { return _archetypes.size(); }
+
+    // Calls function(count, entities, columns...) once per archetype that has
+    // all of the components, with a pointer to the start of each column.
+    template<typename... Components, typename Function>
+    void Each(Function&& function)
+    {
+        const ComponentMask mask = ComponentType::GetMask<Components...>();
+        for (auto& [archetypeMask, archetype] : _archetypes)
+        {
+            if ((archetypeMask & mask) == mask && archetype->GetSize() > 0)
+            {
+                function(archetype->GetSize(), archetype->GetEntities(), archetype->template GetColumn<Components>()...);
+            }
+        }
+    }
+
+    // Like Each() but splits every archetype into batches run on the thread
+    // pool, each called with pointers to the start of its batch. The
+    // function must only touch the rows it is given.
+    template<typename... Components, typename Function>
+    void ParallelEach(size_t batchSize, Function&& function)
+    {
+        Each<Components...>([&](size_t count, const Entity* entities, Components*... columns)
+        {
+            ThreadPool::Get()->ParallelFor(count, batchSize, [&](size_t begin, size_t end)
+            {
+                function(end - begin, entities + begin, (columns + begin)...);
+            });
+        });
+    }
+
+private:
+    struct Location
+    {
+        uint32_t generation;
+        Archetype* archetype;
+        size_t row;
+    };
+
+    template<typename... Components>
+    Archetype& GetArchetype()
+    {
+        std::unique_ptr<Archetype>& archetype = _archetypes[ComponentType::GetMask<Components...>()];
+        if (!archetype)
+        {
+            archetype = Archetype::Create<Components...>();
+        }
+        return *archetype;
+    }
+
+    std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> _archetypes;
+    std::vector<Location> _locations;
+    std::vector<uint32_t> _freeIndices;
+    size_t _count;
+};
+
+} // namespace Krafter
@@ -0,0 +1,73 @@
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#include "file_watcher.h"
+
+namespace Krafter
+{
+
+FileWatcher::FileWatcher(std::string_view directory)
+    : _fd(-1), _watch(-1)
+{
+#ifdef __linux__
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0)
+    {
+        std::cerr << "[FILE] Could not watch " << directory << std::endl;
+        return;
+    }
+
+    // Editors either rewrite a file in place or replace it with a renamed
+    // temporary one, so both have to be watched.
+    _watch = inotify_add_watch(_fd, std::string(directory).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (_watch < 0)
+    {
+        std::cerr << "[FILE] Could not watch " << directory << std::endl;
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+#endif
+}
+
+std::vector<std::string> FileWatcher::Poll() const
+{
+    std::vector<std::string> result;
+
+#ifdef __linux__
+    if (_watch < 0)
+    {
+        return result;
+    }
+
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    ssize_t length;
+    while ((length = read(_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* it = buffer; it < buffer + length; it += sizeof(inotify_event) + ((inotify_event*)it)->len)
+        {
+            const inotify_event* event = (const inotify_event*)it;
+            if (event->len > 0)
+            {
+                result.emplace_back(event->name);
+            }
+        }
+    }
+#endif
+
+    return result;
+}
+
+} // namespace Krafter
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace Krafter
+{
+
+// Watches a directory for files that were written or moved into it. Only
+// implemented with inotify; on other platforms nothing is ever reported.
+class FileWatcher
+{
+public:
+    FileWatcher(std::string_view directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Returns the names of the files changed since the last call, without
+    // blocking.
+    std::vector<std::string> Poll() const;
+
+private:
+    int32_t _fd;
+    int32_t _watch;
+};
+
+} // namespace Krafter
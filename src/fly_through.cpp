@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "camera.h"
+#include "world.h"
+#include "renderer.h"
+#include "fly_through.h"
+
+namespace Krafter
+{
+
+FlyThrough::FlyThrough(double duration, const std::string& outputPath)
+    : _duration(duration), _outputPath(outputPath), _isStarted(false),
+    _lastGeneratedChunkCount(0), _lastMeshedChunkCount(0), _lastUploadedChunkCount(0)
+{
+}
+
+bool FlyThrough::Update(Camera& camera)
+{
+    // Timed from the first frame rather than from loading.
+    if (!_isStarted)
+    {
+        _timer.Reset();
+        _isStarted = true;
+    }
+
+    const double time = _timer.GetElapsedSeconds();
+    if (time >= _duration)
+    {
+        return false;
+    }
+
+    const glm::vec3 position = GetPosition(time);
+    const glm::vec3 direction = glm::normalize(GetPosition(time + 0.1) - position);
+    camera.SetPosition(position);
+    camera.SetOrientation(glm::atan(direction.z, direction.x), std::asin(direction.y) + PITCH);
+    return true;
+}
+
+void FlyThrough::AddFrame(double cpuMilliseconds, double gpuMilliseconds, double renderMilliseconds, double waitMilliseconds)
+{
+    const uint64_t generatedChunkCount = World::Get()->GetGeneratedChunkCount();
+    const uint64_t meshedChunkCount = Renderer::Get()->GetMeshedChunkCount();
+    const uint64_t uploadedChunkCount = Renderer::Get()->GetUploadedChunkCount();
+
+    _frames.push_back({
+        .cpuMilliseconds = cpuMilliseconds,
+        .gpuMilliseconds = gpuMilliseconds,
+        .renderMilliseconds = renderMilliseconds,
+        .waitMilliseconds = waitMilliseconds,
+        .chunkTriangleCount = Renderer::Get()->GetChunkTriangleCount(),
+        .generatedChunkCount = (uint32_t)(generatedChunkCount - _lastGeneratedChunkCount),
+        .meshedChunkCount = (uint32_t)(meshedChunkCount - _lastMeshedChunkCount),
+        .uploadedChunkCount = (uint32_t)(uploadedChunkCount - _lastUploadedChunkCount),
+        .residentMemory = GetResidentMemory()
+    });
+
+    _lastGeneratedChunkCount = generatedChunkCount;
+    _lastMeshedChunkCount = meshedChunkCount;
+    _lastUploadedChunkCount = uploadedChunkCount;
+}
+
+void FlyThrough::PrintReport() const
+{
+    if (_frames.empty())
+    {
+        std::cout << "[FLY] No frames were rendered" << std::endl;
+        return;
+    }
+
+    if (!_outputPath.empty())
+    {
+        std::ofstream file = std::ofstream(_outputPath);
+        file << "frame,cpu_ms,gpu_ms,render_ms,wait_ms,chunk_triangles,chunks_generated,chunks_meshed,chunks_uploaded,resident_bytes\n";
+        for (size_t i = 0; i < _frames.size(); i++)
+        {
+            const Frame& frame = _frames[i];
+            file << i << ',' << frame.cpuMilliseconds << ',' << frame.gpuMilliseconds << ',' << frame.renderMilliseconds << ',' << frame.waitMilliseconds << ','
+                << frame.chunkTriangleCount << ',' << frame.generatedChunkCount << ',' << frame.meshedChunkCount << ','
+                << frame.uploadedChunkCount << ',' << frame.residentMemory << '\n';
+        }
+        if (!file)
+        {
+            std::cerr << "[FILE] Could not write " << _outputPath << std::endl;
+        }
+    }
+
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    double totalCpuTime = 0.0;
+    double totalGpuTime = 0.0;
+    double totalRenderTime = 0.0;
+    double totalWaitTime = 0.0;
+    uint64_t totalTriangleCount = 0;
+    uint64_t maxTriangleCount = 0;
+    uint64_t generatedChunkCount = 0;
+    uint64_t meshedChunkCount = 0;
+    uint64_t uploadedChunkCount = 0;
+    size_t peakMemory = 0;
+    for (const Frame& frame : _frames)
+    {
+        cpuTimes.push_back(frame.cpuMilliseconds);
+        gpuTimes.push_back(frame.gpuMilliseconds);
+        totalCpuTime += frame.cpuMilliseconds;
+        totalGpuTime += frame.gpuMilliseconds;
+        totalRenderTime += frame.renderMilliseconds;
+        totalWaitTime += frame.waitMilliseconds;
+        totalTriangleCount += frame.chunkTriangleCount;
+        maxTriangleCount = std::max(maxTriangleCount, frame.chunkTriangleCount);
+        generatedChunkCount += frame.generatedChunkCount;
+        meshedChunkCount += frame.meshedChunkCount;
+        uploadedChunkCount += frame.uploadedChunkCount;
+        peakMemory = std::max(peakMemory, frame.residentMemory);
+    }
+    std::sort(cpuTimes.begin(), cpuTimes.end());
+    std::sort(gpuTimes.begin(), gpuTimes.end());
+    const auto percentile = [](const std::vector<double>& sorted, double fraction)
+    {
+        return sorted[std::min((size_t)(fraction * sorted.size()), sorted.size() - 1)];
+    };
+
+    // The frames are timed from polling to submitting, so together they make
+    // up the whole run.
+    const double seconds = totalCpuTime / 1000.0;
+    const double count = (double)_frames.size();
+    std::cout << "[FLY] " << _frames.size() << " frames over " << seconds << " s" << std::endl;
+    std::cout << "[FLY] FPS: avg " << count / seconds << ", 1% low " << 1000.0 / percentile(cpuTimes, 0.99)
+        << ", 99% high " << 1000.0 / percentile(cpuTimes, 0.01) << std::endl;
+    std::cout << "[FLY] CPU frame: avg " << totalCpuTime / count << " ms, p99 " << percentile(cpuTimes, 0.99)
+        << " ms, max " << cpuTimes.back() << " ms" << std::endl;
+    std::cout << "[FLY] GPU frame: avg " << totalGpuTime / count << " ms, p99 " << percentile(gpuTimes, 0.99)
+        << " ms, max " << gpuTimes.back() << " ms" << std::endl;
+    // Next to a CPU frame as long, the render thread is what holds the
+    // frames back; much shorter, it overlaps with the rest of the frame. The
+    // wait is the part of the CPU frame the game thread spent blocked on it.
+    std::cout << "[FLY] Render thread: avg " << totalRenderTime / count << " ms per frame, game thread waited avg "
+        << totalWaitTime / count << " ms" << std::endl;
+    std::cout << "[FLY] Chunk triangles: avg " << totalTriangleCount / _frames.size() << ", max "
+        << maxTriangleCount << " per frame" << std::endl;
+    std::cout << "[FLY] Chunks: " << generatedChunkCount << " generated, " << meshedChunkCount << " meshed, "
+        << uploadedChunkCount << " uploaded" << std::endl;
+    std::cout << "[FLY] Memory: " << _frames.back().residentMemory / (1024.0 * 1024.0) << " MB at the end, "
+        << peakMemory / (1024.0 * 1024.0) << " MB peak" << std::endl;
+}
+
+glm::vec3 FlyThrough::GetPosition(double time)
+{
+    const size_t count = CONTROL_POINTS.size();
+    const double segment = time / SEGMENT_TIME;
+    const size_t index = (size_t)segment;
+    const float t = (float)(segment - index);
+
+    const glm::vec3& p0 = CONTROL_POINTS[(index + count - 1) % count];
+    const glm::vec3& p1 = CONTROL_POINTS[index % count];
+    const glm::vec3& p2 = CONTROL_POINTS[(index + 1) % count];
+    const glm::vec3& p3 = CONTROL_POINTS[(index + 2) % count];
+
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+        (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+size_t FlyThrough::GetResidentMemory()
+{
+#ifdef __linux__
+    std::ifstream file = std::ifstream("/proc/self/statm");
+    size_t totalPages;
+    size_t residentPages;
+    if (file >> totalPages >> residentPages)
+    {
+        return residentPages * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
+
+} // namespace Krafter
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "timer.h"
+
+namespace Krafter
+{
+
+class Camera;
+
+// Flies the camera around a fixed loop over the world for a while, the same
+// way on every machine, and reports how long the frames took on the CPU and
+// the GPU, how long the render thread was busy, how many chunk triangles
+// were drawn, how many chunks were streamed in and how much memory the
+// process used. Started with `krafter --benchmark [seconds]`.
+class FlyThrough
+{
+public:
+    static constexpr double DEFAULT_DURATION = 60.0;
+    // The loop is a closed Catmull-Rom spline through these points, each
+    // segment taking the same time; high enough to stay above the terrain.
+    static constexpr std::array<glm::vec3, 8> CONTROL_POINTS = {
+        glm::vec3(240.0f, 270.0f, 0.0f),
+        glm::vec3(113.0f, 290.0f, 113.0f),
+        glm::vec3(0.0f, 265.0f, 320.0f),
+        glm::vec3(-170.0f, 300.0f, 170.0f),
+        glm::vec3(-240.0f, 270.0f, 0.0f),
+        glm::vec3(-226.0f, 285.0f, -226.0f),
+        glm::vec3(0.0f, 262.0f, -160.0f),
+        glm::vec3(170.0f, 295.0f, -170.0f)
+    };
+    static constexpr double SEGMENT_TIME = 4.0;
+    // Below the direction of flight, to see the terrain.
+    static constexpr float PITCH = -0.35f;
+
+    // Writes every frame to the CSV file as well, if a path is given.
+    FlyThrough(double duration, const std::string& outputPath = "");
+
+    // Places the camera for the time since the start; false once the time
+    // is up.
+    bool Update(Camera& camera);
+    // Once per frame, after submitting it. The CPU time is the game
+    // thread's, including the wait for the render thread, which is also
+    // given on its own along with the render thread's time.
+    void AddFrame(double cpuMilliseconds, double gpuMilliseconds, double renderMilliseconds, double waitMilliseconds);
+    void PrintReport() const;
+
+private:
+    struct Frame
+    {
+        double cpuMilliseconds;
+        double gpuMilliseconds;
+        double renderMilliseconds;
+        double waitMilliseconds;
+        uint64_t chunkTriangleCount;
+        uint32_t generatedChunkCount;
+        uint32_t meshedChunkCount;
+        uint32_t uploadedChunkCount;
+        size_t residentMemory;
+    };
+
+    static glm::vec3 GetPosition(double time);
+    // In bytes, 0 where it cannot be read.
+    static size_t GetResidentMemory();
+
+    double _duration;
+    std::string _outputPath;
+    Timer _timer;
+    bool _isStarted;
+
+    std::vector<Frame> _frames;
+    uint64_t _lastGeneratedChunkCount;
+    uint64_t _lastMeshedChunkCount;
+    uint64_t _lastUploadedChunkCount;
+};
+
+} // namespace Krafter
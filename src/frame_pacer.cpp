@@ -0,0 +1,111 @@
+#include <thread>
+
+#include "glad/gl.h"
+#include "imgui.h"
+
+#include "timer.h"
+#include "window.h"
+#include "render_state.h"
+#include "render_thread.h"
+#include "frame_pacer.h"
+
+namespace Krafter
+{
+
+FramePacer::FramePacer()
+    : _frameRateLimit(0.0f), _isWaitingForGpu(false), _nextFrameTime(0.0), _waitSum(0.0), _waitCount(0), _wait(0.0),
+    _inputTimes{}, _queryTimes{}, _queryGpuTimes{}, _isPending{}, _index(0), _latencySum(0.0), _latencyCount(0),
+    _latency(0.0)
+{
+    glCreateQueries(GL_TIMESTAMP, _presentQueries.size(), _presentQueries.data());
+}
+
+FramePacer::~FramePacer()
+{
+    glDeleteQueries(_presentQueries.size(), _presentQueries.data());
+}
+
+double FramePacer::BeginFrame()
+{
+    const double waitStart = Timer::GetTime();
+
+    if (_frameRateLimit > 0.0f)
+    {
+        const double now = Timer::GetTime();
+        // Behind by more than a frame, the schedule starts over from now
+        // rather than rushing frames out to catch up.
+        _nextFrameTime = glm::max(_nextFrameTime, now - 1.0 / _frameRateLimit);
+        if (_nextFrameTime - now > SPIN_TIME)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(_nextFrameTime - now - SPIN_TIME));
+        }
+        while (Timer::GetTime() < _nextFrameTime)
+        {
+            std::this_thread::yield();
+        }
+        _nextFrameTime += 1.0 / _frameRateLimit;
+    }
+
+    // The render thread waits for the GPU after swapping, when told to.
+    if (_isWaitingForGpu)
+    {
+        RenderThread::Get()->Flush();
+    }
+
+    const double inputTime = Timer::GetTime();
+    _waitSum += inputTime - waitStart;
+    if (++_waitCount == LATENCY_SAMPLES)
+    {
+        _wait = _waitSum / LATENCY_SAMPLES * 1000.0;
+        _waitSum = 0.0;
+        _waitCount = 0;
+    }
+    return inputTime;
+}
+
+void FramePacer::EndFrame(double inputTime, bool isWaitingForGpu)
+{
+    if (isWaitingForGpu)
+    {
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        RenderState::WaitForFence(fence);
+    }
+
+    _index = (_index + 1) % _presentQueries.size();
+    if (_isPending[_index])
+    {
+        int64_t presentTime;
+        glGetQueryObjecti64v(_presentQueries[_index], GL_QUERY_RESULT, &presentTime);
+        const double presentCpuTime = _queryTimes[_index] + (presentTime - _queryGpuTimes[_index]) / 1e9;
+        _latencySum += (presentCpuTime - _inputTimes[_index]) * 1000.0;
+        _isPending[_index] = false;
+
+        if (++_latencyCount == LATENCY_SAMPLES)
+        {
+            _latency = _latencySum / LATENCY_SAMPLES;
+            _latencySum = 0.0;
+            _latencyCount = 0;
+        }
+    }
+
+    _inputTimes[_index] = inputTime;
+    _queryTimes[_index] = Timer::GetTime();
+    glGetInteger64v(GL_TIMESTAMP, &_queryGpuTimes[_index]);
+    glQueryCounter(_presentQueries[_index], GL_TIMESTAMP);
+    _isPending[_index] = true;
+}
+
+void FramePacer::RenderImGui()
+{
+    static const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+    int vsyncMode = (int)Window::Get()->GetVsync();
+    if (ImGui::Combo("Vsync", &vsyncMode, vsyncModes, IM_ARRAYSIZE(vsyncModes)))
+    {
+        RenderThread::Get()->Record([mode = (VsyncMode)vsyncMode] { Window::Get()->SetVsync(mode); });
+    }
+    ImGui::SliderFloat("Frame Limit", &_frameRateLimit, 0.0f, 240.0f, _frameRateLimit > 0.0f ? "%.0f FPS" : "Off");
+    ImGui::Checkbox("Wait for GPU Before Input", &_isWaitingForGpu);
+    ImGui::Text("Input to present: %.2f ms, waited %.2f ms", _latency.load(), _wait);
+}
+
+} // namespace Krafter
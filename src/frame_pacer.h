@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "renderer.h"
+
+namespace Krafter
+{
+
+// Paces the frames of the render loop: limits them to a frame rate, can hold
+// the next one back until the GPU finished the one before so that input is
+// sampled as late as possible, and estimates how long input takes to reach
+// the screen. Made and ended on the render thread, begun and shown on the
+// game thread.
+class FramePacer
+{
+public:
+    // Sleeps overshoot by up to a scheduler tick, so the limiter sleeps this
+    // much short of the deadline and spins the rest.
+    static constexpr double SPIN_TIME = 0.002;
+    // Latency is averaged over this many frames.
+    static constexpr uint32_t LATENCY_SAMPLES = 60;
+
+    FramePacer();
+    ~FramePacer();
+
+    // Right before sampling the input; waits for the frame limit and, if
+    // enabled, for the render thread and the GPU to finish the previous
+    // frame. Returns when the input is sampled, on Timer::GetTime().
+    double BeginFrame();
+    // On the render thread, right after swapping the frame whose input was
+    // sampled at the time; waits for the GPU to finish it if told to.
+    void EndFrame(double inputTime, bool isWaitingForGpu);
+    void RenderImGui();
+
+    // In frames per second, 0 for no limit.
+    inline void SetFrameRateLimit(float frameRateLimit) { _frameRateLimit = frameRateLimit; }
+    inline void SetWaitingForGpu(bool isWaitingForGpu) { _isWaitingForGpu = isWaitingForGpu; }
+    inline bool IsWaitingForGpu() const { return _isWaitingForGpu; }
+
+private:
+    float _frameRateLimit;
+    bool _isWaitingForGpu;
+    double _nextFrameTime;
+    double _waitSum;
+    uint32_t _waitCount;
+    double _wait;
+
+    // A timestamp queried after each swap, which only goes through once the
+    // frame is presented, or at least queued for it, along with when the
+    // input was sampled and both clocks when the query was made, to bring
+    // it over to the CPU's. Read FRAME_COUNT frames later, like GpuTimer.
+    std::array<double, RingBuffer::FRAME_COUNT> _inputTimes;
+    std::array<double, RingBuffer::FRAME_COUNT> _queryTimes;
+    std::array<int64_t, RingBuffer::FRAME_COUNT> _queryGpuTimes;
+    std::array<uint32_t, RingBuffer::FRAME_COUNT> _presentQueries;
+    std::array<bool, RingBuffer::FRAME_COUNT> _isPending;
+    uint32_t _index;
+
+    double _latencySum;
+    uint32_t _latencyCount;
+    std::atomic<double> _latency;
+};
+
+} // namespace Krafter
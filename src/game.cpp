@@ -1,17 +1,59 @@
+#include <iostream>
+#include <thread>
+
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
 #include "window.h"
+#include "thread_pool.h"
+#include "world.h"
+#include "simulation.h"
 #include "renderer.h"
+#include "particle_system.h"
+#include "render_state.h"
+#include "render_thread.h"
 #include "game.h"
 
 namespace Krafter
 {
 
-void Game::Init()
+// Copies the interface ImGui::Render() built, since ImGui::NewFrame() starts
+// its buffers over while the render thread may still be drawing them.
+static ImDrawData* CloneDrawData(const ImDrawData& drawData)
 {
-    _instance = new Game();
+    ImDrawData* clone = new ImDrawData(drawData);
+#if IMGUI_VERSION_NUM < 18980
+    // Until 1.89.8 the draw data did not own its list of draw lists.
+    clone->CmdLists = new ImDrawList*[drawData.CmdListsCount];
+#endif
+    for (int i = 0; i < drawData.CmdListsCount; i++)
+    {
+        clone->CmdLists[i] = drawData.CmdLists[i]->CloneOutput();
+    }
+    return clone;
+}
+
+static void DestroyDrawData(ImDrawData* drawData)
+{
+    if (!drawData)
+    {
+        return;
+    }
+
+    for (int i = 0; i < drawData->CmdListsCount; i++)
+    {
+        IM_DELETE(drawData->CmdLists[i]);
+    }
+#if IMGUI_VERSION_NUM < 18980
+    delete[] drawData->CmdLists;
+#endif
+    delete drawData;
+}
+
+void Game::Init(const GameOptions& options)
+{
+    _instance = new Game(options);
 }
 
 void Game::Deinit()
@@ -21,66 +63,417 @@ void Game::Deinit()
 
 void Game::Run()
 {
-    float lastFrameTime = 0.0f;
+    RenderThread* renderThread = RenderThread::Get();
+    Renderer* renderer = Renderer::Get();
+    double lastFrameTime = Timer::GetTime();
 
-    while (Window::Get()->IsOpen())
+    for (uint64_t frame = 0; Window::Get()->IsOpen(); frame++)
     {
+        // Waiting for the frame limit or the GPU is not part of the frame.
+        const double inputTime = _framePacer->BeginFrame();
+        Timer frameTimer;
         Window::Get()->PollEvents();
+
+        double currentFrameTime = Timer::GetTime();
+        _delta = (float)(currentFrameTime - lastFrameTime);
+        lastFrameTime = currentFrameTime;
+        if (_replay && !_replay->Update(_delta))
+        {
+            break;
+        }
+
         if (Window::Get()->IsKeyDown(Key::ESCAPE))
         {
             Window::Get()->Close();
         }
 
-        float currentFrameTime = Window::Get()->GetTime();
-        _delta = currentFrameTime - lastFrameTime;
-        lastFrameTime = currentFrameTime;
+        Camera& camera = renderer->GetCamera();
+        if (!_flyThrough)
+        {
+            camera.Update();
+        }
+        else if (!_flyThrough->Update(camera))
+        {
+            break;
+        }
+
+        // Walking, the camera is placed between the last two ticks, so it
+        // moves smoothly at any frame rate.
+        const SimulationState& state = Simulation::Get()->GetState();
+        if (!_isFlying)
+        {
+            camera.SetPosition(state.GetPlayerPosition(currentFrameTime) + glm::vec3(0.0f, Player::EYE_HEIGHT, 0.0f));
+        }
+
+        SubmitInput(camera);
+        EmitParticles(state, camera);
+
+        // The render thread works from copies, since the game thread moves
+        // on to the next frame while it renders this one.
+        renderThread->Record([renderer, camera, windowSize = Window::Get()->GetSize(), entities = state.entities,
+            interpolation = state.GetInterpolation(currentFrameTime), delta = _delta]
+        {
+            renderer->ReloadChangedShaders();
+            renderer->UpdateChunkMeshes(camera.GetPosition());
+
+            renderer->BeginFrame(camera, windowSize);
+            renderer->ClearBuffers();
+            renderer->RenderChunkMesh();
+            renderer->RenderEntities(entities, interpolation);
+            renderer->RenderParticles(delta);
+            renderer->EndFrame();
+        });
+
+        if (!_capturePath.empty() && frame == _captureFrame)
+        {
+            renderThread->Record([path = _capturePath, windowSize = Window::Get()->GetSize()]
+            {
+                Window::Get()->Capture(path, windowSize);
+            });
+            Window::Get()->Close();
+        }
 
-        Renderer::Get()->GetCamera().Update();
+        if (_hasImGui)
+        {
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+            ImGui::Begin("Settings");
+            ImGui::Text("FPS: %.2f", 1.0f / _delta);
+            ImGui::Text("Time to first frame: %.2f ms", _timeToFirstFrame);
+            ImGui::Text("Render thread: %.2f ms, waited %.2f ms%s", renderThread->GetExecuteTime(),
+                renderThread->GetWaitTime(), renderThread->IsThreaded() ? "" : " (not threaded)");
+            ImGui::Separator();
+            _framePacer->RenderImGui();
+            ImGui::Separator();
+            renderer->RenderImGui();
+            World::Get()->RenderImGui();
+            ImGui::Separator();
+            Simulation::Get()->RenderImGui(state);
+            RenderEntitiesImGui();
+            RenderParticlesImGui();
+            ImGui::Separator();
+            RenderBlockInteractionImGui(state);
+            ImGui::End();
 
-        ImGui::Begin("Settings");
-        ImGui::Text("FPS: %.2f", 1.0f / _delta);
-        ImGui::Separator();
-        Renderer::Get()->RenderImGui();
-        ImGui::End();
+            ImGui::Render();
 
-        ImGui::Render();
+            // The render thread draws a copy. The packet that drew the one
+            // in this slot ran before the last Submit() returned, so it can
+            // be replaced; copying and freeing both stay on this thread,
+            // like all of ImGui's allocations.
+            _imGuiDrawDataIndex = (_imGuiDrawDataIndex + 1) % RenderThread::PACKET_COUNT;
+            ImDrawData*& drawData = _imGuiDrawData[_imGuiDrawDataIndex];
+            DestroyDrawData(drawData);
+            drawData = CloneDrawData(*ImGui::GetDrawData());
 
-        Renderer::Get()->ClearBuffers();
-        Renderer::Get()->RenderChunkMesh();
+            renderThread->Record([drawData]
+            {
+                ImGui_ImplOpenGL3_NewFrame();
+                ImGui_ImplOpenGL3_RenderDrawData(drawData);
+            });
+        }
+
+        renderThread->Record([framePacer = _framePacer.get(), inputTime, isWaitingForGpu = _framePacer->IsWaitingForGpu()]
+        {
+            RenderState::Invalidate();
+            RenderState::EndFrame();
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        Window::Get()->SwapBuffers();
+            Window::Get()->SwapBuffers();
+            framePacer->EndFrame(inputTime, isWaitingForGpu);
+        });
+        renderThread->Submit();
+
+        if (_replay)
+        {
+            _replay->AddFrameTime(frameTimer.GetElapsedMilliseconds());
+        }
+        if (_flyThrough)
+        {
+            _flyThrough->AddFrame(frameTimer.GetElapsedMilliseconds(), renderer->GetGpuFrameTime(),
+                renderThread->GetExecuteTime(), renderThread->GetWaitTime());
+        }
+
+        if (_timeToFirstFrame == 0.0)
+        {
+            renderThread->Flush();
+            _timeToFirstFrame = _startupTimer.GetElapsedMilliseconds();
+            std::cout << "[TIMER] Time to first frame: " << _timeToFirstFrame << " ms" << std::endl;
+        }
+    }
+
+    if (_replay)
+    {
+        _replay->PrintReport();
+    }
+    if (_flyThrough)
+    {
+        _flyThrough->PrintReport();
     }
 }
 
-Game::Game()
-    : _delta(0.0f)
+void Game::SubmitInput(Camera& camera)
 {
-    Window::Init();
-    Renderer::Init();
+    const Window* window = Window::Get();
 
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGui::StyleColorsDark();
+    if (window->IsKeyDown(Key::F) && _isFlyKeyReleased && camera.IsControlled())
+    {
+        _isFlying = !_isFlying;
+        camera.SetFlying(_isFlying);
+    }
+    _isFlyKeyReleased = !window->IsKeyDown(Key::F);
 
-    ImGuiIO& io = ImGui::GetIO();
-    io.IniFilename = "assets/editorconfig.ini";
+    bool isLeftMouseDown = window->IsMouseButtonDown(MouseButton::LEFT);
+    bool isRightMouseDown = window->IsMouseButtonDown(MouseButton::RIGHT);
+    _breakCount += isLeftMouseDown && _isLeftMouseReleased;
+    _placeCount += isRightMouseDown && _isRightMouseReleased;
+    _isLeftMouseReleased = !isLeftMouseDown;
+    _isRightMouseReleased = !isRightMouseDown;
 
-    ImGui_ImplGlfw_InitForOpenGL(Window::Get()->GetId(), true);
-    ImGui_ImplOpenGL3_Init("#version 450 core");
+    SimulationInput input = {
+        .player = {
+            .cameraPosition = camera.GetPosition(),
+            .cameraDirection = camera.GetDirection(),
+            .isFlying = _isFlying
+        },
+        .isControlled = camera.IsControlled(),
+        .breakCount = _breakCount,
+        .placeCount = _placeCount,
+        .placedBlock = (Block)_placedBlock,
+        .spawnCount = _spawnCount
+    };
+
+    if (camera.IsControlled())
+    {
+        if (window->IsKeyDown(Key::W))
+        {
+            input.player.movement.y += 1.0f;
+        }
+        if (window->IsKeyDown(Key::S))
+        {
+            input.player.movement.y -= 1.0f;
+        }
+        if (window->IsKeyDown(Key::D))
+        {
+            input.player.movement.x += 1.0f;
+        }
+        if (window->IsKeyDown(Key::A))
+        {
+            input.player.movement.x -= 1.0f;
+        }
+        input.player.isJumping = window->IsKeyDown(Key::E);
+    }
+
+    Simulation::Get()->SubmitInput(input);
+}
+
+void Game::RenderEntitiesImGui()
+{
+    if (ImGui::Button("Spawn 1000 Mobs"))
+    {
+        _spawnCount += 1000;
+    }
+}
+
+void Game::Emit(const ParticleEmitter& emitter)
+{
+    RenderThread::Get()->Record([emitter] { Renderer::Get()->GetParticles().Emit(emitter); });
+}
+
+void Game::EmitParticles(const SimulationState& state, const Camera& camera)
+{
+    for (const BrokenBlock& brokenBlock : state.brokenBlocks)
+    {
+        if (brokenBlock.sequence <= _lastBrokenBlock)
+        {
+            continue;
+        }
+
+        Emit({
+            .position = glm::vec4(glm::vec3(brokenBlock.position) + 0.5f, 0.4f),
+            .velocity = glm::vec4(0.0f, 3.0f, 0.0f, 3.0f),
+            .count = 64,
+            .layer = BlockAtlas::GetAtlasOf(brokenBlock.block).side,
+            .tint = 0xFFFFFFFF,
+            .life = 1.5f,
+            .size = 0.15f,
+            .gravity = -20.0f,
+            .seed = brokenBlock.sequence * 0x9E3779B9u,
+            .padding = 0.0f
+        });
+        _lastBrokenBlock = brokenBlock.sequence;
+    }
+
+    // Whole particles per frame, with the fraction carried over.
+    _ambientParticleDebt += _ambientParticleRate * _delta;
+    const uint32_t ambientCount = (uint32_t)_ambientParticleDebt;
+    _ambientParticleDebt -= ambientCount;
+    if (ambientCount > 0)
+    {
+        Emit({
+            .position = glm::vec4(camera.GetPosition(), 24.0f),
+            .velocity = glm::vec4(0.0f, 0.2f, 0.0f, 0.5f),
+            .count = ambientCount,
+            .layer = BlockAtlas::GetAtlasOf(Block::LAMP).side,
+            .tint = 0xFFFFFFFF,
+            .life = 8.0f,
+            .size = 0.06f,
+            .gravity = -0.1f,
+            .seed = ++_particleSeed * 0x9E3779B9u,
+            .padding = 0.0f
+        });
+    }
+}
+
+void Game::RenderParticlesImGui()
+{
+    ImGui::SliderFloat("Ambient Particles/s", &_ambientParticleRate, 0.0f, 20000.0f, "%.0f");
+    if (ImGui::Button("Particle Burst"))
+    {
+        const Camera& camera = Renderer::Get()->GetCamera();
+        Emit({
+            .position = glm::vec4(camera.GetPosition() + camera.GetDirection() * 8.0f, 1.0f),
+            .velocity = glm::vec4(0.0f, 6.0f, 0.0f, 8.0f),
+            .count = 20000,
+            .layer = BlockAtlas::GetAtlasOf(Block::GRASS).side,
+            .tint = 0xFFFFFFFF,
+            .life = 4.0f,
+            .size = 0.1f,
+            .gravity = -20.0f,
+            .seed = ++_particleSeed * 0x9E3779B9u,
+            .padding = 0.0f
+        });
+    }
+}
+
+void Game::RenderBlockInteractionImGui(const SimulationState& state)
+{
+    static const char* blockNames[] = { "Dirt", "Grass", "Lamp", "Water", "Glass", "Leaves" };
+
+    ImGui::Text("Block Interaction (F to %s, E to jump):", _isFlying ? "walk" : "fly");
+    int32_t placedBlockIndex = _placedBlock - 1;
+    if (ImGui::Combo("Placed Block", &placedBlockIndex, blockNames, IM_ARRAYSIZE(blockNames)))
+    {
+        _placedBlock = placedBlockIndex + 1;
+    }
+
+    if (state.target)
+    {
+        const RaycastHit& target = *state.target;
+        ImGui::Text("Target: %d, %d, %d (%s), %.2f away", target.position.x, target.position.y, target.position.z,
+            blockNames[(size_t)target.block - 1], target.distance);
+    }
+    else
+    {
+        ImGui::Text("Target: none");
+    }
+}
+
+Game::Game(const GameOptions& options)
+    : _timeToFirstFrame(0.0), _delta(0.0f), _capturePath(options.capturePath),
+    _captureFrame(options.captureFrame), _hasImGui(false), _imGuiDrawData{}, _imGuiDrawDataIndex(0), _isFlying(true), _isFlyKeyReleased(true),
+    _placedBlock((int32_t)Block::DIRT), _breakCount(0), _placeCount(0), _spawnCount(0),
+    _isLeftMouseReleased(true), _isRightMouseReleased(true), _lastBrokenBlock(0), _ambientParticleRate(200.0f),
+    _ambientParticleDebt(0.0f), _particleSeed(0)
+{
+    Window::Init(options.windowMode);
+    _hasImGui = !Window::Get()->IsHeadless();
+
+    if (!options.recordPath.empty() || !options.playbackPath.empty())
+    {
+        const bool isRecording = !options.recordPath.empty();
+        _replay = std::make_unique<Replay>(isRecording ? options.recordPath : options.playbackPath,
+            isRecording ? Replay::Mode::RECORD : Replay::Mode::PLAYBACK, options.fixedDelta);
+        if (!_replay->IsValid())
+        {
+            _replay.reset();
+        }
+    }
+
+    VsyncMode vsyncMode = options.vsyncMode;
+    if (options.flyThroughDuration > 0.0)
+    {
+        _flyThrough = std::make_unique<FlyThrough>(options.flyThroughDuration, options.flyThroughOutputPath);
+        vsyncMode = VsyncMode::OFF;
+    }
+
+    const bool isDynamicResolution = options.isDynamicResolution && !_flyThrough && _capturePath.empty() &&
+        options.playbackPath.empty();
+
+    ThreadPool::Init();
+    World::Init();
+
+    if (_hasImGui)
+    {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGui::StyleColorsDark();
+
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = "assets/editorconfig.ini";
+
+        ImGui_ImplGlfw_InitForOpenGL(Window::Get()->GetId(), true);
+    }
+
+    // Everything touching GL is made on the render thread, which has the
+    // context from here on. With a single hardware thread there is nothing
+    // to overlap with, and switching between the two only costs.
+    RenderThread::Init(options.isRenderThreaded && std::thread::hardware_concurrency() > 1);
+    RenderThread::Get()->Record([this, vsyncMode, isDynamicResolution]
+    {
+        Window::Get()->SetVsync(vsyncMode);
+        Renderer::Init();
+        Renderer::Get()->SetDynamicResolution(isDynamicResolution);
+        _framePacer = std::make_unique<FramePacer>();
+
+        if (_hasImGui)
+        {
+            ImGui_ImplOpenGL3_Init("#version 450 core");
+            // Builds the font texture before the first frame asks for it.
+            ImGui_ImplOpenGL3_NewFrame();
+        }
+    });
+    RenderThread::Get()->Submit();
+    RenderThread::Get()->Flush();
+
+    _framePacer->SetFrameRateLimit(options.frameRateLimit);
+    _framePacer->SetWaitingForGpu(options.isWaitingForGpu);
+
+    Simulation::Init();
 }
 
 Game::~Game()
 {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    // Stopping the render thread's last frame, then the simulation and then
+    // the workers first guarantees nothing still refers to the world or the
+    // renderer.
+    RenderThread::Get()->Flush();
+    Simulation::Deinit();
+    ThreadPool::Deinit();
+
+    RenderThread::Get()->Record([this]
+    {
+        if (_hasImGui)
+        {
+            ImGui_ImplOpenGL3_Shutdown();
+        }
+        _framePacer.reset();
+        Renderer::Deinit();
+    });
+    RenderThread::Deinit();
+
+    if (_hasImGui)
+    {
+        for (ImDrawData* drawData : _imGuiDrawData)
+        {
+            DestroyDrawData(drawData);
+        }
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
-    Renderer::Deinit();
+    World::Deinit();
+    _replay.reset();
     Window::Deinit();
 }
 
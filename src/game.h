@@ -1,12 +1,60 @@
 #pragma once
 
+#include <string>
+#include <memory>
+#include <array>
+
+#include "timer.h"
+#include "window.h"
+#include "simulation.h"
+#include "replay.h"
+#include "fly_through.h"
+#include "frame_pacer.h"
+#include "particle_system.h"
+#include "render_thread.h"
+
+struct ImDrawData;
+
 namespace Krafter
 {
 
+class Camera;
+
+struct GameOptions
+{
+    // Records the input to the file, or plays it back from it instead of
+    // reading the devices; empty for neither.
+    std::string recordPath;
+    std::string playbackPath;
+    // Played back, every frame advances the game by this many seconds
+    // instead of the recorded delta, if not 0.
+    float fixedDelta = 0.0f;
+    WindowMode windowMode = WindowMode::VISIBLE;
+    VsyncMode vsyncMode = VsyncMode::ON;
+    // See FramePacer.
+    float frameRateLimit = 0.0f;
+    bool isWaitingForGpu = false;
+    // Submits GL from a thread of its own while the next frame is prepared,
+    // if there is more than one hardware thread; see RenderThread.
+    bool isRenderThreaded = true;
+    // Scales the scene's resolution to hold the frame time; see Renderer.
+    // Always off when benchmarking, capturing or playing back, which have to
+    // be comparable between runs.
+    bool isDynamicResolution = false;
+    // Flies the camera around for this many seconds with vsync off and
+    // reports the frame times, if not 0; see FlyThrough.
+    double flyThroughDuration = 0.0;
+    std::string flyThroughOutputPath;
+    // Writes the scene of that frame, without the interface, to a PNG file
+    // and quits, if a path is given.
+    std::string capturePath;
+    uint64_t captureFrame = 0;
+};
+
 class Game
 {
 public:
-    static void Init();
+    static void Init(const GameOptions& options = {});
     static void Deinit();
     inline static Game* Get() { return _instance; }
 
@@ -16,10 +64,50 @@ public:
 private:
     inline static Game* _instance;
 
-    Game();
+    Game(const GameOptions& options);
     ~Game();
 
+    // Samples the keyboard and mouse for the next simulation tick; only the
+    // game thread, which opened the window, may touch its input.
+    void SubmitInput(Camera& camera);
+    void RenderBlockInteractionImGui(const SimulationState& state);
+    void RenderEntitiesImGui();
+    // The particles belong to the render thread, so emitters are recorded
+    // for it.
+    void Emit(const ParticleEmitter& emitter);
+    // Bursts where blocks were broken and a drift of motes around the camera.
+    void EmitParticles(const SimulationState& state, const Camera& camera);
+    void RenderParticlesImGui();
+
+    Timer _startupTimer;
+    double _timeToFirstFrame;
+
     float _delta;
+    std::unique_ptr<Replay> _replay;
+    std::string _capturePath;
+    uint64_t _captureFrame;
+    // There is no interface without a window to take its input from.
+    bool _hasImGui;
+    // Copies of the interface for the packets in flight; see Run().
+    std::array<ImDrawData*, RenderThread::PACKET_COUNT> _imGuiDrawData;
+    uint32_t _imGuiDrawDataIndex;
+    std::unique_ptr<FlyThrough> _flyThrough;
+    std::unique_ptr<FramePacer> _framePacer;
+
+    bool _isFlying;
+    bool _isFlyKeyReleased;
+
+    int32_t _placedBlock;
+    uint32_t _breakCount;
+    uint32_t _placeCount;
+    uint32_t _spawnCount;
+    bool _isLeftMouseReleased;
+    bool _isRightMouseReleased;
+
+    uint32_t _lastBrokenBlock;
+    float _ambientParticleRate;
+    float _ambientParticleDebt;
+    uint32_t _particleSeed;
 };
 
 } // namespace Krafter
\ No newline at end of file
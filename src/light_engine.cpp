@@ -0,0 +1,323 @@
+#include "world.h"
+#include "light_engine.h"
+
+namespace Krafter
+{
+
+static constexpr glm::ivec3 NEIGHBORS[] = {
+    glm::ivec3(-1, 0, 0), glm::ivec3(1, 0, 0),
+    glm::ivec3(0, 0, -1), glm::ivec3(0, 0, 1),
+    glm::ivec3(0, -1, 0), glm::ivec3(0, 1, 0)
+};
+static constexpr size_t DOWN = 4;
+
+void LightEngine::LightChunk(Chunk& chunk)
+{
+    LightEngine engine = LightEngine(chunk);
+
+    // Every column is fully lit down to its first opaque block.
+    int32_t heights[Chunk::WIDTH][Chunk::WIDTH];
+    for (int32_t x = 0; x < Chunk::WIDTH; x++)
+    {
+        for (int32_t z = 0; z < Chunk::WIDTH; z++)
+        {
+            int32_t y = Chunk::HEIGHT - 1;
+            for (; y >= 0 && !BlockInfo::GetInfoOf(chunk.GetBlock(glm::ivec3(x, y, z))).isOpaque; y--)
+            {
+                chunk.SetSkyLight(glm::ivec3(x, y, z), Chunk::MAX_LIGHT);
+            }
+            heights[x][z] = y;
+        }
+    }
+
+    // Sky light only has to spread sideways from where a column is lit but
+    // its neighbor is not yet, which is between the two surfaces.
+    for (int32_t x = 0; x < Chunk::WIDTH; x++)
+    {
+        for (int32_t z = 0; z < Chunk::WIDTH; z++)
+        {
+            int32_t top = heights[x][z];
+            for (size_t k = 0; k < 4; k++)
+            {
+                int32_t nx = x + NEIGHBORS[k].x;
+                int32_t nz = z + NEIGHBORS[k].z;
+                if (nx >= 0 && nx < Chunk::WIDTH && nz >= 0 && nz < Chunk::WIDTH)
+                {
+                    top = glm::max(top, heights[nx][nz]);
+                }
+            }
+
+            for (int32_t y = heights[x][z] + 1; y <= top; y++)
+            {
+                engine._addQueue.push_back(glm::ivec3(x, y, z));
+            }
+        }
+    }
+    engine.PropagateAdd(Channel::SKY);
+
+    for (int32_t y = 0; y < Chunk::HEIGHT; y++)
+    {
+        for (int32_t z = 0; z < Chunk::WIDTH; z++)
+        {
+            for (int32_t x = 0; x < Chunk::WIDTH; x++)
+            {
+                uint8_t emission = BlockInfo::GetInfoOf(chunk.GetBlock(glm::ivec3(x, y, z))).lightEmission;
+                if (emission > 0)
+                {
+                    chunk.SetBlockLight(glm::ivec3(x, y, z), emission);
+                    engine._addQueue.push_back(glm::ivec3(x, y, z));
+                }
+            }
+        }
+    }
+    engine.PropagateAdd(Channel::BLOCK);
+}
+
+LightEngine::LightEngine(World& world)
+    : _world(&world), _chunk(nullptr), _cachedChunk(nullptr)
+{
+}
+
+LightEngine::LightEngine(Chunk& chunk)
+    : _world(nullptr), _chunk(&chunk), _cachedChunk(nullptr)
+{
+}
+
+void LightEngine::StitchChunk(const glm::ivec2& chunkCoords)
+{
+    _cachedChunk = nullptr;
+
+    const glm::ivec3 origin = glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH;
+    const int32_t last = Chunk::WIDTH - 1;
+
+    // Seeds both sides of every border; light only ever grows here, so
+    // whichever side is brighter spreads into the other.
+    for (Channel channel : { Channel::SKY, Channel::BLOCK })
+    {
+        for (size_t k = 0; k < 4; k++)
+        {
+            const glm::ivec3& direction = NEIGHBORS[k];
+            if (!_world->FindChunk(chunkCoords + glm::ivec2(direction.x, direction.z)))
+            {
+                continue;
+            }
+
+            for (int32_t side = 0; side < 2; side++)
+            {
+                for (int32_t i = 0; i < Chunk::WIDTH; i++)
+                {
+                    glm::ivec3 border = direction.x != 0
+                        ? glm::ivec3(direction.x < 0 ? 0 : last, 0, i)
+                        : glm::ivec3(i, 0, direction.z < 0 ? 0 : last);
+                    glm::ivec3 position = origin + border + direction * side;
+
+                    for (; position.y < Chunk::HEIGHT; position.y++)
+                    {
+                        if (GetLight(channel, position) > 1)
+                        {
+                            _addQueue.push_back(position);
+                        }
+                    }
+                }
+            }
+        }
+
+        PropagateAdd(channel);
+    }
+}
+
+void LightEngine::UpdateBlock(const glm::ivec3& position)
+{
+    _cachedChunk = nullptr;
+
+    glm::ivec3 coords;
+    Chunk* chunk = GetChunkAt(position, coords);
+    if (!chunk)
+    {
+        return;
+    }
+
+    const BlockInfo& info = BlockInfo::GetInfoOf(chunk->GetBlock(coords));
+
+    for (Channel channel : { Channel::SKY, Channel::BLOCK })
+    {
+        // Whatever light passed through or came from the old block is taken
+        // away first; the removal re-queues the light around it that still
+        // holds.
+        uint8_t light = GetLight(channel, position);
+        if (light > 0 && (info.isOpaque || channel == Channel::BLOCK))
+        {
+            SetLight(channel, position, 0);
+            _removeQueue.push_back({ position, light });
+            PropagateRemove(channel);
+        }
+
+        if (channel == Channel::BLOCK && info.lightEmission > 0)
+        {
+            SetLight(channel, position, info.lightEmission);
+            _addQueue.push_back(position);
+        }
+
+        // Nothing above the world blocks the sky.
+        if (channel == Channel::SKY && !info.isOpaque && position.y == Chunk::HEIGHT - 1)
+        {
+            SetLight(channel, position, Chunk::MAX_LIGHT);
+            _addQueue.push_back(position);
+        }
+
+        if (!info.isOpaque)
+        {
+            for (const glm::ivec3& direction : NEIGHBORS)
+            {
+                if (GetLight(channel, position + direction) > 0)
+                {
+                    _addQueue.push_back(position + direction);
+                }
+            }
+        }
+
+        PropagateAdd(channel);
+    }
+}
+
+Chunk* LightEngine::GetChunkAt(const glm::ivec3& position, glm::ivec3& coords)
+{
+    if (position.y < 0 || position.y >= Chunk::HEIGHT)
+    {
+        return nullptr;
+    }
+
+    glm::ivec2 chunkCoords = World::GetChunkCoords(position);
+    if (!_cachedChunk || chunkCoords != _cachedCoords)
+    {
+        if (_world)
+        {
+            _cachedChunk = _world->FindChunk(chunkCoords);
+        }
+        else
+        {
+            _cachedChunk = chunkCoords == _chunk->GetPosition() / (int32_t)Chunk::WIDTH ? _chunk : nullptr;
+        }
+        _cachedCoords = chunkCoords;
+    }
+
+    coords = position - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH;
+    return _cachedChunk;
+}
+
+uint8_t LightEngine::GetLight(Channel channel, const glm::ivec3& position)
+{
+    glm::ivec3 coords;
+    Chunk* chunk = GetChunkAt(position, coords);
+    if (!chunk)
+    {
+        return 0;
+    }
+
+    return channel == Channel::SKY ? chunk->GetSkyLight(coords) : chunk->GetBlockLight(coords);
+}
+
+void LightEngine::SetLight(Channel channel, const glm::ivec3& position, uint8_t value)
+{
+    glm::ivec3 coords;
+    Chunk* chunk = GetChunkAt(position, coords);
+
+    if (channel == Channel::SKY)
+    {
+        chunk->SetSkyLight(coords, value);
+    }
+    else
+    {
+        chunk->SetBlockLight(coords, value);
+    }
+
+    // Meshes of the neighbors sample the light along their borders too.
+    if (_world && (coords.x == 0 || coords.x == Chunk::WIDTH - 1 || coords.z == 0 || coords.z == Chunk::WIDTH - 1))
+    {
+        _world->MarkBorderChanged(position);
+    }
+}
+
+void LightEngine::PropagateAdd(Channel channel)
+{
+    for (size_t i = 0; i < _addQueue.size(); i++)
+    {
+        const glm::ivec3 position = _addQueue[i];
+        const uint8_t light = GetLight(channel, position);
+        if (light == 0)
+        {
+            continue;
+        }
+
+        for (size_t k = 0; k < 6; k++)
+        {
+            glm::ivec3 neighbor = position + NEIGHBORS[k];
+            glm::ivec3 coords;
+            Chunk* chunk = GetChunkAt(neighbor, coords);
+            if (!chunk || BlockInfo::GetInfoOf(chunk->GetBlock(coords)).isOpaque)
+            {
+                continue;
+            }
+
+            uint8_t target = channel == Channel::SKY && k == DOWN && light == Chunk::MAX_LIGHT ? light : light - 1;
+            uint8_t current = channel == Channel::SKY ? chunk->GetSkyLight(coords) : chunk->GetBlockLight(coords);
+            if (current < target)
+            {
+                SetLight(channel, neighbor, target);
+                _addQueue.push_back(neighbor);
+            }
+        }
+    }
+
+    _addQueue.clear();
+}
+
+void LightEngine::PropagateRemove(Channel channel)
+{
+    for (size_t i = 0; i < _removeQueue.size(); i++)
+    {
+        const RemovalNode node = _removeQueue[i];
+
+        for (size_t k = 0; k < 6; k++)
+        {
+            glm::ivec3 neighbor = node.position + NEIGHBORS[k];
+            glm::ivec3 coords;
+            Chunk* chunk = GetChunkAt(neighbor, coords);
+            if (!chunk)
+            {
+                continue;
+            }
+
+            uint8_t current = channel == Channel::SKY ? chunk->GetSkyLight(coords) : chunk->GetBlockLight(coords);
+            if (current == 0)
+            {
+                continue;
+            }
+
+            // Light that could have come from the removed node goes too,
+            // anything brighter has another source and refills the gap.
+            bool isDependent = current < node.light ||
+                (channel == Channel::SKY && k == DOWN && node.light == Chunk::MAX_LIGHT);
+            if (isDependent)
+            {
+                SetLight(channel, neighbor, 0);
+                _removeQueue.push_back({ neighbor, current });
+
+                uint8_t emission = BlockInfo::GetInfoOf(chunk->GetBlock(coords)).lightEmission;
+                if (channel == Channel::BLOCK && emission > 0)
+                {
+                    SetLight(channel, neighbor, emission);
+                    _addQueue.push_back(neighbor);
+                }
+            }
+            else
+            {
+                _addQueue.push_back(neighbor);
+            }
+        }
+    }
+
+    _removeQueue.clear();
+}
+
+} // namespace Krafter
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "block.h"
+
+namespace Krafter
+{
+
+class World;
+
+// Flood fills sky and block light through transparent blocks. Sky light
+// keeps its full strength going straight down; everything else loses one
+// level per block.
+class LightEngine
+{
+public:
+    // Lights a freshly generated chunk as if it had no neighbors. It only
+    // touches the chunk itself, so it can run on any thread before the chunk
+    // is added to the world.
+    static void LightChunk(Chunk& chunk);
+
+    LightEngine(World& world);
+
+    // Spreads light across the borders between a chunk that was just added
+    // to the world and its loaded neighbors, in both directions.
+    void StitchChunk(const glm::ivec2& chunkCoords);
+
+    // Relights around a block that was just changed.
+    void UpdateBlock(const glm::ivec3& position);
+
+private:
+    enum class Channel
+    {
+        SKY,
+        BLOCK
+    };
+
+    struct RemovalNode
+    {
+        glm::ivec3 position;
+        uint8_t light;
+    };
+
+    LightEngine(Chunk& chunk);
+
+    Chunk* GetChunkAt(const glm::ivec3& position, glm::ivec3& coords);
+    uint8_t GetLight(Channel channel, const glm::ivec3& position);
+    void SetLight(Channel channel, const glm::ivec3& position, uint8_t value);
+
+    void PropagateAdd(Channel channel);
+    void PropagateRemove(Channel channel);
+
+    // Either the whole world or a single chunk that is not part of it yet.
+    World* _world;
+    Chunk* _chunk;
+
+    glm::ivec2 _cachedCoords;
+    Chunk* _cachedChunk;
+
+    std::vector<glm::ivec3> _addQueue;
+    std::vector<RemovalNode> _removeQueue;
+};
+
+} // namespace Krafter
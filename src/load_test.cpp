@@ -0,0 +1,127 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "timer.h"
+#include "server.h"
+#include "network_client.h"
+#include "load_test.h"
+
+namespace Krafter
+{
+
+bool LoadTest::Run(uint32_t clientCount, double duration)
+{
+    Server::Init(0, "", VIEW_DISTANCE);
+    if (!Server::Get()->IsListening())
+    {
+        Server::Deinit();
+        return false;
+    }
+    std::thread serverThread = std::thread([] { Server::Get()->Run(); });
+
+    std::vector<std::unique_ptr<NetworkClient>> clients;
+    for (uint32_t i = 0; i < clientCount; i++)
+    {
+        clients.push_back(std::make_unique<NetworkClient>(Socket::Address { Socket::LOOPBACK, Server::Get()->GetPort() }));
+    }
+
+    std::mt19937 random = std::mt19937(1);
+    std::uniform_int_distribution<int32_t> offset = std::uniform_int_distribution<int32_t>(-4, 4);
+
+    Timer timer;
+    double nextUpdate = 0.0;
+    double nextEdit = EDIT_INTERVAL;
+    double nextReport = 1.0;
+    uint32_t sequence = 0;
+    while (timer.GetElapsedSeconds() < duration)
+    {
+        const double time = timer.GetElapsedSeconds();
+        if (time < nextUpdate)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(nextUpdate - time));
+            continue;
+        }
+        nextUpdate += UPDATE_INTERVAL;
+        sequence++;
+
+        // Each client walks its own circle, so together they spread over
+        // more chunks than any one of them sees.
+        const bool isEditing = time >= nextEdit;
+        for (uint32_t i = 0; i < clients.size(); i++)
+        {
+            NetworkClient& client = *clients[i];
+            client.Update();
+
+            const float radius = 16.0f + 8.0f * (i % 8);
+            const float angle = WALK_SPEED * (float)time / radius + 6.2831853f * i / clients.size();
+            const glm::vec3 position = client.GetSpawnPosition() + glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle)) * radius;
+            // Flying, looking where it goes along the circle.
+            const PlayerCommand command = {
+                .sequence = sequence,
+                .yaw = angle + 1.5707963f,
+                .pitch = 0.0f,
+                .movement = glm::vec2(0.0f),
+                .isJumping = false,
+                .isFlying = true,
+                .cameraPosition = position
+            };
+            client.SendCommands(std::span<const PlayerCommand>(&command, 1));
+
+            if (isEditing && client.HasJoined())
+            {
+                const glm::ivec3 target = glm::ivec3(glm::floor(position)) + glm::ivec3(offset(random), offset(random) - 64, offset(random));
+                client.SendBlockEdit(target, random() % 2 ? Block::AIR : Block::LAMP);
+            }
+        }
+        if (isEditing)
+        {
+            nextEdit += EDIT_INTERVAL;
+        }
+
+        if (time >= nextReport)
+        {
+            const ServerStats stats = Server::Get()->GetStats();
+            std::cout << "[LOAD] " << (uint32_t)time << " s: " << stats.clientCount << " clients, "
+                << stats.totalTickTime / glm::max(stats.tickCount, (uint64_t)1) << " ms per tick, "
+                << stats.chunksSent << " chunks sent, " << stats.queuedChunks << " queued" << std::endl;
+            nextReport += 1.0;
+        }
+    }
+
+    const ServerStats stats = Server::Get()->GetStats();
+    Server::Get()->Stop();
+    serverThread.join();
+
+    uint64_t chunkCount = 0;
+    uint64_t blockChangeCount = 0;
+    uint32_t connectedCount = 0;
+    for (const std::unique_ptr<NetworkClient>& client : clients)
+    {
+        chunkCount += client->GetReceivedChunkCount();
+        blockChangeCount += client->GetReceivedBlockChangeCount();
+        connectedCount += client->IsConnected();
+    }
+    clients.clear();
+    Server::Deinit();
+
+    const double seconds = timer.GetElapsedSeconds();
+    std::cout << "[LOAD] " << clientCount << " clients over " << seconds << " s, " << connectedCount << " still connected" << std::endl;
+    std::cout << "[LOAD] Tick: avg " << stats.totalTickTime / glm::max(stats.tickCount, (uint64_t)1) << " ms, max "
+        << stats.maxTickTime << " ms over " << stats.tickCount << " ticks" << std::endl;
+    std::cout << "[LOAD] Sent: " << stats.bytesSent / seconds / 1024.0 << " KiB/s, "
+        << stats.bytesSent / seconds / 1024.0 / clientCount << " KiB/s per client, "
+        << stats.bytesSent / glm::max(stats.chunksSent, (uint64_t)1) << " B per chunk" << std::endl;
+    std::cout << "[LOAD] Received: " << stats.bytesReceived / seconds / 1024.0 << " KiB/s" << std::endl;
+    std::cout << "[LOAD] Chunks: " << stats.chunksSent << " sent, " << chunkCount << " received, "
+        << stats.cancelledChunks << " cancelled, " << stats.queuedChunks << " still queued" << std::endl;
+    std::cout << "[LOAD] Time to visible: avg " << stats.totalTimeToVisible / glm::max(stats.chunksSent, (uint64_t)1)
+        << " ms, max " << stats.maxTimeToVisible << " ms" << std::endl;
+    std::cout << "[LOAD] Block changes: " << stats.blockChanges << " applied, " << blockChangeCount << " received" << std::endl;
+
+    return true;
+}
+
+} // namespace Krafter
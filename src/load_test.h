@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Krafter
+{
+
+// Runs a server on loopback with synthetic clients walking circles around
+// the spawn and editing blocks as they go, and reports the server's tick
+// time and bandwidth. Started with `krafter_server --load-test <clients>
+// [seconds]`.
+class LoadTest
+{
+public:
+    static constexpr int32_t VIEW_DISTANCE = 8;
+    static constexpr double UPDATE_INTERVAL = 0.05;
+    static constexpr double EDIT_INTERVAL = 0.5;
+    static constexpr float WALK_SPEED = 4.3f;
+
+    // Returns false if the server could not be started.
+    static bool Run(uint32_t clientCount, double duration);
+};
+
+} // namespace Krafter
@@ -1,10 +1,114 @@
+#include <string>
+#include <iostream>
+#include <charconv>
+#include <cstring>
+
+#include "benchmark.h"
 #include "game.h"
 
+// Unlike std::stof and friends, fails instead of throwing, and on trailing
+// characters too.
+template<typename T>
+static bool ParseNumber(const char* text, T& value)
+{
+    const char* end = text + std::strlen(text);
+    const std::from_chars_result result = std::from_chars(text, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
 int main(int argc, char** argv)
 {
-    Krafter::Game::Init();
+    if (argc >= 3 && std::string(argv[1]) == "--bench")
+    {
+        return Krafter::Benchmark::Run(argv[2]) ? 0 : 1;
+    }
+
+    // `krafter [--record <file> | --playback <file> [--fixed-delta <seconds>]]
+    // [--benchmark [seconds] [--benchmark-output <file.csv>]]
+    // [--capture <file.png> <frame>] [--hidden | --headless]
+    // [--vsync off|on|adaptive] [--frame-limit <fps>] [--wait-for-gpu]
+    // [--no-render-thread] [--dynamic-resolution]`.
+    // Headless needs neither a display nor a GPU, with Mesa's llvmpipe; a
+    // hidden window still needs a display, but no GPU with
+    // LIBGL_ALWAYS_SOFTWARE=1.
+    Krafter::GameOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        bool isValid = true;
+        if (argument == "--record" && i + 1 < argc)
+        {
+            options.recordPath = argv[++i];
+        }
+        else if (argument == "--playback" && i + 1 < argc)
+        {
+            options.playbackPath = argv[++i];
+        }
+        else if (argument == "--fixed-delta" && i + 1 < argc)
+        {
+            isValid = ParseNumber(argv[++i], options.fixedDelta);
+        }
+        else if (argument == "--benchmark")
+        {
+            const bool hasDuration = i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0;
+            options.flyThroughDuration = Krafter::FlyThrough::DEFAULT_DURATION;
+            isValid = !hasDuration || ParseNumber(argv[++i], options.flyThroughDuration);
+        }
+        else if (argument == "--benchmark-output" && i + 1 < argc)
+        {
+            options.flyThroughOutputPath = argv[++i];
+        }
+        else if (argument == "--capture" && i + 2 < argc)
+        {
+            options.capturePath = argv[++i];
+            isValid = ParseNumber(argv[++i], options.captureFrame);
+        }
+        else if (argument == "--vsync" && i + 1 < argc)
+        {
+            const std::string mode = argv[++i];
+            options.vsyncMode = mode == "off" ? Krafter::VsyncMode::OFF :
+                (mode == "adaptive" ? Krafter::VsyncMode::ADAPTIVE : Krafter::VsyncMode::ON);
+        }
+        else if (argument == "--frame-limit" && i + 1 < argc)
+        {
+            isValid = ParseNumber(argv[++i], options.frameRateLimit);
+        }
+        else if (argument == "--wait-for-gpu")
+        {
+            options.isWaitingForGpu = true;
+        }
+        else if (argument == "--no-render-thread")
+        {
+            options.isRenderThreaded = false;
+        }
+        else if (argument == "--dynamic-resolution")
+        {
+            options.isDynamicResolution = true;
+        }
+        else if (argument == "--hidden")
+        {
+            options.windowMode = Krafter::WindowMode::HIDDEN;
+        }
+        else if (argument == "--headless")
+        {
+            options.windowMode = Krafter::WindowMode::HEADLESS;
+        }
+        else
+        {
+            std::cerr << "[MAIN] Unknown argument " << argument << std::endl;
+            return 1;
+        }
+
+        if (!isValid)
+        {
+            std::cerr << "[MAIN] Invalid number " << argv[i] << " for " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    Krafter::Game::Init(options);
     Krafter::Game::Get()->Run();
     Krafter::Game::Deinit();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <algorithm>
+
+#include "timer.h"
+#include "world.h"
+#include "chunk_codec.h"
+#include "network_client.h"
+
+namespace Krafter
+{
+
+NetworkClient::NetworkClient(const Socket::Address& server)
+    : _server(server), _connection(Socket::Connect(server)), _datagrams(Socket::Bind(0)), _id(0), _token(0),
+    _spawnPosition(0.0f), _random(1), _decodedBlocks(Chunk::VOLUME), _receivedChunkCount(0), _receivedBlockChangeCount(0),
+    _datagramBytesSent(0), _datagramBytesReceived(0)
+{
+    PacketWriter writer;
+    writer.BeginMessage(MessageType::HELLO);
+    writer.Write(Protocol::VERSION);
+    writer.EndMessage();
+    _connection.Send(writer);
+}
+
+void NetworkClient::Update()
+{
+    _connection.Flush();
+    _connection.Receive([this](MessageType type, PacketReader& reader) { return ReceiveMessage(type, reader); });
+    ReceiveDatagrams();
+}
+
+void NetworkClient::SendCommands(std::span<const PlayerCommand> commands)
+{
+    if (!HasJoined() || commands.empty())
+    {
+        return;
+    }
+    commands = commands.last(glm::min(commands.size(), REDUNDANT_COMMANDS));
+
+    PacketWriter writer;
+    writer.Write(MessageType::PLAYER_INPUT);
+    writer.Write(_id);
+    writer.Write(_token);
+    writer.Write<uint8_t>(commands.size());
+    for (const PlayerCommand& command : commands)
+    {
+        command.Write(writer);
+    }
+    SendDatagram(writer);
+}
+
+void NetworkClient::SendBlockEdit(const glm::ivec3& position, Block block)
+{
+    PacketWriter writer;
+    writer.BeginMessage(MessageType::BLOCK_EDIT);
+    writer.Write(position);
+    writer.Write(block);
+    writer.EndMessage();
+    _connection.Send(writer);
+}
+
+bool NetworkClient::ReceiveMessage(MessageType type, PacketReader& reader)
+{
+    switch (type)
+    {
+    case MessageType::WELCOME:
+    {
+        _id = reader.Read<uint32_t>();
+        _token = reader.Read<uint32_t>();
+        reader.Read<int32_t>();
+        _spawnPosition = reader.ReadVec3();
+        return reader.IsValid();
+    }
+    case MessageType::CHUNK:
+    {
+        const int32_t x = reader.Read<int32_t>();
+        const int32_t z = reader.Read<int32_t>();
+        const uint32_t size = reader.ReadVarint();
+        const uint8_t* data = reader.ReadBytes(size);
+        if (!data || !ChunkCodec::Decode(data, size, _decodedBlocks.data()))
+        {
+            std::cerr << "[NET] Received a malformed chunk" << std::endl;
+            return false;
+        }
+
+        _chunks.insert(World::GetChunkKey(glm::ivec2(x, z)));
+        _receivedChunkCount++;
+        return true;
+    }
+    case MessageType::UNLOAD_CHUNK:
+    {
+        const int32_t x = reader.Read<int32_t>();
+        const int32_t z = reader.Read<int32_t>();
+        _chunks.erase(World::GetChunkKey(glm::ivec2(x, z)));
+        return reader.IsValid();
+    }
+    case MessageType::BLOCK_CHANGES:
+    {
+        const uint32_t sectionCount = reader.ReadVarint();
+        for (uint32_t section = 0; section < sectionCount && reader.IsValid(); section++)
+        {
+            reader.Read<int32_t>();
+            reader.Read<int32_t>();
+            reader.Read<uint8_t>();
+            const uint32_t count = reader.ReadVarint();
+            for (uint32_t i = 0; i < count && reader.IsValid(); i++)
+            {
+                reader.Read<uint16_t>();
+                reader.Read<Block>();
+            }
+            _receivedBlockChangeCount += count;
+        }
+        return reader.IsValid();
+    }
+    default:
+        return false;
+    }
+}
+
+void NetworkClient::ReceiveDatagrams()
+{
+    const double time = Timer::GetTime();
+    _snapshots.clear();
+
+    std::vector<uint8_t> data(Protocol::MAX_DATAGRAM_SIZE);
+    Socket::Address address;
+    while (size_t size = _datagrams.ReceiveFrom(data.data(), data.size(), address))
+    {
+        _datagramBytesReceived += size;
+        if (address != _server)
+        {
+            continue;
+        }
+
+        const double delay = GetDelay();
+        if (delay == 0.0)
+        {
+            ReceiveDatagram(std::vector<uint8_t>(data.begin(), data.begin() + size), time);
+        }
+        else if (delay > 0.0)
+        {
+            _incomingDatagrams.push_back({ time + delay, std::vector<uint8_t>(data.begin(), data.begin() + size) });
+        }
+    }
+
+    // Jitter lets later datagrams overtake earlier ones, like on a real
+    // network.
+    std::sort(_incomingDatagrams.begin(), _incomingDatagrams.end(), [](const auto& a, const auto& b) { return a.time < b.time; });
+    size_t dueCount = 0;
+    for (; dueCount < _incomingDatagrams.size() && _incomingDatagrams[dueCount].time <= time; dueCount++)
+    {
+        ReceiveDatagram(_incomingDatagrams[dueCount].data, time);
+    }
+    _incomingDatagrams.erase(_incomingDatagrams.begin(), _incomingDatagrams.begin() + dueCount);
+
+    std::sort(_outgoingDatagrams.begin(), _outgoingDatagrams.end(), [](const auto& a, const auto& b) { return a.time < b.time; });
+    dueCount = 0;
+    for (; dueCount < _outgoingDatagrams.size() && _outgoingDatagrams[dueCount].time <= time; dueCount++)
+    {
+        const std::vector<uint8_t>& datagram = _outgoingDatagrams[dueCount].data;
+        if (_datagrams.SendTo(datagram.data(), datagram.size(), _server))
+        {
+            _datagramBytesSent += datagram.size();
+        }
+    }
+    _outgoingDatagrams.erase(_outgoingDatagrams.begin(), _outgoingDatagrams.begin() + dueCount);
+}
+
+void NetworkClient::ReceiveDatagram(const std::vector<uint8_t>& data, double time)
+{
+    PacketReader reader = PacketReader(data.data(), data.size());
+    const MessageType type = reader.Read<MessageType>();
+    PlayerSnapshot snapshot = PlayerSnapshot::Read(reader);
+    if (reader.IsValid() && type == MessageType::PLAYER_STATE)
+    {
+        _snapshots.push_back({ std::move(snapshot), time });
+    }
+}
+
+void NetworkClient::SendDatagram(const PacketWriter& writer)
+{
+    const double delay = GetDelay();
+    if (delay == 0.0)
+    {
+        if (_datagrams.SendTo(writer.GetData().data(), writer.GetData().size(), _server))
+        {
+            _datagramBytesSent += writer.GetData().size();
+        }
+    }
+    else if (delay > 0.0)
+    {
+        _outgoingDatagrams.push_back({ Timer::GetTime() + delay, writer.GetData() });
+    }
+}
+
+double NetworkClient::GetDelay()
+{
+    if (_conditions.loss > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(_random) < _conditions.loss)
+    {
+        return -1.0;
+    }
+    if (_conditions.latency <= 0.0 && _conditions.jitter <= 0.0)
+    {
+        return 0.0;
+    }
+
+    const double jitter = std::uniform_real_distribution<double>(-_conditions.jitter, _conditions.jitter)(_random);
+    return glm::max(_conditions.latency / 2.0 + jitter, 1e-6);
+}
+
+} // namespace Krafter
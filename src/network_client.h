@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <unordered_set>
+#include <span>
+#include <random>
+#include <utility>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "block.h"
+#include "protocol.h"
+#include "prediction.h"
+
+namespace Krafter
+{
+
+// Delays the datagrams going either way by half the latency give or take
+// the jitter, and drops the given fraction of them, to try out how the game
+// holds up on a bad network over loopback.
+struct NetworkConditions
+{
+    double latency = 0.0;
+    double jitter = 0.0;
+    float loss = 0.0f;
+};
+
+// The client side of the protocol. It joins a server, decodes the chunks it
+// is sent, sends the player's commands and collects the snapshots that come
+// back. Only the set of chunks it has is kept; what to do with their blocks
+// and the snapshots is up to whoever drives it.
+class NetworkClient
+{
+public:
+    // Every datagram carries this many of the newest commands, so that a
+    // few lost in a row do not lose any input.
+    static constexpr size_t REDUNDANT_COMMANDS = 8;
+
+    NetworkClient(const Socket::Address& server);
+
+    inline bool IsConnected() const { return _connection.IsOpen(); }
+    inline bool HasJoined() const { return _id != 0; }
+
+    // Sends what was queued and handles everything that arrived.
+    void Update();
+
+    // Sends the last few commands, oldest first.
+    void SendCommands(std::span<const PlayerCommand> commands);
+    void SendBlockEdit(const glm::ivec3& position, Block block);
+
+    inline void SetConditions(const NetworkConditions& conditions) { _conditions = conditions; }
+    // The snapshots that arrived in the last Update(), in the order they
+    // arrived in, each with its arrival time on Timer::GetTime().
+    inline const std::vector<std::pair<PlayerSnapshot, double>>& GetSnapshots() const { return _snapshots; }
+
+    inline const glm::vec3& GetSpawnPosition() const { return _spawnPosition; }
+    inline size_t GetChunkCount() const { return _chunks.size(); }
+    inline uint64_t GetReceivedChunkCount() const { return _receivedChunkCount; }
+    inline uint64_t GetReceivedBlockChangeCount() const { return _receivedBlockChangeCount; }
+    inline uint64_t GetBytesSent() const { return _connection.GetBytesSent() + _datagramBytesSent; }
+    inline uint64_t GetBytesReceived() const { return _connection.GetBytesReceived() + _datagramBytesReceived; }
+
+private:
+    struct DelayedDatagram
+    {
+        double time;
+        std::vector<uint8_t> data;
+    };
+
+    bool ReceiveMessage(MessageType type, PacketReader& reader);
+    void ReceiveDatagrams();
+    void ReceiveDatagram(const std::vector<uint8_t>& data, double time);
+    // Sends right away, or once it is due under the conditions.
+    void SendDatagram(const PacketWriter& writer);
+    // Returns a negative delay for a datagram to be dropped.
+    double GetDelay();
+
+    Socket::Address _server;
+    Connection _connection;
+    Socket _datagrams;
+
+    uint32_t _id;
+    uint32_t _token;
+    glm::vec3 _spawnPosition;
+
+    std::vector<std::pair<PlayerSnapshot, double>> _snapshots;
+
+    NetworkConditions _conditions;
+    std::mt19937 _random;
+    std::vector<DelayedDatagram> _outgoingDatagrams;
+    std::vector<DelayedDatagram> _incomingDatagrams;
+
+    std::unordered_set<uint64_t> _chunks;
+    std::vector<Block> _decodedBlocks;
+
+    uint64_t _receivedChunkCount;
+    uint64_t _receivedBlockChangeCount;
+    uint64_t _datagramBytesSent;
+    uint64_t _datagramBytesReceived;
+};
+
+} // namespace Krafter
@@ -0,0 +1,246 @@
+#include <cstddef>
+#include <cstring>
+
+#include "glad/gl.h"
+
+#include "world.h"
+#include "render_state.h"
+#include "particle_system.h"
+
+namespace Krafter
+{
+
+ParticleSystem::ParticleSystem()
+    : _currentBuffer(0), _emittedCount(0), _occupancyOrigin(0), _hasOccupancy(false), _lastOccupancyTime(0.0),
+    _readbackFences{}, _readbackIndex(0), _aliveCount(0)
+{
+    _emitProgram = std::make_shared<ShaderProgram>("assets/particle_emit.comp.glsl");
+    _countProgram = std::make_shared<ShaderProgram>("assets/particle_count.comp.glsl");
+    _updateProgram = std::make_shared<ShaderProgram>("assets/particle_update.comp.glsl");
+    _compactProgram = std::make_shared<ShaderProgram>("assets/particle_compact.comp.glsl");
+    _renderProgram = std::make_shared<ShaderProgram>("assets/particle.vert.glsl", "assets/particle.frag.glsl");
+
+    glCreateBuffers(_particleBuffers.size(), _particleBuffers.data());
+    for (uint32_t buffer : _particleBuffers)
+    {
+        glNamedBufferStorage(buffer, MAX_PARTICLE_COUNT * PARTICLE_SIZE, nullptr, 0);
+    }
+
+    const Counters counters = {
+        .elementCount = 6,
+        .aliveCount = 0,
+        .firstIndex = 0,
+        .baseVertex = 0,
+        .baseInstance = 0,
+        .groupCount = { 0, 0, 0 },
+        .compactedCount = 0
+    };
+    glCreateBuffers(1, &_counterBuffer);
+    glNamedBufferStorage(_counterBuffer, sizeof(Counters), &counters, 0);
+
+    // Four corners per particle, placed by the vertex shader.
+    const uint32_t elements[] = { 0, 1, 3, 3, 2, 0 };
+    glCreateBuffers(1, &_elementBuffer);
+    glNamedBufferStorage(_elementBuffer, sizeof(elements), elements, 0);
+    glCreateVertexArrays(1, &_vertexArray);
+    glVertexArrayElementBuffer(_vertexArray, _elementBuffer);
+
+    _emitters = std::make_shared<RingBuffer>(MAX_EMITTER_COUNT * sizeof(ParticleEmitter));
+
+    glCreateTextures(GL_TEXTURE_3D, 1, &_occupancyTexture);
+    glTextureParameteri(_occupancyTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(_occupancyTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureStorage3D(_occupancyTexture, 1, GL_R8UI, OCCUPANCY_SIZE, OCCUPANCY_SIZE, OCCUPANCY_SIZE);
+    _occupancy = std::vector<uint8_t>(OCCUPANCY_SIZE * OCCUPANCY_SIZE * OCCUPANCY_SIZE, 0);
+    glTextureSubImage3D(_occupancyTexture, 0, 0, 0, 0, OCCUPANCY_SIZE, OCCUPANCY_SIZE, OCCUPANCY_SIZE,
+        GL_RED_INTEGER, GL_UNSIGNED_BYTE, _occupancy.data());
+
+    constexpr uint32_t flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &_readbackBuffer);
+    glNamedBufferStorage(_readbackBuffer, _readbackFences.size() * sizeof(uint32_t), nullptr, flags | GL_CLIENT_STORAGE_BIT);
+    _readbackData = (const uint32_t*)glMapNamedBufferRange(_readbackBuffer, 0, _readbackFences.size() * sizeof(uint32_t), flags);
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    for (GLsync fence : _readbackFences)
+    {
+        glDeleteSync(fence);
+    }
+
+    RenderState::Forget(_occupancyTexture);
+    RenderState::Forget(_vertexArray);
+    for (uint32_t buffer : _particleBuffers)
+    {
+        RenderState::Forget(buffer);
+    }
+
+    glUnmapNamedBuffer(_readbackBuffer);
+    glDeleteBuffers(1, &_readbackBuffer);
+    glDeleteTextures(1, &_occupancyTexture);
+    glDeleteVertexArrays(1, &_vertexArray);
+    glDeleteBuffers(1, &_elementBuffer);
+    glDeleteBuffers(1, &_counterBuffer);
+    glDeleteBuffers(_particleBuffers.size(), _particleBuffers.data());
+}
+
+void ParticleSystem::Emit(const ParticleEmitter& emitter)
+{
+    if (_pendingEmitters.size() < MAX_EMITTER_COUNT)
+    {
+        _pendingEmitters.push_back(emitter);
+    }
+}
+
+void ParticleSystem::UpdateOccupancy(const World& world, const glm::vec3& center)
+{
+    const glm::ivec3 origin = glm::ivec3(glm::floor(center)) - OCCUPANCY_SIZE / 2;
+    const glm::ivec3 offset = glm::abs(origin - _occupancyOrigin);
+    const bool hasMoved = glm::max(offset.x, glm::max(offset.y, offset.z)) >= OCCUPANCY_STEP;
+    const double time = _occupancyTimer.GetElapsedSeconds();
+    if (_hasOccupancy && !hasMoved && time - _lastOccupancyTime < OCCUPANCY_INTERVAL)
+    {
+        return;
+    }
+
+    // One chunk lookup per column; the texture is laid out x, then y, then z.
+    for (int32_t z = 0; z < OCCUPANCY_SIZE; z++)
+    {
+        for (int32_t x = 0; x < OCCUPANCY_SIZE; x++)
+        {
+            const glm::ivec3 column = origin + glm::ivec3(x, 0, z);
+            const glm::ivec2 chunkCoords = World::GetChunkCoords(column);
+            std::shared_ptr<const Chunk> chunk = world.GetChunk(chunkCoords);
+            const glm::ivec3 coords = column - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH;
+
+            for (int32_t y = 0; y < OCCUPANCY_SIZE; y++)
+            {
+                const int32_t worldY = origin.y + y;
+                bool isSolid = worldY < 0;
+                if (chunk && worldY >= 0 && worldY < (int32_t)Chunk::HEIGHT)
+                {
+                    isSolid = BlockInfo::GetInfoOf(chunk->GetBlock(glm::ivec3(coords.x, worldY, coords.z))).isSolid;
+                }
+                _occupancy[(z * OCCUPANCY_SIZE + y) * OCCUPANCY_SIZE + x] = isSolid;
+            }
+        }
+    }
+
+    glTextureSubImage3D(_occupancyTexture, 0, 0, 0, 0, OCCUPANCY_SIZE, OCCUPANCY_SIZE, OCCUPANCY_SIZE,
+        GL_RED_INTEGER, GL_UNSIGNED_BYTE, _occupancy.data());
+
+    _occupancyOrigin = origin;
+    _hasOccupancy = true;
+    _lastOccupancyTime = time;
+}
+
+void ParticleSystem::Update(float delta)
+{
+    _updateTimer.Begin();
+
+    RenderState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, _counterBuffer, 0, sizeof(Counters));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _counterBuffer);
+
+    // Emitting appends to the current buffer; the count pass then clamps
+    // the total and sizes the dispatches over it.
+    _emitters->BeginFrame();
+    _emittedCount = 0;
+    if (!_pendingEmitters.empty())
+    {
+        std::memcpy(_emitters->GetFrameData(), _pendingEmitters.data(), _pendingEmitters.size() * sizeof(ParticleEmitter));
+        for (const ParticleEmitter& emitter : _pendingEmitters)
+        {
+            _emittedCount += emitter.count;
+        }
+
+        RenderState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, _particleBuffers[_currentBuffer], 0, MAX_PARTICLE_COUNT * PARTICLE_SIZE);
+        _emitters->BindRange(GL_SHADER_STORAGE_BUFFER, 4, 0, _pendingEmitters.size() * sizeof(ParticleEmitter));
+
+        _emitProgram->Bind();
+        _emitProgram->SetUniformUint(0, _pendingEmitters.size());
+        _emitProgram->SetUniformUint(1, MAX_PARTICLE_COUNT);
+        glDispatchCompute((_emittedCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        _pendingEmitters.clear();
+    }
+    _emitters->EndFrame();
+
+    Count(false);
+
+    RenderState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, _particleBuffers[_currentBuffer], 0, MAX_PARTICLE_COUNT * PARTICLE_SIZE);
+    RenderState::BindTextureUnit(1, _occupancyTexture);
+
+    _updateProgram->Bind();
+    _updateProgram->SetUniformFloat(0, delta);
+    _updateProgram->SetUniformVec4(1, glm::vec4(_occupancyOrigin, 0.0f));
+    glDispatchComputeIndirect(offsetof(Counters, groupCount));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    RenderState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, _particleBuffers[1 - _currentBuffer], 0, MAX_PARTICLE_COUNT * PARTICLE_SIZE);
+
+    _compactProgram->Bind();
+    glDispatchComputeIndirect(offsetof(Counters, groupCount));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    Count(true);
+    _currentBuffer = 1 - _currentBuffer;
+
+    // Reuses the oldest readback slot, whose copy has finished by now in
+    // all but the slowest frames.
+    _readbackIndex = (_readbackIndex + 1) % _readbackFences.size();
+    GLsync& fence = _readbackFences[_readbackIndex];
+    if (fence)
+    {
+        RenderState::WaitForFence(fence);
+        _aliveCount = _readbackData[_readbackIndex];
+    }
+    glCopyNamedBufferSubData(_counterBuffer, _readbackBuffer, offsetof(Counters, aliveCount),
+        _readbackIndex * sizeof(uint32_t), sizeof(uint32_t));
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _updateTimer.End();
+}
+
+void ParticleSystem::Render(const Camera& camera)
+{
+    _renderTimer.Begin();
+
+    const glm::vec3 right = glm::normalize(glm::cross(camera.GetDirection(), glm::vec3(0.0f, 1.0f, 0.0f)));
+    const glm::vec3 up = glm::cross(right, camera.GetDirection());
+
+    RenderState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, _particleBuffers[_currentBuffer], 0, MAX_PARTICLE_COUNT * PARTICLE_SIZE);
+
+    _renderProgram->Bind();
+    _renderProgram->SetUniformVec4(0, glm::vec4(right, 0.0f));
+    _renderProgram->SetUniformVec4(1, glm::vec4(up, 0.0f));
+
+    glDisable(GL_BLEND);
+    RenderState::BindVertexArray(_vertexArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _counterBuffer);
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+    RenderState::RecordDraw(6 * _aliveCount);
+
+    _renderTimer.End();
+}
+
+void ParticleSystem::ReloadShaders()
+{
+    _emitProgram->Reload();
+    _countProgram->Reload();
+    _updateProgram->Reload();
+    _compactProgram->Reload();
+    _renderProgram->Reload();
+}
+
+void ParticleSystem::Count(bool useCompacted)
+{
+    _countProgram->Bind();
+    _countProgram->SetUniformUint(0, MAX_PARTICLE_COUNT);
+    _countProgram->SetUniformUint(1, useCompacted);
+    glDispatchCompute(1, 1, 1);
+    // The counts are also copied out for the readback.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+} // namespace Krafter
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "timer.h"
+#include "renderer.h"
+
+namespace Krafter
+{
+
+class World;
+
+// Matches the std430 layout of the emitters in the emit shader.
+struct ParticleEmitter
+{
+    // xyz is the center, w the radius the particles start within.
+    glm::vec4 position;
+    // xyz is the base velocity, w the most random speed added to it.
+    glm::vec4 velocity;
+    uint32_t count;
+    uint32_t layer;
+    // RGBA, multiplied with the texture.
+    uint32_t tint;
+    float life;
+    float size;
+    float gravity;
+    uint32_t seed;
+    float padding;
+};
+
+// Simulates particles entirely on the GPU. They live in one of two storage
+// buffers; every frame new ones are appended, all of them are moved, and
+// the living ones are compacted into the other buffer, which is then drawn
+// with a single indirect instanced call. Counts never come back to the CPU
+// except for the statistics, which are read a few frames late.
+class ParticleSystem
+{
+public:
+    static constexpr uint32_t MAX_PARTICLE_COUNT = 1 << 18;
+    static constexpr uint32_t MAX_EMITTER_COUNT = 256;
+    static constexpr uint32_t GROUP_SIZE = 64;
+
+    // Particles collide with the solid blocks in a cube of this many blocks
+    // around the camera, refreshed every OCCUPANCY_INTERVAL seconds or as
+    // soon as the camera moved OCCUPANCY_STEP blocks.
+    static constexpr int32_t OCCUPANCY_SIZE = 64;
+    static constexpr int32_t OCCUPANCY_STEP = 8;
+    static constexpr double OCCUPANCY_INTERVAL = 0.5;
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    // Queues an emitter for the next Update(); the ones past
+    // MAX_EMITTER_COUNT in a frame are dropped.
+    void Emit(const ParticleEmitter& emitter);
+
+    // The world must not change while this runs.
+    void UpdateOccupancy(const World& world, const glm::vec3& center);
+
+    void Update(float delta);
+    void Render(const Camera& camera);
+    void ReloadShaders();
+
+    // The alive count is a few frames late.
+    inline uint32_t GetAliveCount() const { return _aliveCount; }
+    inline uint32_t GetEmittedCount() const { return _emittedCount; }
+    inline double GetUpdateTime() const { return _updateTimer.GetMilliseconds(); }
+    inline double GetRenderTime() const { return _renderTimer.GetMilliseconds(); }
+
+private:
+    // The size of a particle in the std430 layout of the shaders.
+    static constexpr size_t PARTICLE_SIZE = 48;
+
+    // Matches the std430 counters in the shaders. The draw and dispatch
+    // commands are read by the GPU directly.
+    struct Counters
+    {
+        uint32_t elementCount;
+        uint32_t aliveCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+        uint32_t groupCount[3];
+        uint32_t compactedCount;
+    };
+
+    void Count(bool useCompacted);
+
+    std::shared_ptr<ShaderProgram> _emitProgram;
+    std::shared_ptr<ShaderProgram> _countProgram;
+    std::shared_ptr<ShaderProgram> _updateProgram;
+    std::shared_ptr<ShaderProgram> _compactProgram;
+    std::shared_ptr<ShaderProgram> _renderProgram;
+
+    std::array<uint32_t, 2> _particleBuffers;
+    uint32_t _currentBuffer;
+    uint32_t _counterBuffer;
+    uint32_t _vertexArray;
+    uint32_t _elementBuffer;
+
+    std::vector<ParticleEmitter> _pendingEmitters;
+    std::shared_ptr<RingBuffer> _emitters;
+    uint32_t _emittedCount;
+
+    uint32_t _occupancyTexture;
+    glm::ivec3 _occupancyOrigin;
+    std::vector<uint8_t> _occupancy;
+    Timer _occupancyTimer;
+    bool _hasOccupancy;
+    double _lastOccupancyTime;
+
+    // The alive count is copied here every frame and read once its fence
+    // has passed.
+    uint32_t _readbackBuffer;
+    const uint32_t* _readbackData;
+    std::array<GLsync, RingBuffer::FRAME_COUNT> _readbackFences;
+    uint32_t _readbackIndex;
+    uint32_t _aliveCount;
+
+    GpuTimer _updateTimer;
+    GpuTimer _renderTimer;
+};
+
+} // namespace Krafter
@@ -0,0 +1,133 @@
+#include "world.h"
+#include "physics.h"
+
+namespace Krafter
+{
+
+// Keeps touching faces from counting as overlapping.
+static constexpr float EPSILON = 1e-4f;
+
+void Physics::Step(const World& world, PhysicsBody& body, float delta)
+{
+    body.velocity.y = glm::max(body.velocity.y + GRAVITY * delta, -TERMINAL_VELOCITY);
+    const glm::vec3 motion = body.velocity * delta;
+
+    float moved = Sweep(world, body, 1, motion.y);
+    body.position.y += moved;
+    body.isOnGround = motion.y < 0.0f && moved > motion.y;
+    if (moved != motion.y)
+    {
+        body.velocity.y = 0.0f;
+    }
+
+    const glm::vec2 horizontalMotion = glm::vec2(motion.x, motion.z);
+    if (horizontalMotion == glm::vec2(0.0f))
+    {
+        return;
+    }
+
+    PhysicsBody walked = body;
+    MoveHorizontally(world, walked, horizontalMotion);
+
+    // Walking into a ledge, try going over it instead and keep whichever
+    // got further.
+    if (body.isOnGround && (walked.velocity.x != body.velocity.x || walked.velocity.z != body.velocity.z))
+    {
+        PhysicsBody stepped = body;
+        float up = Sweep(world, stepped, 1, STEP_HEIGHT);
+        stepped.position.y += up;
+        MoveHorizontally(world, stepped, horizontalMotion);
+        stepped.position.y += Sweep(world, stepped, 1, -up);
+
+        glm::vec2 walkedDistance = glm::vec2(walked.position.x, walked.position.z) - glm::vec2(body.position.x, body.position.z);
+        glm::vec2 steppedDistance = glm::vec2(stepped.position.x, stepped.position.z) - glm::vec2(body.position.x, body.position.z);
+        if (glm::dot(steppedDistance, steppedDistance) > glm::dot(walkedDistance, walkedDistance) + EPSILON)
+        {
+            body = stepped;
+            return;
+        }
+    }
+
+    body = walked;
+}
+
+bool Physics::IsOverlapping(const PhysicsBody& body, const glm::ivec3& block)
+{
+    const glm::vec3 halfSize = glm::vec3(body.size.x, 0.0f, body.size.z) * 0.5f;
+    const glm::vec3 min = body.position - halfSize;
+    const glm::vec3 max = body.position + halfSize + glm::vec3(0.0f, body.size.y, 0.0f);
+
+    for (int32_t i = 0; i < 3; i++)
+    {
+        if (max[i] <= block[i] + EPSILON || min[i] >= block[i] + 1 - EPSILON)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+float Physics::Sweep(const World& world, const PhysicsBody& body, int32_t axis, float distance)
+{
+    if (distance == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    const glm::vec3 halfSize = glm::vec3(body.size.x, 0.0f, body.size.z) * 0.5f;
+    const glm::vec3 min = body.position - halfSize;
+    const glm::vec3 max = body.position + halfSize + glm::vec3(0.0f, body.size.y, 0.0f);
+
+    // The blocks the box covers across the other two axes.
+    const int32_t u = (axis + 1) % 3;
+    const int32_t v = (axis + 2) % 3;
+    const int32_t firstU = (int32_t)glm::floor(min[u] + EPSILON);
+    const int32_t lastU = (int32_t)glm::floor(max[u] - EPSILON);
+    const int32_t firstV = (int32_t)glm::floor(min[v] + EPSILON);
+    const int32_t lastV = (int32_t)glm::floor(max[v] - EPSILON);
+
+    // Walks the layers of blocks ahead of the box, nearest first, and stops
+    // at the first one holding a solid block.
+    const int32_t direction = distance > 0.0f ? 1 : -1;
+    const float front = distance > 0.0f ? max[axis] : min[axis];
+    const int32_t first = (int32_t)glm::floor(distance > 0.0f ? front - EPSILON : front + EPSILON) + direction;
+    const int32_t last = (int32_t)glm::floor(front + distance);
+
+    for (int32_t layer = first; layer * direction <= last * direction; layer += direction)
+    {
+        glm::ivec3 block;
+        block[axis] = layer;
+        for (block[u] = firstU; block[u] <= lastU; block[u]++)
+        {
+            for (block[v] = firstV; block[v] <= lastV; block[v]++)
+            {
+                if (world.IsSolid(block))
+                {
+                    float limit = distance > 0.0f ? layer - front : layer + 1 - front;
+                    return distance > 0.0f ? glm::max(glm::min(distance, limit), 0.0f) : glm::min(glm::max(distance, limit), 0.0f);
+                }
+            }
+        }
+    }
+
+    return distance;
+}
+
+void Physics::MoveHorizontally(const World& world, PhysicsBody& body, const glm::vec2& motion)
+{
+    float movedX = Sweep(world, body, 0, motion.x);
+    body.position.x += movedX;
+    if (movedX != motion.x)
+    {
+        body.velocity.x = 0.0f;
+    }
+
+    float movedZ = Sweep(world, body, 2, motion.y);
+    body.position.z += movedZ;
+    if (movedZ != motion.y)
+    {
+        body.velocity.z = 0.0f;
+    }
+}
+
+} // namespace Krafter
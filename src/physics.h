@@ -0,0 +1,44 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Krafter
+{
+
+class World;
+
+struct PhysicsBody
+{
+    // The center of the bottom of the box.
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec3 size;
+    bool isOnGround;
+};
+
+// Moves axis aligned boxes through the voxel grid. Only the blocks the box
+// sweeps through are looked at, one axis at a time.
+class Physics
+{
+public:
+    static constexpr float TIMESTEP = 1.0f / 60.0f;
+    static constexpr float GRAVITY = -28.0f;
+    static constexpr float TERMINAL_VELOCITY = 60.0f;
+    static constexpr float STEP_HEIGHT = 0.6f;
+
+    // Advances a body by one step of gravity and movement. Bodies on the
+    // ground walk up ledges no higher than STEP_HEIGHT.
+    static void Step(const World& world, PhysicsBody& body, float delta);
+
+    static bool IsOverlapping(const PhysicsBody& body, const glm::ivec3& block);
+
+private:
+    // Returns how far the body can move along an axis, up to the given
+    // distance, before touching a solid block. The body is not moved.
+    static float Sweep(const World& world, const PhysicsBody& body, int32_t axis, float distance);
+
+    // Moves along x and then z, stopping the velocity on the blocked axes.
+    static void MoveHorizontally(const World& world, PhysicsBody& body, const glm::vec2& motion);
+};
+
+} // namespace Krafter
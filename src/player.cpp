@@ -0,0 +1,62 @@
+#include "world.h"
+#include "player.h"
+
+namespace Krafter
+{
+
+Player::Player(const glm::vec3& position)
+    : _body{ .position = position, .velocity = glm::vec3(0.0f), .size = glm::vec3(0.6f, 1.8f, 0.6f), .isOnGround = false },
+    _previousPosition(position)
+{
+}
+
+void Player::Tick(const World& world, const PlayerInput& input)
+{
+    if (input.isFlying)
+    {
+        // The body follows the camera, so walking starts from where it is.
+        glm::vec3 offset = input.cameraPosition - glm::vec3(0.0f, EYE_HEIGHT, 0.0f) - _body.position;
+        const float distance = glm::length(offset);
+        const float maxDistance = MAX_FLY_SPEED * Physics::TIMESTEP;
+        if (distance > maxDistance)
+        {
+            offset *= maxDistance / distance;
+        }
+
+        _body.position += offset;
+        _body.velocity = glm::vec3(0.0f);
+        _previousPosition = _body.position;
+        return;
+    }
+
+    _previousPosition = _body.position;
+
+    glm::vec2 forward = glm::vec2(input.cameraDirection.x, input.cameraDirection.z);
+    forward = glm::dot(forward, forward) > 0.0f ? glm::normalize(forward) : glm::vec2(1.0f, 0.0f);
+    glm::vec2 right = glm::vec2(-forward.y, forward.x);
+
+    glm::vec2 velocity = glm::vec2(0.0f);
+    if (input.movement != glm::vec2(0.0f))
+    {
+        velocity = glm::normalize(forward * input.movement.y + right * input.movement.x) * WALK_SPEED;
+    }
+    _body.velocity.x = velocity.x;
+    _body.velocity.z = velocity.y;
+
+    if (input.isJumping && _body.isOnGround)
+    {
+        _body.velocity.y = JUMP_SPEED;
+    }
+
+    Physics::Step(world, _body, Physics::TIMESTEP);
+}
+
+void Player::Reset(const glm::vec3& position, const glm::vec3& velocity, bool isOnGround)
+{
+    _body.position = position;
+    _body.velocity = velocity;
+    _body.isOnGround = isOnGround;
+    _previousPosition = position;
+}
+
+} // namespace Krafter
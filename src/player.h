@@ -0,0 +1,49 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "physics.h"
+
+namespace Krafter
+{
+
+class World;
+
+struct PlayerInput
+{
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraDirection = glm::vec3(1.0f, 0.0f, 0.0f);
+    // Sideways and forward, each from -1 to 1.
+    glm::vec2 movement = glm::vec2(0.0f);
+    bool isJumping = false;
+    bool isFlying = true;
+};
+
+// Walks through the world one physics step at a time, or follows the
+// freely flying camera.
+class Player
+{
+public:
+    static constexpr float WALK_SPEED = 4.3f;
+    static constexpr float JUMP_SPEED = 8.5f;
+    static constexpr float EYE_HEIGHT = 1.62f;
+    // Flying, the body heads for the camera no faster than this, a little
+    // over the camera's top speed diagonally. The server steps the same way,
+    // so a client cannot teleport by sending a far away camera.
+    static constexpr float MAX_FLY_SPEED = 150.0f;
+
+    Player(const glm::vec3& position = glm::vec3(0.0f));
+
+    void Tick(const World& world, const PlayerInput& input);
+    // Puts the body into a state the server sent, to step on from there.
+    void Reset(const glm::vec3& position, const glm::vec3& velocity, bool isOnGround);
+
+    inline const PhysicsBody& GetBody() const { return _body; }
+    inline const glm::vec3& GetPreviousPosition() const { return _previousPosition; }
+
+private:
+    PhysicsBody _body;
+    glm::vec3 _previousPosition;
+};
+
+} // namespace Krafter
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <cstdlib>
+
+#include "png_writer.h"
+
+namespace Krafter
+{
+
+// Deflate reads its bits from the least significant up, but Huffman codes
+// most significant bit first.
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint8_t>& data) : _data(data), _buffer(0), _bitCount(0) {}
+
+    void Write(uint32_t bits, uint32_t count)
+    {
+        _buffer |= (uint64_t)bits << _bitCount;
+        _bitCount += count;
+        while (_bitCount >= 8)
+        {
+            _data.push_back((uint8_t)_buffer);
+            _buffer >>= 8;
+            _bitCount -= 8;
+        }
+    }
+
+    void WriteCode(uint32_t code, uint32_t length)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        Write(reversed, length);
+    }
+
+    void Flush()
+    {
+        if (_bitCount > 0)
+        {
+            _data.push_back((uint8_t)_buffer);
+        }
+        _buffer = 0;
+        _bitCount = 0;
+    }
+
+private:
+    std::vector<uint8_t>& _data;
+    uint64_t _buffer;
+    uint32_t _bitCount;
+};
+
+static const uint16_t LENGTH_BASES[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA_BITS[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DISTANCE_BASES[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DISTANCE_EXTRA_BITS[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// The fixed Huffman code of a literal, length or end of block symbol.
+static void WriteSymbol(BitWriter& writer, uint32_t symbol)
+{
+    if (symbol < 144)
+    {
+        writer.WriteCode(0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        writer.WriteCode(0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280)
+    {
+        writer.WriteCode(symbol - 256, 7);
+    }
+    else
+    {
+        writer.WriteCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+static void WriteMatch(BitWriter& writer, uint32_t length, uint32_t distance)
+{
+    uint32_t lengthCode = 28;
+    while (LENGTH_BASES[lengthCode] > length)
+    {
+        lengthCode--;
+    }
+    WriteSymbol(writer, 257 + lengthCode);
+    writer.Write(length - LENGTH_BASES[lengthCode], LENGTH_EXTRA_BITS[lengthCode]);
+
+    uint32_t distanceCode = 29;
+    while (DISTANCE_BASES[distanceCode] > distance)
+    {
+        distanceCode--;
+    }
+    writer.WriteCode(distanceCode, 5);
+    writer.Write(distance - DISTANCE_BASES[distanceCode], DISTANCE_EXTRA_BITS[distanceCode]);
+}
+
+bool PngWriter::Write(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+    std::vector<uint8_t> filtered;
+    Filter(width, height, pixels, filtered);
+
+    // zlib: deflate with a 32K window, no dictionary, then the checksum.
+    std::vector<uint8_t> compressed = { 0x78, 0x01 };
+    Deflate(filtered.data(), filtered.size(), compressed);
+    const uint32_t adler = Adler32(filtered.data(), filtered.size());
+    for (int32_t shift = 24; shift >= 0; shift -= 8)
+    {
+        compressed.push_back((uint8_t)(adler >> shift));
+    }
+
+    std::vector<uint8_t> header;
+    for (uint32_t value : { width, height })
+    {
+        for (int32_t shift = 24; shift >= 0; shift -= 8)
+        {
+            header.push_back((uint8_t)(value >> shift));
+        }
+    }
+    // 8 bits per channel, RGBA, deflate, adaptive filtering, not interlaced.
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+    std::vector<uint8_t> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    WriteChunk(file, "IHDR", header);
+    WriteChunk(file, "IDAT", compressed);
+    WriteChunk(file, "IEND", {});
+
+    std::ofstream stream = std::ofstream(path, std::ios::binary);
+    stream.write((const char*)file.data(), file.size());
+    return (bool)stream;
+}
+
+void PngWriter::Filter(uint32_t width, uint32_t height, const uint8_t* pixels, std::vector<uint8_t>& filtered)
+{
+    const size_t stride = (size_t)width * 4;
+    filtered.resize((stride + 1) * height);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = pixels + y * stride;
+        const uint8_t* above = y > 0 ? row - stride : nullptr;
+
+        // The filter with the smallest differences, taken as signed bytes,
+        // tends to compress best.
+        uint64_t subCost = 0;
+        uint64_t upCost = 0;
+        for (size_t x = 0; x < stride; x++)
+        {
+            subCost += std::abs((int8_t)(row[x] - (x >= 4 ? row[x - 4] : 0)));
+            upCost += std::abs((int8_t)(row[x] - (above ? above[x] : 0)));
+        }
+        const bool isUp = upCost < subCost;
+
+        uint8_t* out = filtered.data() + y * (stride + 1);
+        out[0] = isUp ? 2 : 1;
+        for (size_t x = 0; x < stride; x++)
+        {
+            const uint8_t predicted = isUp ? (above ? above[x] : 0) : (x >= 4 ? row[x - 4] : 0);
+            out[x + 1] = row[x] - predicted;
+        }
+    }
+}
+
+void PngWriter::Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+{
+    BitWriter writer = BitWriter(compressed);
+    // A single final block with the fixed codes.
+    writer.Write(1, 1);
+    writer.Write(1, 2);
+
+    // The last position every 3-byte sequence was seen at, plus one.
+    std::vector<uint32_t> head = std::vector<uint32_t>(1 << HASH_BITS, 0);
+    const auto hash = [&](size_t i)
+    {
+        const uint32_t value = data[i] | data[i + 1] << 8 | data[i + 2] << 16;
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t length = 0;
+        size_t distance = 0;
+        if (i + MIN_MATCH <= size)
+        {
+            const uint32_t key = hash(i);
+            const size_t candidate = head[key];
+            head[key] = (uint32_t)(i + 1);
+
+            if (candidate > 0 && i - (candidate - 1) <= WINDOW_SIZE)
+            {
+                const size_t start = candidate - 1;
+                const size_t maxLength = std::min(MAX_MATCH, size - i);
+                while (length < maxLength && data[start + length] == data[i + length])
+                {
+                    length++;
+                }
+                distance = i - start;
+            }
+        }
+
+        if (length >= MIN_MATCH)
+        {
+            WriteMatch(writer, (uint32_t)length, (uint32_t)distance);
+            // The skipped positions are still remembered for later matches.
+            for (size_t j = i + 1; j < i + length && j + MIN_MATCH <= size; j++)
+            {
+                head[hash(j)] = (uint32_t)(j + 1);
+            }
+            i += length;
+        }
+        else
+        {
+            WriteSymbol(writer, data[i]);
+            i++;
+        }
+    }
+
+    WriteSymbol(writer, 256);
+    writer.Flush();
+}
+
+uint32_t PngWriter::Crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    static const std::array<uint32_t, 256> table = []
+    {
+        std::array<uint32_t, 256> table;
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (uint32_t k = 0; k < 8; k++)
+            {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t PngWriter::Adler32(const uint8_t* data, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+void PngWriter::WriteChunk(std::vector<uint8_t>& file, const char* type, const std::vector<uint8_t>& data)
+{
+    const uint32_t size = (uint32_t)data.size();
+    for (int32_t shift = 24; shift >= 0; shift -= 8)
+    {
+        file.push_back((uint8_t)(size >> shift));
+    }
+
+    const size_t start = file.size();
+    file.insert(file.end(), type, type + 4);
+    file.insert(file.end(), data.begin(), data.end());
+
+    const uint32_t crc = Crc32(file.data() + start, file.size() - start);
+    for (int32_t shift = 24; shift >= 0; shift -= 8)
+    {
+        file.push_back((uint8_t)(crc >> shift));
+    }
+}
+
+} // namespace Krafter
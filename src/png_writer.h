@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Krafter
+{
+
+// Writes 8-bit RGBA images as PNG files, for frame captures, without
+// depending on an image library.
+//
+// Every row is filtered with whichever of the Sub and Up filters leaves the
+// smaller differences, and the result is compressed with fixed Huffman
+// deflate and a greedy LZ77 matcher. The files come out larger than from a
+// real encoder, but rendered frames still shrink a lot.
+class PngWriter
+{
+public:
+    // The rows go from the top down, as in the file.
+    static bool Write(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+    // Exposed for measuring them.
+    static void Filter(uint32_t width, uint32_t height, const uint8_t* pixels, std::vector<uint8_t>& filtered);
+    static void Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+
+private:
+    static constexpr size_t WINDOW_SIZE = 32768;
+    static constexpr size_t MIN_MATCH = 3;
+    static constexpr size_t MAX_MATCH = 258;
+    static constexpr uint32_t HASH_BITS = 15;
+
+    static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+    static uint32_t Adler32(const uint8_t* data, size_t size);
+    static void WriteChunk(std::vector<uint8_t>& file, const char* type, const std::vector<uint8_t>& data);
+};
+
+} // namespace Krafter
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+
+#include "world.h"
+#include "camera.h"
+#include "physics.h"
+#include "prediction.h"
+
+namespace Krafter
+{
+
+PlayerInput PlayerCommand::ToInput() const
+{
+    return {
+        .cameraPosition = cameraPosition,
+        .cameraDirection = Camera::GetDirectionOf(yaw, pitch),
+        .movement = movement,
+        .isJumping = isJumping,
+        .isFlying = isFlying
+    };
+}
+
+void PlayerCommand::Write(PacketWriter& writer) const
+{
+    writer.Write(sequence);
+    writer.Write(yaw);
+    writer.Write(pitch);
+    writer.Write((int8_t)movement.x);
+    writer.Write((int8_t)movement.y);
+    writer.Write<uint8_t>(isJumping | isFlying << 1);
+    if (isFlying)
+    {
+        writer.Write(cameraPosition);
+    }
+}
+
+PlayerCommand PlayerCommand::Read(PacketReader& reader)
+{
+    PlayerCommand command;
+    command.sequence = reader.Read<uint32_t>();
+    command.yaw = reader.Read<float>();
+    command.pitch = reader.Read<float>();
+    command.movement.x = glm::clamp(reader.Read<int8_t>(), (int8_t)-1, (int8_t)1);
+    command.movement.y = glm::clamp(reader.Read<int8_t>(), (int8_t)-1, (int8_t)1);
+    const uint8_t flags = reader.Read<uint8_t>();
+    command.isJumping = flags & 1;
+    command.isFlying = flags & 2;
+    command.cameraPosition = command.isFlying ? reader.ReadVec3() : glm::vec3(0.0f);
+    return command;
+}
+
+void PlayerSnapshot::Write(PacketWriter& writer) const
+{
+    writer.Write(tick);
+    writer.Write(sequence);
+    writer.Write(position);
+    writer.Write(velocity);
+    writer.Write<uint8_t>(isOnGround);
+    writer.Write<uint8_t>(remotePlayers.size());
+    for (const RemotePlayer& remotePlayer : remotePlayers)
+    {
+        writer.Write(remotePlayer.id);
+        writer.Write(remotePlayer.position);
+        writer.Write(remotePlayer.yaw);
+    }
+}
+
+PlayerSnapshot PlayerSnapshot::Read(PacketReader& reader)
+{
+    PlayerSnapshot snapshot;
+    snapshot.tick = reader.Read<uint32_t>();
+    snapshot.sequence = reader.Read<uint32_t>();
+    snapshot.position = reader.ReadVec3();
+    snapshot.velocity = reader.ReadVec3();
+    snapshot.isOnGround = reader.Read<uint8_t>();
+    const uint8_t count = reader.Read<uint8_t>();
+    for (uint8_t i = 0; i < count && reader.IsValid(); i++)
+    {
+        RemotePlayer remotePlayer;
+        remotePlayer.id = reader.Read<uint32_t>();
+        remotePlayer.position = reader.ReadVec3();
+        remotePlayer.yaw = reader.Read<float>();
+        snapshot.remotePlayers.push_back(remotePlayer);
+    }
+    return snapshot;
+}
+
+PlayerPrediction::PlayerPrediction(const glm::vec3& position)
+    : _player(position), _nextSequence(1), _acknowledgedSequence(0), _correction(0.0f),
+    _correctionCount(0), _totalCorrection(0.0f), _maxCorrection(0.0f), _roundTripTime(0.0)
+{
+}
+
+const PlayerCommand& PlayerPrediction::Predict(const World& world, const PlayerCommand& command, double time)
+{
+    if (_pendingCommands.size() == MAX_PENDING_COMMANDS)
+    {
+        _pendingCommands.erase(_pendingCommands.begin());
+        _pendingTimes.erase(_pendingTimes.begin());
+    }
+
+    _pendingCommands.push_back(command);
+    _pendingCommands.back().sequence = _nextSequence++;
+    _pendingTimes.push_back(time);
+
+    _player.Tick(world, _pendingCommands.back().ToInput());
+    return _pendingCommands.back();
+}
+
+void PlayerPrediction::Reconcile(const World& world, const PlayerSnapshot& snapshot, double time)
+{
+    // Snapshots can arrive out of order; the difference wraps around along
+    // with the sequence.
+    if ((int32_t)(snapshot.sequence - _acknowledgedSequence) <= 0)
+    {
+        return;
+    }
+    _acknowledgedSequence = snapshot.sequence;
+
+    size_t stepped = 0;
+    for (; stepped < _pendingCommands.size() && (int32_t)(_pendingCommands[stepped].sequence - snapshot.sequence) <= 0; stepped++)
+    {
+        if (_pendingCommands[stepped].sequence == snapshot.sequence)
+        {
+            _roundTripTime = time - _pendingTimes[stepped];
+        }
+    }
+    _pendingCommands.erase(_pendingCommands.begin(), _pendingCommands.begin() + stepped);
+    _pendingTimes.erase(_pendingTimes.begin(), _pendingTimes.begin() + stepped);
+
+    const glm::vec3 predictedPosition = _player.GetBody().position;
+
+    _player.Reset(snapshot.position, snapshot.velocity, snapshot.isOnGround);
+    for (const PlayerCommand& command : _pendingCommands)
+    {
+        _player.Tick(world, command.ToInput());
+    }
+
+    // The player keeps showing where it was predicted and eases over.
+    const glm::vec3 offset = predictedPosition - _player.GetBody().position;
+    const float error = glm::length(offset);
+    _correction = error < SNAP_DISTANCE ? _correction + offset : glm::vec3(0.0f);
+
+    if (error >= CORRECTION_EPSILON)
+    {
+        _correctionCount++;
+        _totalCorrection += error;
+        _maxCorrection = glm::max(_maxCorrection, error);
+    }
+}
+
+void PlayerPrediction::UpdateCorrection(float delta)
+{
+    _correction *= glm::pow(CORRECTION_DECAY, delta);
+}
+
+glm::vec3 PlayerPrediction::GetPosition(float interpolation) const
+{
+    return glm::mix(_player.GetPreviousPosition(), _player.GetBody().position, interpolation) + _correction;
+}
+
+SnapshotInterpolation::SnapshotInterpolation()
+    : _clockOffset(0.0), _hasClock(false), _sampleCount(0), _underrunCount(0)
+{
+}
+
+void SnapshotInterpolation::Push(const PlayerSnapshot& snapshot, double time)
+{
+    const double serverTime = snapshot.tick * Physics::TIMESTEP;
+    if (!_hasClock)
+    {
+        _clockOffset = serverTime - time;
+        _hasClock = true;
+    }
+    else
+    {
+        _clockOffset += (serverTime - time - _clockOffset) * CLOCK_SMOOTHING;
+    }
+
+    for (const RemotePlayer& remotePlayer : snapshot.remotePlayers)
+    {
+        Track& track = _tracks[remotePlayer.id];
+        track.lastSeen = time;
+
+        // Kept in order of the server's clock, whatever order they came in.
+        auto it = std::find_if(track.samples.rbegin(), track.samples.rend(), [&](const Sample& sample)
+        {
+            return sample.time <= serverTime;
+        });
+        if (it != track.samples.rend() && it->time == serverTime)
+        {
+            continue;
+        }
+        track.samples.insert(it.base(), { serverTime, remotePlayer.position, remotePlayer.yaw });
+        if (track.samples.size() > HISTORY)
+        {
+            track.samples.pop_front();
+        }
+    }
+}
+
+void SnapshotInterpolation::Update(double time)
+{
+    std::erase_if(_tracks, [time](const auto& item) { return time - item.second.lastSeen > TIMEOUT; });
+
+    const double renderTime = time + _clockOffset - DELAY;
+    _players.clear();
+    for (auto& [id, track] : _tracks)
+    {
+        std::deque<Sample>& samples = track.samples;
+        while (samples.size() > 2 && samples[1].time <= renderTime)
+        {
+            samples.pop_front();
+        }
+
+        RemotePlayer player = { id, samples.back().position, samples.back().yaw };
+        if (samples.size() >= 2 && samples[0].time <= renderTime && renderTime <= samples[1].time)
+        {
+            const float t = (float)((renderTime - samples[0].time) / (samples[1].time - samples[0].time));
+            player.position = glm::mix(samples[0].position, samples[1].position, t);
+            // The short way around.
+            const float turn = std::remainder(samples[1].yaw - samples[0].yaw, glm::radians(360.0f));
+            player.yaw = samples[0].yaw + turn * t;
+        }
+        else if (renderTime < samples.front().time)
+        {
+            player.position = samples.front().position;
+            player.yaw = samples.front().yaw;
+        }
+        else
+        {
+            _underrunCount++;
+        }
+
+        _sampleCount++;
+        _players.push_back(player);
+    }
+}
+
+} // namespace Krafter
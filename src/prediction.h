@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "player.h"
+#include "protocol.h"
+
+namespace Krafter
+{
+
+class World;
+
+// One tick of a player's input, the same for the client predicting it and
+// the server stepping it, so both end up in the same place.
+struct PlayerCommand
+{
+    // Counts up from 1 with every tick.
+    uint32_t sequence;
+    // As in Camera.
+    float yaw;
+    float pitch;
+    // Sideways and forward, each -1, 0 or 1.
+    glm::vec2 movement;
+    bool isJumping;
+    bool isFlying;
+    // Only sent while flying, where the body follows the camera.
+    glm::vec3 cameraPosition;
+
+    PlayerInput ToInput() const;
+
+    // Written as u32 sequence, f32 yaw, f32 pitch, i8 sideways, i8 forward,
+    // u8 flags and, while flying, vec3 camera position.
+    void Write(PacketWriter& writer) const;
+    static PlayerCommand Read(PacketReader& reader);
+};
+
+struct RemotePlayer
+{
+    uint32_t id;
+    glm::vec3 position;
+    float yaw;
+};
+
+// Where the server put a player after a tick, along with the nearest other
+// players.
+struct PlayerSnapshot
+{
+    uint32_t tick;
+    // The last command the server stepped the player with, 0 if none.
+    uint32_t sequence;
+    glm::vec3 position;
+    glm::vec3 velocity;
+    bool isOnGround;
+    std::vector<RemotePlayer> remotePlayers;
+
+    // Written as u32 tick, u32 sequence, vec3 position, vec3 velocity, u8 on
+    // ground, u8 remote count, and u32 id, vec3 position and f32 yaw for
+    // every remote player.
+    void Write(PacketWriter& writer) const;
+    static PlayerSnapshot Read(PacketReader& reader);
+};
+
+// Steps the local player right away with the same physics as the server,
+// keeping every command the server has not stepped yet. Once a snapshot
+// comes back the player is put where the server had it and the newer
+// commands are replayed on top; whatever that moved the player by is eased
+// out over a few frames instead of snapped to.
+class PlayerPrediction
+{
+public:
+    // About two seconds of commands; older ones are given up on.
+    static constexpr size_t MAX_PENDING_COMMANDS = 128;
+    // Corrections shrink by this factor every second, and bigger ones than
+    // the distance are snapped to.
+    static constexpr float CORRECTION_DECAY = 1e-4f;
+    static constexpr float SNAP_DISTANCE = 4.0f;
+    // Smaller differences than this count as a correct prediction.
+    static constexpr float CORRECTION_EPSILON = 1e-3f;
+
+    PlayerPrediction(const glm::vec3& position);
+
+    // Numbers the command, steps the player with it and keeps it until the
+    // server has stepped it too. The time is when it was sent, on
+    // Timer::GetTime().
+    const PlayerCommand& Predict(const World& world, const PlayerCommand& command, double time);
+    // Drops the commands the snapshot covers and replays the rest from it.
+    // The time is when it arrived.
+    void Reconcile(const World& world, const PlayerSnapshot& snapshot, double time);
+    // Once per frame.
+    void UpdateCorrection(float delta);
+
+    // Oldest first.
+    inline std::span<const PlayerCommand> GetPendingCommands() const { return _pendingCommands; }
+    inline const PhysicsBody& GetBody() const { return _player.GetBody(); }
+    // Between the last two predicted ticks, with the correction left over.
+    glm::vec3 GetPosition(float interpolation) const;
+
+    inline uint32_t GetCorrectionCount() const { return _correctionCount; }
+    inline float GetTotalCorrection() const { return _totalCorrection; }
+    inline float GetMaxCorrection() const { return _maxCorrection; }
+    // From sending a command to getting the snapshot that stepped it.
+    inline double GetRoundTripTime() const { return _roundTripTime; }
+
+private:
+    Player _player;
+    std::vector<PlayerCommand> _pendingCommands;
+    std::vector<double> _pendingTimes;
+    uint32_t _nextSequence;
+    uint32_t _acknowledgedSequence;
+    glm::vec3 _correction;
+
+    uint32_t _correctionCount;
+    float _totalCorrection;
+    float _maxCorrection;
+    double _roundTripTime;
+};
+
+// Plays the other players back a fixed delay behind the newest snapshot, so
+// that even when datagrams come late, out of order or not at all there are
+// nearly always two snapshots around to interpolate between.
+class SnapshotInterpolation
+{
+public:
+    static constexpr double DELAY = 0.1;
+    // Snapshots kept per player, and how long a player that stopped showing
+    // up in them is kept around.
+    static constexpr size_t HISTORY = 64;
+    static constexpr double TIMEOUT = 1.0;
+    // How fast the estimate of the server clock follows new snapshots; slow
+    // enough to average out the jitter, fast enough to follow a server
+    // that falls behind.
+    static constexpr double CLOCK_SMOOTHING = 0.02;
+
+    SnapshotInterpolation();
+
+    // The time is when the snapshot arrived, on Timer::GetTime().
+    void Push(const PlayerSnapshot& snapshot, double time);
+    // Samples every player at the time, less the delay.
+    void Update(double time);
+
+    inline const std::vector<RemotePlayer>& GetPlayers() const { return _players; }
+    inline uint64_t GetSampleCount() const { return _sampleCount; }
+    // Samples that had to hold the newest snapshot since none was after the
+    // time yet.
+    inline uint64_t GetUnderrunCount() const { return _underrunCount; }
+
+private:
+    struct Sample
+    {
+        // On the server's clock.
+        double time;
+        glm::vec3 position;
+        float yaw;
+    };
+
+    struct Track
+    {
+        std::deque<Sample> samples;
+        double lastSeen;
+    };
+
+    std::unordered_map<uint32_t, Track> _tracks;
+    std::vector<RemotePlayer> _players;
+    // The server's clock less the local one.
+    double _clockOffset;
+    bool _hasClock;
+
+    uint64_t _sampleCount;
+    uint64_t _underrunCount;
+};
+
+} // namespace Krafter
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "timer.h"
+#include "world.h"
+#include "server.h"
+#include "prediction_test.h"
+
+namespace Krafter
+{
+
+// Counts the frames where something moving visibly hitches: it stands
+// still for a frame or jumps ahead by more than twice as far as in the
+// frames around it. Running into a wall only changes the speed once, so it
+// does not count.
+class HitchCounter
+{
+public:
+    HitchCounter() : _positionCount(0), _position(0.0f), _speeds{}, _frameCount(0), _hitchCount(0) {}
+
+    void Add(const glm::vec3& position, float delta)
+    {
+        if (_positionCount++ > 0)
+        {
+            _speeds[0] = _speeds[1];
+            _speeds[1] = _speeds[2];
+            _speeds[2] = glm::length(position - _position) / delta;
+        }
+        _position = position;
+
+        // Each frame is judged once the one after it is known.
+        if (_positionCount >= 4)
+        {
+            const float neighbor = glm::min(_speeds[0], _speeds[2]);
+            const bool isStill = _speeds[1] < MIN_SPEED && neighbor >= MIN_SPEED;
+            const bool isJump = _speeds[1] >= MIN_SPEED && _speeds[1] > 2.0f * glm::max(_speeds[0], _speeds[2]);
+            _hitchCount += isStill || isJump;
+            _frameCount++;
+        }
+    }
+
+    inline uint64_t GetFrameCount() const { return _frameCount; }
+    inline uint64_t GetHitchCount() const { return _hitchCount; }
+
+private:
+    // In blocks per second.
+    static constexpr float MIN_SPEED = 0.1f;
+
+    uint64_t _positionCount;
+    glm::vec3 _position;
+    float _speeds[3];
+    uint64_t _frameCount;
+    uint64_t _hitchCount;
+};
+
+bool PredictionTest::Run(const NetworkConditions& conditions, double duration)
+{
+    Server::Init(0, "", VIEW_DISTANCE);
+    if (!Server::Get()->IsListening())
+    {
+        Server::Deinit();
+        return false;
+    }
+    std::thread serverThread = std::thread([] { Server::Get()->Run(); });
+
+    struct TestClient
+    {
+        std::unique_ptr<NetworkClient> client;
+        std::unique_ptr<PlayerPrediction> prediction;
+        SnapshotInterpolation interpolation;
+        float yaw;
+        uint32_t tick;
+        HitchCounter localHitches;
+        std::unordered_map<uint32_t, HitchCounter> interpolatedHitches;
+        std::unordered_map<uint32_t, HitchCounter> newestHitches;
+        std::unordered_map<uint32_t, glm::vec3> newestPositions;
+    };
+
+    std::vector<TestClient> clients = std::vector<TestClient>(CLIENT_COUNT);
+    for (uint32_t i = 0; i < clients.size(); i++)
+    {
+        clients[i].client = std::make_unique<NetworkClient>(Socket::Address { Socket::LOOPBACK, Server::Get()->GetPort() });
+        clients[i].client->SetConditions(conditions);
+        clients[i].yaw = 6.2831853f * i / clients.size();
+        clients[i].tick = 0;
+    }
+
+    // Both sides step through the same world here, which the server holds
+    // while it ticks; a real client would step through the chunks it was
+    // sent.
+    const World& world = *World::Get();
+    const float delta = (float)Physics::TIMESTEP;
+
+    Timer timer;
+    double nextTick = 0.0;
+    uint64_t predictedCount = 0;
+    double totalRoundTripTime = 0.0;
+    uint64_t roundTripCount = 0;
+    double lastTime = Timer::GetTime();
+    while (timer.GetElapsedSeconds() < duration)
+    {
+        const double elapsed = timer.GetElapsedSeconds();
+        if (elapsed < nextTick)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(nextTick - elapsed));
+            continue;
+        }
+        nextTick += Physics::TIMESTEP;
+
+        // Remote players are sampled at the actual time, which is only about
+        // a tick after the last one.
+        const double time = Timer::GetTime();
+        const float frameDelta = (float)(time - lastTime);
+        lastTime = time;
+        for (uint32_t i = 0; i < clients.size(); i++)
+        {
+            TestClient& client = clients[i];
+            client.client->Update();
+            if (!client.client->HasJoined())
+            {
+                continue;
+            }
+            if (!client.prediction)
+            {
+                client.prediction = std::make_unique<PlayerPrediction>(client.client->GetSpawnPosition());
+            }
+
+            std::shared_lock<std::shared_mutex> lock = std::shared_lock<std::shared_mutex>(world.GetMutex());
+
+            for (const auto& [snapshot, arrivalTime] : client.client->GetSnapshots())
+            {
+                client.prediction->Reconcile(world, snapshot, arrivalTime);
+                client.interpolation.Push(snapshot, arrivalTime);
+                for (const RemotePlayer& remotePlayer : snapshot.remotePlayers)
+                {
+                    client.newestPositions[remotePlayer.id] = remotePlayer.position;
+                }
+            }
+
+            // Walking forward while slowly turning, with a jump now and then.
+            const bool isFlying = client.tick++ < FLY_TICKS;
+            client.yaw += isFlying ? 0.0f : TURN_SPEED * delta;
+            const glm::vec3 corner = glm::vec3((float)(Chunk::WIDTH * i), client.client->GetSpawnPosition().y, 0.0f);
+            const PlayerCommand command = {
+                .sequence = 0,
+                .yaw = client.yaw,
+                .pitch = 0.0f,
+                .movement = glm::vec2(0.0f, 1.0f),
+                .isJumping = (client.tick + i * 17) % JUMP_INTERVAL == 0,
+                .isFlying = isFlying,
+                .cameraPosition = corner + glm::vec3(0.0f, Player::EYE_HEIGHT, 0.0f)
+            };
+            client.prediction->Predict(world, command, time);
+            lock.unlock();
+
+            client.client->SendCommands(client.prediction->GetPendingCommands());
+            client.prediction->UpdateCorrection(delta);
+            client.interpolation.Update(time);
+            predictedCount++;
+
+            if (client.prediction->GetRoundTripTime() > 0.0)
+            {
+                totalRoundTripTime += client.prediction->GetRoundTripTime();
+                roundTripCount++;
+            }
+
+            if (elapsed < WARMUP)
+            {
+                continue;
+            }
+            client.localHitches.Add(client.prediction->GetPosition(1.0f), delta);
+            for (const RemotePlayer& remotePlayer : client.interpolation.GetPlayers())
+            {
+                client.interpolatedHitches[remotePlayer.id].Add(remotePlayer.position, frameDelta);
+            }
+            for (const auto& [id, position] : client.newestPositions)
+            {
+                client.newestHitches[id].Add(position, frameDelta);
+            }
+        }
+    }
+
+    Server::Get()->Stop();
+    serverThread.join();
+
+    uint32_t correctionCount = 0;
+    float totalCorrection = 0.0f;
+    float maxCorrection = 0.0f;
+    uint64_t sampleCount = 0;
+    uint64_t underrunCount = 0;
+    uint64_t localFrames = 0;
+    uint64_t localHitches = 0;
+    uint64_t interpolatedFrames = 0;
+    uint64_t interpolatedHitches = 0;
+    uint64_t newestFrames = 0;
+    uint64_t newestHitches = 0;
+    for (const TestClient& client : clients)
+    {
+        if (client.prediction)
+        {
+            correctionCount += client.prediction->GetCorrectionCount();
+            totalCorrection += client.prediction->GetTotalCorrection();
+            maxCorrection = glm::max(maxCorrection, client.prediction->GetMaxCorrection());
+        }
+        sampleCount += client.interpolation.GetSampleCount();
+        underrunCount += client.interpolation.GetUnderrunCount();
+
+        localFrames += client.localHitches.GetFrameCount();
+        localHitches += client.localHitches.GetHitchCount();
+        for (const auto& [id, hitches] : client.interpolatedHitches)
+        {
+            interpolatedFrames += hitches.GetFrameCount();
+            interpolatedHitches += hitches.GetHitchCount();
+        }
+        for (const auto& [id, hitches] : client.newestHitches)
+        {
+            newestFrames += hitches.GetFrameCount();
+            newestHitches += hitches.GetHitchCount();
+        }
+    }
+    clients.clear();
+    Server::Deinit();
+
+    std::cout << "[PREDICT] " << CLIENT_COUNT << " clients over " << timer.GetElapsedSeconds() << " s, "
+        << conditions.latency * 1000.0 << " ms latency, " << conditions.jitter * 1000.0 << " ms jitter, "
+        << conditions.loss * 100.0f << "% loss" << std::endl;
+    std::cout << "[PREDICT] Round trip: avg " << totalRoundTripTime / glm::max(roundTripCount, (uint64_t)1) * 1000.0 << " ms" << std::endl;
+    std::cout << "[PREDICT] Corrections: " << correctionCount << " over " << predictedCount << " predicted ticks, avg "
+        << totalCorrection / glm::max(correctionCount, 1u) << ", max " << maxCorrection << " blocks" << std::endl;
+    std::cout << "[PREDICT] Remote players: " << underrunCount << " of " << sampleCount << " samples ran out of snapshots" << std::endl;
+    std::cout << "[PREDICT] Hitches: local " << localHitches << " of " << localFrames << " frames, interpolated "
+        << interpolatedHitches << " of " << interpolatedFrames << ", newest snapshot " << newestHitches << " of " << newestFrames << std::endl;
+
+    return true;
+}
+
+} // namespace Krafter
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include "network_client.h"
+
+namespace Krafter
+{
+
+// Runs a server on loopback with a few clients walking and jumping through
+// the world over a network with the given latency and jitter. Each client
+// predicts its own player and interpolates the others, and the test reports
+// how often and how far predictions were corrected and how often the
+// players visibly hitched, compared to showing the newest snapshot. Started with
+// `krafter_server --prediction-test <latency ms> <jitter ms> [loss %]
+// [seconds]`.
+class PredictionTest
+{
+public:
+    static constexpr int32_t VIEW_DISTANCE = 4;
+    static constexpr uint32_t CLIENT_COUNT = 4;
+    // How fast the clients turn while walking, in radians per second, and
+    // how often they jump.
+    static constexpr float TURN_SPEED = 0.4f;
+    static constexpr uint32_t JUMP_INTERVAL = 90;
+    // The spawn is inside the terrain, so the clients first fly to the
+    // shafts at the corners of the chunks around it and drop down them.
+    static constexpr uint32_t FLY_TICKS = 30;
+    // Hitches are only counted after the flight and the drop.
+    static constexpr double WARMUP = 3.0;
+
+    // Returns false if the server could not be started.
+    static bool Run(const NetworkConditions& conditions, double duration);
+};
+
+} // namespace Krafter
@@ -0,0 +1,172 @@
+#include "protocol.h"
+
+namespace Krafter
+{
+
+void PacketWriter::Write(const glm::vec3& value)
+{
+    Write(value.x);
+    Write(value.y);
+    Write(value.z);
+}
+
+void PacketWriter::Write(const glm::ivec3& value)
+{
+    Write(value.x);
+    Write(value.y);
+    Write(value.z);
+}
+
+void PacketWriter::WriteVarint(uint32_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+    {
+        _data.push_back((uint8_t)(value | 0x80));
+    }
+    _data.push_back((uint8_t)value);
+}
+
+void PacketWriter::WriteBytes(const void* data, size_t size)
+{
+    _data.insert(_data.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+void PacketWriter::BeginMessage(MessageType type)
+{
+    _messageStart = _data.size();
+    Write<uint32_t>(0);
+    Write(type);
+}
+
+void PacketWriter::EndMessage()
+{
+    const uint32_t size = _data.size() - _messageStart - sizeof(uint32_t);
+    std::memcpy(_data.data() + _messageStart, &size, sizeof(uint32_t));
+}
+
+glm::vec3 PacketReader::ReadVec3()
+{
+    float x = Read<float>();
+    float y = Read<float>();
+    float z = Read<float>();
+    return glm::vec3(x, y, z);
+}
+
+glm::ivec3 PacketReader::ReadIvec3()
+{
+    int32_t x = Read<int32_t>();
+    int32_t y = Read<int32_t>();
+    int32_t z = Read<int32_t>();
+    return glm::ivec3(x, y, z);
+}
+
+uint32_t PacketReader::ReadVarint()
+{
+    uint32_t value = 0;
+    for (uint32_t shift = 0; shift <= 28; shift += 7)
+    {
+        const uint8_t* byte = ReadBytes(1);
+        if (!byte)
+        {
+            return 0;
+        }
+
+        value |= (uint32_t)(*byte & 0x7F) << shift;
+        if (!(*byte & 0x80))
+        {
+            return value;
+        }
+    }
+
+    _isValid = false;
+    return 0;
+}
+
+const uint8_t* PacketReader::ReadBytes(size_t size)
+{
+    if (!_isValid || _size - _offset < size)
+    {
+        _isValid = false;
+        return nullptr;
+    }
+
+    const uint8_t* data = _data + _offset;
+    _offset += size;
+    return data;
+}
+
+Connection::Connection(Socket socket)
+    : _socket(std::move(socket)), _outgoingOffset(0), _bytesSent(0), _bytesReceived(0)
+{
+}
+
+void Connection::Close()
+{
+    _socket = Socket();
+    _outgoing.clear();
+    _outgoingOffset = 0;
+}
+
+void Connection::Send(const PacketWriter& writer)
+{
+    if (IsOpen())
+    {
+        _outgoing.insert(_outgoing.end(), writer.GetData().begin(), writer.GetData().end());
+    }
+}
+
+void Connection::Flush()
+{
+    while (IsOpen() && _outgoingOffset < _outgoing.size())
+    {
+        int64_t result = _socket.Send(_outgoing.data() + _outgoingOffset, _outgoing.size() - _outgoingOffset);
+        if (result < 0)
+        {
+            Close();
+            return;
+        }
+        if (result == 0)
+        {
+            break;
+        }
+
+        _outgoingOffset += result;
+        _bytesSent += result;
+    }
+
+    // The sent bytes are only dropped once they make up most of the queue,
+    // so a slow client does not cause a copy of its backlog every frame.
+    if (_outgoingOffset == _outgoing.size())
+    {
+        _outgoing.clear();
+        _outgoingOffset = 0;
+    }
+    else if (_outgoingOffset > _outgoing.size() / 2)
+    {
+        _outgoing.erase(_outgoing.begin(), _outgoing.begin() + _outgoingOffset);
+        _outgoingOffset = 0;
+    }
+}
+
+void Connection::ReceiveBytes()
+{
+    uint8_t buffer[16384];
+    while (IsOpen())
+    {
+        int64_t result = _socket.Receive(buffer, sizeof(buffer));
+        if (result < 0)
+        {
+            Close();
+            return;
+        }
+        if (result == 0)
+        {
+            break;
+        }
+
+        _incoming.insert(_incoming.end(), buffer, buffer + result);
+        _bytesReceived += result;
+    }
+}
+
+} // namespace Krafter
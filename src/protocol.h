@@ -0,0 +1,192 @@
+#pragma once
+
+#include <vector>
+#include <bit>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "glm/glm.hpp"
+
+#include "socket.h"
+
+namespace Krafter
+{
+
+// Everything goes over one TCP connection per client, except for the player
+// inputs and states, which are sent every tick and only the latest ones
+// matter, so they go over UDP and may get lost.
+enum class MessageType : uint8_t
+{
+    // Client to server: u32 protocol version.
+    HELLO,
+    // Server to client: u32 client id, u32 token, i32 view distance, vec3
+    // spawn position.
+    WELCOME,
+    // Server to client: i32 x, i32 z, varint size, ChunkCodec data.
+    CHUNK,
+    // Server to client: i32 x, i32 z.
+    UNLOAD_CHUNK,
+    // Client to server: ivec3 position, u8 block.
+    BLOCK_EDIT,
+    // Server to client, once per tick: varint section count, then for each
+    // section i32 chunk x, i32 chunk z, u8 section, varint change count, and
+    // u16 index within the section and u8 block for every change.
+    BLOCK_CHANGES,
+    // Client to server over UDP: u32 client id, u32 token, u8 command count,
+    // then the newest few PlayerCommands, oldest first.
+    PLAYER_INPUT,
+    // Server to client over UDP, once per tick: a PlayerSnapshot.
+    PLAYER_STATE
+};
+
+class Protocol
+{
+public:
+    static constexpr uint32_t VERSION = 4;
+    static constexpr uint16_t DEFAULT_PORT = 41000;
+    // Bigger messages are taken as a broken stream.
+    static constexpr uint32_t MAX_MESSAGE_SIZE = 1 << 20;
+    static constexpr size_t MAX_DATAGRAM_SIZE = 512;
+};
+
+// Values are written in little endian, which is what every platform we run
+// on uses natively.
+static_assert(std::endian::native == std::endian::little);
+
+class PacketWriter
+{
+public:
+    PacketWriter() : _messageStart(0) {}
+
+    template<typename T>
+    void Write(T value)
+    {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+        const size_t offset = _data.size();
+        _data.resize(offset + sizeof(T));
+        std::memcpy(_data.data() + offset, &value, sizeof(T));
+    }
+
+    void Write(const glm::vec3& value);
+    void Write(const glm::ivec3& value);
+    void WriteVarint(uint32_t value);
+    void WriteBytes(const void* data, size_t size);
+
+    // A message on a stream is framed by its size, which EndMessage() fills
+    // in; datagrams need neither.
+    void BeginMessage(MessageType type);
+    void EndMessage();
+
+    inline const std::vector<uint8_t>& GetData() const { return _data; }
+    inline std::vector<uint8_t>& GetData() { return _data; }
+    inline void Clear() { _data.clear(); }
+
+private:
+    std::vector<uint8_t> _data;
+    size_t _messageStart;
+};
+
+// Reading past the end yields zeroes and marks the reader as invalid, so a
+// message only has to be checked once it has been read completely.
+class PacketReader
+{
+public:
+    PacketReader(const uint8_t* data, size_t size) : _data(data), _size(size), _offset(0), _isValid(true) {}
+
+    template<typename T>
+    T Read()
+    {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+        T value = {};
+        if (const uint8_t* data = ReadBytes(sizeof(T)))
+        {
+            std::memcpy(&value, data, sizeof(T));
+        }
+        return value;
+    }
+
+    glm::vec3 ReadVec3();
+    glm::ivec3 ReadIvec3();
+    uint32_t ReadVarint();
+    // Returns nullptr if there are not enough bytes left.
+    const uint8_t* ReadBytes(size_t size);
+
+    inline bool IsValid() const { return _isValid; }
+    inline bool IsAtEnd() const { return _offset == _size; }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _offset;
+    bool _isValid;
+};
+
+// Splits a TCP stream into messages. Sends are queued and written out as
+// far as the socket takes them, so neither side ever blocks on the other.
+class Connection
+{
+public:
+    Connection(Socket socket);
+
+    inline bool IsOpen() const { return _socket.IsValid(); }
+    void Close();
+
+    // Queues everything written into the writer.
+    void Send(const PacketWriter& writer);
+    void Flush();
+    inline size_t GetQueuedSize() const { return _outgoing.size() - _outgoingOffset; }
+
+    // Calls function(type, reader) for every complete message that arrived,
+    // which returns false if the message was malformed. A malformed stream
+    // or message closes the connection.
+    template<typename Function>
+    void Receive(Function&& function)
+    {
+        ReceiveBytes();
+
+        size_t offset = 0;
+        while (_incoming.size() - offset >= sizeof(uint32_t))
+        {
+            uint32_t size;
+            std::memcpy(&size, _incoming.data() + offset, sizeof(uint32_t));
+            if (size == 0 || size > Protocol::MAX_MESSAGE_SIZE)
+            {
+                Close();
+                return;
+            }
+            if (_incoming.size() - offset - sizeof(uint32_t) < size)
+            {
+                break;
+            }
+
+            const uint8_t* message = _incoming.data() + offset + sizeof(uint32_t);
+            PacketReader reader = PacketReader(message + 1, size - 1);
+            offset += sizeof(uint32_t) + size;
+            if (!function((MessageType)message[0], reader))
+            {
+                Close();
+                return;
+            }
+        }
+        _incoming.erase(_incoming.begin(), _incoming.begin() + offset);
+    }
+
+    inline uint64_t GetBytesSent() const { return _bytesSent; }
+    inline uint64_t GetBytesReceived() const { return _bytesReceived; }
+
+private:
+    void ReceiveBytes();
+
+    Socket _socket;
+
+    std::vector<uint8_t> _outgoing;
+    size_t _outgoingOffset;
+    std::vector<uint8_t> _incoming;
+
+    uint64_t _bytesSent;
+    uint64_t _bytesReceived;
+};
+
+} // namespace Krafter
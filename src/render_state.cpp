@@ -0,0 +1,149 @@
+#include "glad/gl.h"
+
+#include "render_state.h"
+
+namespace Krafter
+{
+
+void RenderState::BindProgram(uint32_t program)
+{
+    if (Track(_program == program))
+    {
+        _program = program;
+        glUseProgram(program);
+    }
+}
+
+void RenderState::BindVertexArray(uint32_t vertexArray)
+{
+    if (Track(_vertexArray == vertexArray))
+    {
+        _vertexArray = vertexArray;
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void RenderState::BindTextureUnit(uint32_t unit, uint32_t texture)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        glBindTextureUnit(unit, texture);
+        return;
+    }
+
+    if (Track(_textures[unit] == texture))
+    {
+        _textures[unit] = texture;
+        glBindTextureUnit(unit, texture);
+    }
+}
+
+void RenderState::BindBufferRange(uint32_t target, uint32_t binding, uint32_t buffer, size_t offset, size_t size)
+{
+    BufferRange* range = GetBufferRange(target, binding);
+    if (!range)
+    {
+        glBindBufferRange(target, binding, buffer, offset, size);
+        return;
+    }
+
+    if (Track(range->buffer == buffer && range->offset == offset && range->size == size))
+    {
+        *range = { buffer, offset, size };
+        glBindBufferRange(target, binding, buffer, offset, size);
+    }
+}
+
+void RenderState::RecordDraw(uint32_t elementCount)
+{
+    _currentStats.draws++;
+    _currentStats.elements += elementCount;
+}
+
+void RenderState::WaitForFence(GLsync fence)
+{
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(fence);
+}
+
+void RenderState::Invalidate()
+{
+    _program = UNKNOWN;
+    _vertexArray = UNKNOWN;
+    _textures.fill(UNKNOWN);
+    _uniformBuffers.fill({ UNKNOWN, 0, 0 });
+    _storageBuffers.fill({ UNKNOWN, 0, 0 });
+}
+
+void RenderState::Forget(uint32_t name)
+{
+    if (_program == name)
+    {
+        _program = UNKNOWN;
+    }
+    if (_vertexArray == name)
+    {
+        _vertexArray = UNKNOWN;
+    }
+    for (uint32_t& texture : _textures)
+    {
+        if (texture == name)
+        {
+            texture = UNKNOWN;
+        }
+    }
+    for (BufferRange& range : _uniformBuffers)
+    {
+        if (range.buffer == name)
+        {
+            range.buffer = UNKNOWN;
+        }
+    }
+    for (BufferRange& range : _storageBuffers)
+    {
+        if (range.buffer == name)
+        {
+            range.buffer = UNKNOWN;
+        }
+    }
+}
+
+void RenderState::EndFrame()
+{
+    _frameStats = _currentStats;
+    _currentStats = {};
+}
+
+bool RenderState::Track(bool isRedundant)
+{
+    if (isRedundant)
+    {
+        _currentStats.skippedBinds++;
+        return false;
+    }
+
+    _currentStats.binds++;
+    return true;
+}
+
+RenderState::BufferRange* RenderState::GetBufferRange(uint32_t target, uint32_t binding)
+{
+    if (binding >= MAX_BUFFER_BINDINGS)
+    {
+        return nullptr;
+    }
+
+    switch (target)
+    {
+    case GL_UNIFORM_BUFFER:
+        return &_uniformBuffers[binding];
+    case GL_SHADER_STORAGE_BUFFER:
+        return &_storageBuffers[binding];
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace Krafter
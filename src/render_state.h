@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+typedef struct __GLsync* GLsync;
+
+namespace Krafter
+{
+
+// Shadows the GL bindings made through it and skips the ones that would
+// not change anything. Code that touches GL behind its back (like ImGui's
+// backend) has to be followed by Invalidate().
+class RenderState
+{
+public:
+    struct Stats
+    {
+        uint32_t binds;
+        uint32_t skippedBinds;
+        uint32_t draws;
+        uint64_t elements;
+    };
+
+    static void BindProgram(uint32_t program);
+    static void BindVertexArray(uint32_t vertexArray);
+    static void BindTextureUnit(uint32_t unit, uint32_t texture);
+    static void BindBufferRange(uint32_t target, uint32_t binding, uint32_t buffer, size_t offset, size_t size);
+
+    static void RecordDraw(uint32_t elementCount);
+
+    // Blocks until the GPU is past the fence, flushing the commands before
+    // it, then deletes it.
+    static void WaitForFence(GLsync fence);
+
+    static void Invalidate();
+    // Drops whatever is tracked as bound under the name, to be called when
+    // deleting an object; GL may hand the name out again right away, and
+    // binding the new object must not be skipped. Names of different kinds
+    // of objects can match, which only costs a bind.
+    static void Forget(uint32_t name);
+    static void EndFrame();
+
+    inline static const Stats& GetFrameStats() { return _frameStats; }
+
+private:
+    // Never a valid object name, so anything compared against it is rebound.
+    static constexpr uint32_t UNKNOWN = UINT32_MAX;
+
+    static constexpr uint32_t MAX_TEXTURE_UNITS = 16;
+    static constexpr uint32_t MAX_BUFFER_BINDINGS = 16;
+
+    struct BufferRange
+    {
+        uint32_t buffer;
+        size_t offset;
+        size_t size;
+    };
+
+    static bool Track(bool isRedundant);
+    static BufferRange* GetBufferRange(uint32_t target, uint32_t binding);
+
+    // The tracked values start out matching GL's initial state.
+    inline static uint32_t _program;
+    inline static uint32_t _vertexArray;
+    inline static std::array<uint32_t, MAX_TEXTURE_UNITS> _textures;
+    inline static std::array<BufferRange, MAX_BUFFER_BINDINGS> _uniformBuffers;
+    inline static std::array<BufferRange, MAX_BUFFER_BINDINGS> _storageBuffers;
+
+    inline static Stats _currentStats;
+    inline static Stats _frameStats;
+};
+
+} // namespace Krafter
@@ -0,0 +1,117 @@
+#include "timer.h"
+#include "window.h"
+#include "render_thread.h"
+
+namespace Krafter
+{
+
+void RenderThread::Init(bool isThreaded)
+{
+    _instance = new RenderThread(isThreaded);
+}
+
+void RenderThread::Deinit()
+{
+    delete _instance;
+}
+
+void RenderThread::Submit()
+{
+    if (!_isThreaded)
+    {
+        Execute(_packets[_recordIndex]);
+        return;
+    }
+
+    Timer waitTimer;
+    {
+        std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(_mutex);
+        _condition.wait(lock, [this] { return !_isBusy; });
+        _isBusy = true;
+        _recordIndex = (_recordIndex + 1) % PACKET_COUNT;
+    }
+    _condition.notify_all();
+    _waitTime = waitTimer.GetElapsedMilliseconds();
+}
+
+void RenderThread::Flush()
+{
+    if (!_isThreaded)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(_mutex);
+    _condition.wait(lock, [this] { return !_isBusy; });
+}
+
+void RenderThread::Run()
+{
+    Window::Get()->SetContextCurrent(true);
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(_mutex);
+        _condition.wait(lock, [this] { return _isBusy || _isStopping; });
+        if (!_isBusy)
+        {
+            break;
+        }
+
+        // The game thread already moved on to the other packet.
+        const uint32_t executeIndex = (_recordIndex + PACKET_COUNT - 1) % PACKET_COUNT;
+        lock.unlock();
+        Execute(_packets[executeIndex]);
+        lock.lock();
+
+        _isBusy = false;
+        lock.unlock();
+        _condition.notify_all();
+    }
+
+    Window::Get()->SetContextCurrent(false);
+}
+
+void RenderThread::Execute(std::vector<std::function<void()>>& packet)
+{
+    Timer executeTimer;
+    for (const std::function<void()>& command : packet)
+    {
+        command();
+    }
+    // Cleared here, so whatever the commands captured is freed on this
+    // thread.
+    packet.clear();
+    _executeTime = executeTimer.GetElapsedMilliseconds();
+}
+
+RenderThread::RenderThread(bool isThreaded)
+    : _isThreaded(isThreaded), _recordIndex(0), _isBusy(false), _isStopping(false), _executeTime(0.0), _waitTime(0.0)
+{
+    if (_isThreaded)
+    {
+        Window::Get()->SetContextCurrent(false);
+        _thread = std::thread(&RenderThread::Run, this);
+    }
+}
+
+RenderThread::~RenderThread()
+{
+    Submit();
+    if (!_isThreaded)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(_mutex);
+        _condition.wait(lock, [this] { return !_isBusy; });
+        _isStopping = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+
+    Window::Get()->SetContextCurrent(true);
+}
+
+} // namespace Krafter
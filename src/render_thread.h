@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+namespace Krafter
+{
+
+// Owns the GL context and runs everything that touches it on a thread of
+// its own. The game thread records a frame as a packet of commands and
+// submits it; while the render thread runs that packet the game thread
+// already records the next one, so the simulation, meshing and input of a
+// frame overlap with the GL submission of the one before. There are only two
+// packets, so the game thread is never more than a frame ahead.
+class RenderThread
+{
+public:
+    static constexpr uint32_t PACKET_COUNT = 2;
+
+    // Takes the GL context over from the calling thread, which gets it back
+    // in Deinit(). Not threaded, every packet runs on the calling thread as
+    // soon as it is submitted, to compare against.
+    static void Init(bool isThreaded = true);
+    // Runs whatever was submitted first.
+    static void Deinit();
+    inline static RenderThread* Get() { return _instance; }
+
+    // Adds a command to the packet being recorded. Whatever it refers to has
+    // to be captured by value or outlive the packet.
+    inline void Record(std::function<void()> command) { _packets[_recordIndex].push_back(std::move(command)); }
+    // Hands the packet over and starts the next one, waiting for the render
+    // thread to finish the one before if it is still busy.
+    void Submit();
+    // Waits for the render thread to finish every submitted packet.
+    void Flush();
+
+    inline bool IsThreaded() const { return _isThreaded; }
+    // In milliseconds; how long the render thread took for the last packet,
+    // and how long the game thread last waited for it.
+    inline double GetExecuteTime() const { return _executeTime; }
+    inline double GetWaitTime() const { return _waitTime; }
+
+private:
+    inline static RenderThread* _instance;
+
+    RenderThread(bool isThreaded);
+    ~RenderThread();
+
+    void Run();
+    void Execute(std::vector<std::function<void()>>& packet);
+
+    bool _isThreaded;
+    std::thread _thread;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::array<std::vector<std::function<void()>>, PACKET_COUNT> _packets;
+    uint32_t _recordIndex;
+    // Set from submitting a packet until it ran.
+    bool _isBusy;
+    bool _isStopping;
+
+    std::atomic<double> _executeTime;
+    double _waitTime;
+};
+
+} // namespace Krafter
@@ -1,83 +1,163 @@
 #include <utility>
+#include <algorithm>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <shared_mutex>
+#include <cmath>
 
 #include "glad/gl.h"
-#include "GLFW/glfw3.h"
 #include "imgui.h"
 #include "glm/gtc/type_ptr.hpp"
-#include "stb_image.h"
 
+#include "texture_cache.h"
+#include "timer.h"
+#include "window.h"
+#include "thread_pool.h"
+#include "world.h"
+#include "render_state.h"
 #include "renderer.h"
+#include "particle_system.h"
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
 
 namespace Krafter
 {
 
-Texture2D::Texture2D(std::string_view path)
+Texture2DArray::Texture2DArray(std::string_view atlasPath, std::string_view cachePath, uint32_t tilesPerRow)
 {
-    stbi_set_flip_vertically_on_load(true);
-
-    int32_t channels_in_file;
-    uint8_t* data = stbi_load(path.data(), &_size.x, &_size.y, &channels_in_file, 0);
-    if (!data)
+    Timer timer;
+
+    // Decoding the atlas, building its mip chain and compressing it only
+    // happens when the cache is missing or older than the atlas.
+    uint64_t sourceStamp = TextureArrayImage::GetSourceStamp(atlasPath);
+    std::optional<TextureArrayImage> image = TextureArrayImage::LoadFromCache(cachePath, sourceStamp);
+    bool isCached = image.has_value();
+    if (!isCached)
     {
-        std::cerr << "[FILE] Could not read " << path << std::endl;
-        assert(false);
+        image = TextureArrayImage::LoadFromAtlas(atlasPath, tilesPerRow, true, sourceStamp);
+        assert(image.has_value());
+        image->SaveToCache(cachePath);
     }
 
-    glCreateTextures(GL_TEXTURE_2D, 1, &_id);
+    _tileSize = image->GetTileSize();
+    _layerCount = image->GetLayerCount();
+    _mipLevelCount = image->GetMipLevelCount();
+    _isCompressed = image->IsCompressed();
+
+    const uint32_t format = _isCompressed ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_RGBA8;
 
-    glTextureParameteri(_id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &_id);
+
+    // Every tile is its own layer, so wrapping and mip filtering never reach
+    // into the neighboring tiles of the atlas.
+    glTextureParameteri(_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTextureParameteri(_id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameteri(_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(_id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(_id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    _anisotropy = GetMaxAnisotropy();
+    if (_anisotropy > 1.0f)
+    {
+        glTextureParameterf(_id, GL_TEXTURE_MAX_ANISOTROPY, _anisotropy);
+    }
 
-    glTextureStorage2D(_id, 1, GL_RGBA8, _size.x, _size.y);
-    glTextureSubImage2D(_id, 0, 0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glTextureStorage3D(_id, _mipLevelCount, format, _tileSize.x, _tileSize.y, _layerCount);
 
-    stbi_image_free(data);
+    for (uint32_t level = 0; level < _mipLevelCount; level++)
+    {
+        TextureArrayImage::MipLevel mip = image->GetMipLevel(level);
+        if (_isCompressed)
+        {
+            glCompressedTextureSubImage3D(_id, level, 0, 0, 0, mip.size.x, mip.size.y, _layerCount,
+                format, mip.byteSize, mip.data);
+        }
+        else
+        {
+            glTextureSubImage3D(_id, level, 0, 0, 0, mip.size.x, mip.size.y, _layerCount,
+                GL_RGBA, GL_UNSIGNED_BYTE, mip.data);
+        }
+    }
+
+    _loadTime = timer.GetElapsedMilliseconds();
+    std::cout << "[TEXTURE] Loaded " << atlasPath << (isCached ? " from cache" : "")
+        << " in " << _loadTime << " ms" << std::endl;
 }
 
-Texture2D::~Texture2D()
+Texture2DArray::~Texture2DArray()
 {
+    RenderState::Forget(_id);
     glDeleteTextures(1, &_id);
 }
 
-void Texture2D::Bind(uint32_t unit) const
+void Texture2DArray::Bind(uint32_t unit) const
 {
-    glBindTextureUnit(unit, _id);
+    RenderState::BindTextureUnit(unit, _id);
 }
 
-ShaderProgram::ShaderProgram(std::string_view vertexShaderPath, std::string_view fragmentShaderPath)
+float Texture2DArray::GetMaxAnisotropy()
 {
-    std::string vertexShaderSource = std::move(ReadFileAsString(vertexShaderPath));
-    std::string fragmentShaderSource = std::move(ReadFileAsString(fragmentShaderPath));
-
-    _id = glCreateProgram();
-    uint32_t vertexShader = CreateShader(GL_VERTEX_SHADER, vertexShaderSource.c_str());
-    uint32_t fragmentShader = CreateShader(GL_FRAGMENT_SHADER, fragmentShaderSource.c_str());
-
-    glAttachShader(_id, vertexShader);
-    glAttachShader(_id, fragmentShader);
+    // Anisotropic filtering is only core since OpenGL 4.6, but the extension
+    // shares the same enums and is available practically everywhere.
+    int32_t extensionCount;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (int32_t i = 0; i < extensionCount; i++)
+    {
+        std::string_view extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension == "GL_ARB_texture_filter_anisotropic" || extension == "GL_EXT_texture_filter_anisotropic")
+        {
+            float anisotropy;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &anisotropy);
+            return glm::min(anisotropy, 16.0f);
+        }
+    }
 
-    glLinkProgram(_id);
-    glValidateProgram(_id);
+    return 1.0f;
+}
 
-    glDetachShader(_id, vertexShader);
-    glDetachShader(_id, fragmentShader);
+ShaderProgram::ShaderProgram(std::string_view vertexShaderPath, std::string_view fragmentShaderPath)
+    : _stages{ { GL_VERTEX_SHADER, std::string(vertexShaderPath) }, { GL_FRAGMENT_SHADER, std::string(fragmentShaderPath) } }
+{
+    _id = Build();
+    assert(_id != 0);
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+ShaderProgram::ShaderProgram(std::string_view computeShaderPath)
+    : _stages{ { GL_COMPUTE_SHADER, std::string(computeShaderPath) } }
+{
+    _id = Build();
+    assert(_id != 0);
 }
 
 ShaderProgram::~ShaderProgram()
 {
+    RenderState::Forget(_id);
     glDeleteProgram(_id);
 }
 
+bool ShaderProgram::Reload()
+{
+    uint32_t program = Build();
+    if (program == 0)
+    {
+        return false;
+    }
+
+    RenderState::Forget(_id);
+    glDeleteProgram(_id);
+    _id = program;
+    return true;
+}
+
 void ShaderProgram::Bind() const
 {
-    glUseProgram(_id);
+    RenderState::BindProgram(_id);
 }
 
 void ShaderProgram::SetUniformInt(int32_t location, int32_t value) const
@@ -85,6 +165,16 @@ void ShaderProgram::SetUniformInt(int32_t location, int32_t value) const
     glUniform1i(location, value);
 }
 
+void ShaderProgram::SetUniformUint(int32_t location, uint32_t value) const
+{
+    glUniform1ui(location, value);
+}
+
+void ShaderProgram::SetUniformFloat(int32_t location, float value) const
+{
+    glUniform1f(location, value);
+}
+
 void ShaderProgram::SetUniformVec4(int32_t location, const glm::vec4& value) const
 {
     glUniform4fv(location, 1, glm::value_ptr(value));
@@ -101,7 +191,7 @@ std::string ShaderProgram::ReadFileAsString(std::string_view path)
     if (!file)
     {
         std::cerr << "[FILE] Could not read " << path << std::endl;
-        assert(false);
+        return std::string();
     }
 
     file.seekg(0, std::ios::end);
@@ -114,85 +204,344 @@ std::string ShaderProgram::ReadFileAsString(std::string_view path)
     return result;
 }
 
-uint32_t ShaderProgram::CreateShader(uint32_t type, const char* source)
+uint32_t ShaderProgram::CreateShader(uint32_t type, const char* source, std::string_view path)
 {
     uint32_t shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, nullptr);
     glCompileShader(shader);
 
+    int32_t status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status)
+    {
+        int32_t length;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log = std::string(length, '\0');
+        glGetShaderInfoLog(shader, length, nullptr, log.data());
+        std::cerr << "[SHADER] Could not compile " << path << ":\n" << log << std::endl;
+
+        glDeleteShader(shader);
+        return 0;
+    }
+
     return shader;
 }
 
-ChunkMesh::ChunkMesh(const Chunk& chunk)
+std::string ShaderProgram::GetBinaryCachePath(const std::vector<std::string>& sources)
 {
-    std::vector<float> vertexBufferData;
-    std::vector<uint32_t> elementBufferData;
+    // Program binaries are only valid for the exact driver that produced
+    // them, so the driver strings are part of the key (FNV-1a).
+    std::vector<std::string_view> parts = std::vector<std::string_view>(sources.begin(), sources.end());
+    parts.push_back((const char*)glGetString(GL_VENDOR));
+    parts.push_back((const char*)glGetString(GL_RENDERER));
+    parts.push_back((const char*)glGetString(GL_VERSION));
+
+    uint64_t hash = 0xCBF29CE484222325;
+    for (std::string_view part : parts)
+    {
+        for (char c : part)
+        {
+            hash = (hash ^ (uint8_t)c) * 0x100000001B3;
+        }
+        hash = (hash ^ 0xFF) * 0x100000001B3;
+    }
 
-    constexpr int32_t dx[] = { -1, 1, 0, 0, 0, 0 };
-    constexpr int32_t dy[] = { 0, 0, -1, 1, 0, 0 };
-    constexpr int32_t dz[] = { 0, 0, 0, 0, -1, 1 };
-    constexpr BlockFace faces[] = {
-        BlockFace::FRONT, BlockFace::BACK,
-        BlockFace::BOTTOM, BlockFace::TOP,
-        BlockFace::LEFT, BlockFace::RIGHT
-    };
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return std::string("assets/cache/shaders/") + name + ".bin";
+}
 
-    for (int32_t x = 0; x < Chunk::WIDTH; x++)
+uint32_t ShaderProgram::LoadBinary(std::string_view cachePath)
+{
+    std::ifstream file = std::ifstream(cachePath.data(), std::ios::binary | std::ios::ate);
+    if (!file)
     {
-        for (int32_t y = 0; y < Chunk::HEIGHT; y++)
+        return 0;
+    }
+
+    std::streamsize size = (std::streamsize)file.tellg() - (std::streamsize)sizeof(uint32_t);
+    if (size <= 0)
+    {
+        return 0;
+    }
+
+    uint32_t format;
+    std::vector<char> binary = std::vector<char>(size);
+    file.seekg(0, std::ios::beg);
+    file.read((char*)&format, sizeof(format));
+    file.read(binary.data(), size);
+    if (!file)
+    {
+        return 0;
+    }
+
+    uint32_t program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), size);
+
+    // A driver update silently invalidates old binaries.
+    int32_t status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ShaderProgram::SaveBinary(uint32_t program, std::string_view cachePath)
+{
+    int32_t length;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    uint32_t format;
+    std::vector<char> binary = std::vector<char>(length);
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    std::ofstream file = std::ofstream(cachePath.data(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "[FILE] Could not write " << cachePath << std::endl;
+        return;
+    }
+
+    file.write((const char*)&format, sizeof(format));
+    file.write(binary.data(), length);
+}
+
+uint32_t ShaderProgram::Build()
+{
+    Timer timer;
+
+    std::vector<std::string> sources;
+    for (const Stage& stage : _stages)
+    {
+        sources.push_back(ReadFileAsString(stage.path));
+        if (sources.back().empty())
         {
-            for (int32_t z = 0; z < Chunk::WIDTH; z++)
+            return 0;
+        }
+    }
+
+    std::string cachePath = GetBinaryCachePath(sources);
+
+    uint32_t program = LoadBinary(cachePath);
+    _isFromBinaryCache = program != 0;
+
+    if (!_isFromBinaryCache)
+    {
+        std::vector<uint32_t> shaders;
+        for (size_t i = 0; i < _stages.size(); i++)
+        {
+            shaders.push_back(CreateShader(_stages[i].type, sources[i].c_str(), _stages[i].path));
+        }
+        if (std::find(shaders.begin(), shaders.end(), 0u) != shaders.end())
+        {
+            for (uint32_t shader : shaders)
             {
-                if (chunk.GetBlock(glm::vec3(x, y, z)) == Block::AIR)
-                {
-                    continue;
-                }
-
-                for (size_t k = 0; k < 6; k++)
-                {
-                    int32_t nx = x + dx[k];
-                    int32_t ny = y + dy[k];
-                    int32_t nz = z + dz[k];
-                    BlockFace face = faces[k];
-
-                    if (nx < 0 || nx >= Chunk::WIDTH ||
-                        ny < 0 || ny >= Chunk::HEIGHT ||
-                        nz < 0 || nz >= Chunk::WIDTH ||
-                        chunk.GetBlock(glm::ivec3(nx, ny, nz)) == Block::AIR)
-                    {
-                        AddFaceToData(
-                            glm::vec3(chunk.GetPosition().x + x, y, chunk.GetPosition().y + z),
-                            chunk.GetBlock(glm::vec3(x, y, z)), face,
-                            vertexBufferData, elementBufferData);
-                    }
-                }
+                glDeleteShader(shader);
             }
+            return 0;
+        }
+
+        program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        for (uint32_t shader : shaders)
+        {
+            glAttachShader(program, shader);
+        }
+
+        glLinkProgram(program);
+
+        for (uint32_t shader : shaders)
+        {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
         }
+
+        int32_t status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status)
+        {
+            int32_t length;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+            std::string log = std::string(length, '\0');
+            glGetProgramInfoLog(program, length, nullptr, log.data());
+            std::cerr << "[SHADER] Could not link " << GetName() << ":\n" << log << std::endl;
+
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        SaveBinary(program, cachePath);
     }
 
-    _elementCount = elementBufferData.size();
+    _loadTime = timer.GetElapsedMilliseconds();
+    std::cout << "[SHADER] Loaded " << GetName() << (_isFromBinaryCache ? " from cache" : "")
+        << " in " << _loadTime << " ms" << std::endl;
+
+    return program;
+}
+
+std::string ShaderProgram::GetName() const
+{
+    std::string name;
+    for (const Stage& stage : _stages)
+    {
+        name += (name.empty() ? "" : " and ") + stage.path;
+    }
+    return name;
+}
+
+RingBuffer::RingBuffer(size_t frameSize)
+    : _frameIndex(0), _fences{}
+{
+    const size_t alignment = GetOffsetAlignment();
+    _frameSize = (frameSize + alignment - 1) / alignment * alignment;
+
+    constexpr uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &_id);
+    glNamedBufferStorage(_id, _frameSize * FRAME_COUNT, nullptr, flags);
+    _data = (uint8_t*)glMapNamedBufferRange(_id, 0, _frameSize * FRAME_COUNT, flags);
+}
+
+RingBuffer::~RingBuffer()
+{
+    for (GLsync fence : _fences)
+    {
+        glDeleteSync(fence);
+    }
+
+    glUnmapNamedBuffer(_id);
+    RenderState::Forget(_id);
+    glDeleteBuffers(1, &_id);
+}
+
+void RingBuffer::BeginFrame()
+{
+    _frameIndex = (_frameIndex + 1) % FRAME_COUNT;
+
+    GLsync& fence = _fences[_frameIndex];
+    if (fence)
+    {
+        RenderState::WaitForFence(fence);
+        fence = nullptr;
+    }
+}
+
+void RingBuffer::EndFrame()
+{
+    _fences[_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void RingBuffer::BindRange(uint32_t target, uint32_t binding, size_t offset, size_t size) const
+{
+    RenderState::BindBufferRange(target, binding, _id, _frameIndex * _frameSize + offset, size);
+}
+
+size_t RingBuffer::GetOffsetAlignment()
+{
+    int32_t uniformAlignment;
+    int32_t storageAlignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    return glm::max(uniformAlignment, storageAlignment);
+}
+
+GpuTimer::GpuTimer()
+    : _isPending{}, _index(0), _milliseconds(0.0)
+{
+    glCreateQueries(GL_TIMESTAMP, _beginQueries.size(), _beginQueries.data());
+    glCreateQueries(GL_TIMESTAMP, _endQueries.size(), _endQueries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(_beginQueries.size(), _beginQueries.data());
+    glDeleteQueries(_endQueries.size(), _endQueries.data());
+}
+
+void GpuTimer::Begin()
+{
+    _index = (_index + 1) % _beginQueries.size();
+
+    if (_isPending[_index])
+    {
+        uint64_t begin;
+        uint64_t end;
+        glGetQueryObjectui64v(_beginQueries[_index], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(_endQueries[_index], GL_QUERY_RESULT, &end);
+        _milliseconds = (end - begin) / 1000000.0;
+        _isPending[_index] = false;
+    }
+
+    glQueryCounter(_beginQueries[_index], GL_TIMESTAMP);
+}
+
+void GpuTimer::End()
+{
+    glQueryCounter(_endQueries[_index], GL_TIMESTAMP);
+    _isPending[_index] = true;
+}
+
+ChunkMesh::ChunkMesh(const ChunkMeshData& data, TranslucentOrder translucentOrder, const glm::ivec2& position,
+    uint32_t lod, uint32_t revision, uint32_t drawIndexBuffer)
+    : _position(position), _lod(lod), _revision(revision),
+    _translucentFaces(std::make_shared<const TranslucentFaces>(data.translucentFaces)),
+    _translucentOrder(std::move(translucentOrder))
+{
+    _elementCount = data.elements.size();
 
     glCreateVertexArrays(1, &_vertexArray);
     glCreateBuffers(1, &_vertexBuffer);
     glCreateBuffers(1, &_elementBuffer);
 
-    glNamedBufferData(_vertexBuffer, vertexBufferData.size() * sizeof(float), vertexBufferData.data(), GL_STATIC_DRAW);
-    glNamedBufferData(_elementBuffer, elementBufferData.size() * sizeof(uint32_t), elementBufferData.data(), GL_STATIC_DRAW);
+    const size_t elementsSize = data.elements.size() * sizeof(uint32_t);
+    const size_t translucentElementsSize = _translucentOrder.elements.size() * sizeof(uint32_t);
+
+    glNamedBufferData(_vertexBuffer, data.vertices.size() * sizeof(ChunkVertex), data.vertices.data(), GL_STATIC_DRAW);
+    glNamedBufferData(_elementBuffer, elementsSize + translucentElementsSize, nullptr,
+        translucentElementsSize > 0 ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    glNamedBufferSubData(_elementBuffer, 0, elementsSize, data.elements.data());
+    glNamedBufferSubData(_elementBuffer, elementsSize, translucentElementsSize, _translucentOrder.elements.data());
 
-    glVertexArrayVertexBuffer(_vertexArray, 0, _vertexBuffer, 0, 5 * sizeof(float));
+    glVertexArrayVertexBuffer(_vertexArray, 0, _vertexBuffer, 0, sizeof(ChunkVertex));
     glVertexArrayElementBuffer(_vertexArray, _elementBuffer);
 
     glEnableVertexArrayAttrib(_vertexArray, 0);
     glVertexArrayAttribBinding(_vertexArray, 0, 0);
-    glVertexArrayAttribFormat(_vertexArray, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribFormat(_vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ChunkVertex, position));
 
     glEnableVertexArrayAttrib(_vertexArray, 1);
     glVertexArrayAttribBinding(_vertexArray, 1, 0);
-    glVertexArrayAttribFormat(_vertexArray, 1, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    glVertexArrayAttribIFormat(_vertexArray, 1, 1, GL_UNSIGNED_INT, offsetof(ChunkVertex, texCoords));
+
+    glEnableVertexArrayAttrib(_vertexArray, 3);
+    glVertexArrayAttribBinding(_vertexArray, 3, 0);
+    glVertexArrayAttribIFormat(_vertexArray, 3, 1, GL_UNSIGNED_INT, offsetof(ChunkVertex, light));
+
+    glVertexArrayVertexBuffer(_vertexArray, 1, drawIndexBuffer, 0, sizeof(uint32_t));
+    glVertexArrayBindingDivisor(_vertexArray, 1, 1);
+
+    glEnableVertexArrayAttrib(_vertexArray, 2);
+    glVertexArrayAttribBinding(_vertexArray, 2, 1);
+    glVertexArrayAttribIFormat(_vertexArray, 2, 1, GL_UNSIGNED_INT, 0);
 }
 
 ChunkMesh::~ChunkMesh()
 {
+    RenderState::Forget(_elementBuffer);
+    RenderState::Forget(_vertexBuffer);
+    RenderState::Forget(_vertexArray);
     glDeleteBuffers(1, &_elementBuffer);
     glDeleteBuffers(1, &_vertexBuffer);
     glDeleteVertexArrays(1, &_vertexArray);
@@ -200,118 +549,110 @@ ChunkMesh::~ChunkMesh()
 
 void ChunkMesh::Bind() const
 {
-    glBindVertexArray(_vertexArray);
-}
-
-void ChunkMesh::AddFaceToData(const std::array<glm::vec3, 4>& positionList,
-    const std::array<glm::vec2, 2>& uvCoordsList,
-    std::vector<float>& vertexBufferData, std::vector<uint32_t>& elementBufferData)
-{
-    const size_t offset = vertexBufferData.size() / 5;
-
-    vertexBufferData.push_back(positionList[0].x);
-    vertexBufferData.push_back(positionList[0].y);
-    vertexBufferData.push_back(positionList[0].z);
-    vertexBufferData.push_back(uvCoordsList[0].x);
-    vertexBufferData.push_back(uvCoordsList[0].y);
-
-    vertexBufferData.push_back(positionList[1].x);
-    vertexBufferData.push_back(positionList[1].y);
-    vertexBufferData.push_back(positionList[1].z);
-    vertexBufferData.push_back(uvCoordsList[1].x);
-    vertexBufferData.push_back(uvCoordsList[0].y);
-
-    vertexBufferData.push_back(positionList[2].x);
-    vertexBufferData.push_back(positionList[2].y);
-    vertexBufferData.push_back(positionList[2].z);
-    vertexBufferData.push_back(uvCoordsList[1].x);
-    vertexBufferData.push_back(uvCoordsList[1].y);
-
-    vertexBufferData.push_back(positionList[3].x);
-    vertexBufferData.push_back(positionList[3].y);
-    vertexBufferData.push_back(positionList[3].z);
-    vertexBufferData.push_back(uvCoordsList[0].x);
-    vertexBufferData.push_back(uvCoordsList[1].y);
-
-    elementBufferData.push_back(offset);
-    elementBufferData.push_back(offset + 2);
-    elementBufferData.push_back(offset + 1);
-
-    elementBufferData.push_back(offset);
-    elementBufferData.push_back(offset + 2);
-    elementBufferData.push_back(offset + 3);
-}
-
-void ChunkMesh::AddFaceToData(const glm::vec3& position,
-    const Block block, BlockFace face,
-    std::vector<float>& vertexBufferData, std::vector<uint32_t>& elementBufferData)
-{
-    std::array<glm::vec3, 4> positionList;
-    std::array<glm::vec2, 2> uvCoordsList;
-
-    glm::vec3 origin;
-    glm::vec3 dx;
-    glm::vec3 dy;
-
-    const BlockAtlas& atlas = BlockAtlas::GetAtlasOf(block);
-
-    switch (face)
-    {
-    case BlockFace::FRONT:
-        origin = position;
-        dx = glm::vec3(0.0f, 0.0f, 1.0f);
-        dy = glm::vec3(0.0f, 1.0f, 0.0f);
-        uvCoordsList[0] = atlas.side;
-        uvCoordsList[1] = atlas.side + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-
-    case BlockFace::BACK:
-        origin = position + glm::vec3(1.0f, 0.0f, 1.0f);
-        dx = glm::vec3(0.0f, 0.0f, -1.0f);
-        dy = glm::vec3(0.0f, 1.0f, 0.0f);
-        uvCoordsList[0] = atlas.side;
-        uvCoordsList[1] = atlas.side + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-
-    case BlockFace::LEFT:
-        origin = position + glm::vec3(1.0f, 0.0f, 0.0f);
-        dx = glm::vec3(-1.0f, 0.0f, 0.0f);
-        dy = glm::vec3(0.0f, 1.0f, 0.0f);
-        uvCoordsList[0] = atlas.side;
-        uvCoordsList[1] = atlas.side + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-
-    case BlockFace::RIGHT:
-        origin = position + glm::vec3(0.0f, 0.0f, 1.0f);
-        dx = glm::vec3(1.0f, 0.0f, 0.0f);
-        dy = glm::vec3(0.0f, 1.0f, 0.0f);
-        uvCoordsList[0] = atlas.side;
-        uvCoordsList[1] = atlas.side + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-
-    case BlockFace::BOTTOM:
-        origin = position + glm::vec3(1.0f, 0.0f, 0.0f);
-        dx = glm::vec3(0.0f, 0.0f, 1.0f);
-        dy = glm::vec3(-1.0f, 0.0f, 0.0f);
-        uvCoordsList[0] = atlas.bottom;
-        uvCoordsList[1] = atlas.bottom + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-
-    default: // BlockFace::TOP
-        origin = position + glm::vec3(0.0f, 1.0f, 0.0f);
-        dx = glm::vec3(0.0f, 0.0f, 1.0f);
-        dy = glm::vec3(1.0f, 0.0f, 0.0f);
-        uvCoordsList[0] = atlas.top;
-        uvCoordsList[1] = atlas.top + glm::vec2(BlockAtlas::STEP, BlockAtlas::STEP);
-        break;
-    }
-
-    positionList[0] = origin;
-    positionList[1] = origin + dx;
-    positionList[2] = origin + dx + dy;
-    positionList[3] = origin + dy;
-
-    AddFaceToData(positionList, uvCoordsList, vertexBufferData, elementBufferData);
+    RenderState::BindVertexArray(_vertexArray);
+}
+
+void ChunkMesh::SetTranslucentOrder(TranslucentOrder translucentOrder)
+{
+    _translucentOrder = std::move(translucentOrder);
+    glNamedBufferSubData(_elementBuffer, _elementCount * sizeof(uint32_t),
+        _translucentOrder.elements.size() * sizeof(uint32_t), _translucentOrder.elements.data());
+}
+
+InstancedMesh::InstancedMesh(const std::vector<InstancedVertex>& vertices, const std::vector<uint32_t>& elements)
+    : _elementCount(elements.size())
+{
+    glCreateVertexArrays(1, &_vertexArray);
+    glCreateBuffers(1, &_vertexBuffer);
+    glCreateBuffers(1, &_elementBuffer);
+
+    glNamedBufferStorage(_vertexBuffer, vertices.size() * sizeof(InstancedVertex), vertices.data(), 0);
+    glNamedBufferStorage(_elementBuffer, elements.size() * sizeof(uint32_t), elements.data(), 0);
+
+    glVertexArrayVertexBuffer(_vertexArray, 0, _vertexBuffer, 0, sizeof(InstancedVertex));
+    glVertexArrayElementBuffer(_vertexArray, _elementBuffer);
+
+    glEnableVertexArrayAttrib(_vertexArray, 0);
+    glVertexArrayAttribBinding(_vertexArray, 0, 0);
+    glVertexArrayAttribFormat(_vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(InstancedVertex, position));
+
+    glEnableVertexArrayAttrib(_vertexArray, 1);
+    glVertexArrayAttribBinding(_vertexArray, 1, 0);
+    glVertexArrayAttribFormat(_vertexArray, 1, 2, GL_FLOAT, GL_FALSE, offsetof(InstancedVertex, texCoords));
+
+    glEnableVertexArrayAttrib(_vertexArray, 2);
+    glVertexArrayAttribBinding(_vertexArray, 2, 0);
+    glVertexArrayAttribFormat(_vertexArray, 2, 1, GL_FLOAT, GL_FALSE, offsetof(InstancedVertex, shade));
+
+    // The instance buffer itself is bound on every draw, since it moves
+    // through a ring buffer.
+    glVertexArrayBindingDivisor(_vertexArray, 1, 1);
+
+    glEnableVertexArrayAttrib(_vertexArray, 3);
+    glVertexArrayAttribBinding(_vertexArray, 3, 1);
+    glVertexArrayAttribFormat(_vertexArray, 3, 4, GL_FLOAT, GL_FALSE, offsetof(EntityInstance, previousPosition));
+
+    glEnableVertexArrayAttrib(_vertexArray, 4);
+    glVertexArrayAttribBinding(_vertexArray, 4, 1);
+    glVertexArrayAttribFormat(_vertexArray, 4, 4, GL_FLOAT, GL_FALSE, offsetof(EntityInstance, position));
+
+    glEnableVertexArrayAttrib(_vertexArray, 5);
+    glVertexArrayAttribBinding(_vertexArray, 5, 1);
+    glVertexArrayAttribFormat(_vertexArray, 5, 3, GL_FLOAT, GL_FALSE, offsetof(EntityInstance, scale));
+
+    glEnableVertexArrayAttrib(_vertexArray, 6);
+    glVertexArrayAttribBinding(_vertexArray, 6, 1);
+    glVertexArrayAttribIFormat(_vertexArray, 6, 1, GL_UNSIGNED_INT, offsetof(EntityInstance, layer));
+
+    glEnableVertexArrayAttrib(_vertexArray, 7);
+    glVertexArrayAttribBinding(_vertexArray, 7, 1);
+    glVertexArrayAttribFormat(_vertexArray, 7, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(EntityInstance, tint));
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    RenderState::Forget(_elementBuffer);
+    RenderState::Forget(_vertexBuffer);
+    RenderState::Forget(_vertexArray);
+    glDeleteBuffers(1, &_elementBuffer);
+    glDeleteBuffers(1, &_vertexBuffer);
+    glDeleteVertexArrays(1, &_vertexArray);
+}
+
+void InstancedMesh::AddBox(std::vector<InstancedVertex>& vertices, std::vector<uint32_t>& elements,
+    const glm::vec3& min, const glm::vec3& max)
+{
+    // Faces in the same order as BlockFace, shaded like the sides of a
+    // block under the sky.
+    static constexpr float FACE_SHADES[] = { 0.8f, 0.8f, 0.9f, 0.9f, 0.6f, 1.0f };
+
+    const glm::vec3 center = (min + max) * 0.5f;
+    const glm::vec3 extent = (max - min) * 0.5f;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const glm::vec3 normal = glm::vec3(GetNormalOf((BlockFace)face));
+        const glm::vec3 tangent = normal.y != 0.0f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(normal.z, 0.0f, -normal.x);
+        const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+        const uint32_t first = vertices.size();
+        for (const glm::vec2& corner : { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) })
+        {
+            glm::vec3 direction = normal + tangent * (corner.x * 2.0f - 1.0f) + bitangent * (corner.y * 2.0f - 1.0f);
+            vertices.push_back({ center + direction * extent, corner, FACE_SHADES[face] });
+        }
+        for (uint32_t index : { 0u, 1u, 2u, 2u, 3u, 0u })
+        {
+            elements.push_back(first + index);
+        }
+    }
+}
+
+void InstancedMesh::Draw(uint32_t instanceBuffer, size_t offset, uint32_t instanceCount) const
+{
+    glVertexArrayVertexBuffer(_vertexArray, 1, instanceBuffer, offset, sizeof(EntityInstance));
+    RenderState::BindVertexArray(_vertexArray);
+    glDrawElementsInstanced(GL_TRIANGLES, _elementCount, GL_UNSIGNED_INT, nullptr, instanceCount);
+    RenderState::RecordDraw(_elementCount * instanceCount);
 }
 
 void Renderer::Init()
@@ -324,26 +665,507 @@ void Renderer::Deinit()
     delete _instance;
 }
 
+void Renderer::ReloadChangedShaders()
+{
+    for (const std::string& name : _shaderWatcher.Poll())
+    {
+        if (name.ends_with(".glsl"))
+        {
+            _program->Reload();
+            _entityProgram->Reload();
+            _particles->ReloadShaders();
+            break;
+        }
+    }
+}
+
+void Renderer::UpdateChunkMeshes(const glm::vec3& cameraPosition)
+{
+    const World* world = World::Get();
+
+    // Rather than waiting for a simulation tick to finish, the meshes are
+    // brought up to date on a later frame.
+    std::shared_lock<std::shared_mutex> worldLock = std::shared_lock<std::shared_mutex>(world->GetMutex(), std::try_to_lock);
+    if (!worldLock.owns_lock())
+    {
+        SortTranslucentFaces(cameraPosition);
+        return;
+    }
+
+    _particles->UpdateOccupancy(*world, cameraPosition);
+
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_builtChunkMeshesMutex);
+        for (BuiltChunkMesh& builtChunkMesh : _builtChunkMeshes)
+        {
+            _pendingChunkMeshes.erase(builtChunkMesh.key);
+            _meshedChunkCount++;
+            if (world->GetChunks().contains(builtChunkMesh.key))
+            {
+                _uploadedChunkCount++;
+                // Replacing the old mesh only now keeps the chunk visible
+                // while its new level of detail is being built.
+                _chunkMeshes[builtChunkMesh.key] = std::make_shared<ChunkMesh>(builtChunkMesh.data,
+                    std::move(builtChunkMesh.translucentOrder), builtChunkMesh.position,
+                    builtChunkMesh.lod, builtChunkMesh.revision, _drawIndexBuffer);
+            }
+        }
+        _builtChunkMeshes.clear();
+    }
+
+    std::erase_if(_chunkMeshes, [&](const auto& item) { return !world->GetChunks().contains(item.first); });
+
+    SortTranslucentFaces(cameraPosition);
+
+    const size_t maxPendingChunkMeshes = ThreadPool::Get()->GetThreadCount() * 2;
+    if (_pendingChunkMeshes.size() >= maxPendingChunkMeshes)
+    {
+        return;
+    }
+
+    struct Request
+    {
+        std::shared_ptr<const Chunk> chunk;
+        uint64_t key;
+        uint32_t lod;
+        float distance;
+    };
+
+    std::vector<Request> requests;
+    const glm::vec2 center = glm::vec2(cameraPosition.x, cameraPosition.z) / (float)Chunk::WIDTH;
+    for (const auto& [key, chunk] : world->GetChunks())
+    {
+        if (_pendingChunkMeshes.contains(key))
+        {
+            continue;
+        }
+
+        // Both the faces and the light along the borders depend on the
+        // neighbors, so a chunk waits for all of them.
+        const glm::ivec2 chunkCoords = chunk->GetPosition() / (int32_t)Chunk::WIDTH;
+        bool hasNeighbors = true;
+        for (int32_t x = -1; x <= 1 && hasNeighbors; x++)
+        {
+            for (int32_t z = -1; z <= 1 && hasNeighbors; z++)
+            {
+                hasNeighbors = world->GetChunks().contains(World::GetChunkKey(chunkCoords + glm::ivec2(x, z)));
+            }
+        }
+        if (!hasNeighbors)
+        {
+            continue;
+        }
+
+        glm::vec2 chunkCenter = glm::vec2(chunk->GetPosition()) / (float)Chunk::WIDTH + 0.5f;
+        float distance = glm::length(chunkCenter - center);
+
+        auto it = _chunkMeshes.find(key);
+        uint32_t currentLod = it != _chunkMeshes.end() ? it->second->GetLod() : ChunkMesher::LOD_COUNT;
+        uint32_t lod = SelectLod(distance, currentLod);
+        if (lod != currentLod || it->second->GetRevision() != chunk->GetRevision())
+        {
+            requests.push_back({ chunk, key, lod, distance });
+        }
+    }
+
+    std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b)
+    {
+        return a.distance < b.distance;
+    });
+
+    for (const Request& request : requests)
+    {
+        if (_pendingChunkMeshes.size() >= maxPendingChunkMeshes)
+        {
+            break;
+        }
+
+        _pendingChunkMeshes.insert(request.key);
+
+        // The world cannot change while it is held, so the copy taken here
+        // is consistent.
+        auto snapshot = std::make_shared<ChunkSnapshot>(*world, *request.chunk);
+        const glm::vec3 viewPosition = cameraPosition -
+            glm::vec3(snapshot->GetPosition().x, 0.0f, snapshot->GetPosition().y);
+        ThreadPool::Get()->Submit([this, snapshot, viewPosition, lod = request.lod, key = request.key]
+        {
+            BuiltChunkMesh builtChunkMesh = {
+                .key = key,
+                .position = snapshot->GetPosition(),
+                .lod = lod,
+                .revision = snapshot->GetRevision(),
+                .data = ChunkMesher::Build(*snapshot, lod)
+            };
+            ChunkMesher::SortTranslucentFaces(builtChunkMesh.data.translucentFaces,
+                viewPosition, builtChunkMesh.translucentOrder);
+
+            std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_builtChunkMeshesMutex);
+            _builtChunkMeshes.push_back(std::move(builtChunkMesh));
+        });
+    }
+}
+
+void Renderer::SortTranslucentFaces(const glm::vec3& cameraPosition)
+{
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_sortedFacesMutex);
+        for (SortedFaces& sortedFaces : _sortedFaces)
+        {
+            _pendingSorts.erase(sortedFaces.key);
+
+            // The mesh may have been rebuilt or unloaded in the meantime.
+            auto it = _chunkMeshes.find(sortedFaces.key);
+            if (it != _chunkMeshes.end() && it->second->GetTranslucentFaces() == sortedFaces.faces)
+            {
+                it->second->SetTranslucentOrder(std::move(sortedFaces.order));
+            }
+        }
+        _sortedFaces.clear();
+    }
+
+    for (const auto& [key, chunkMesh] : _chunkMeshes)
+    {
+        if (chunkMesh->GetTranslucentElementCount() == 0 || _pendingSorts.contains(key))
+        {
+            continue;
+        }
+
+        const glm::vec3 viewPosition = cameraPosition -
+            glm::vec3(chunkMesh->GetPosition().x, 0.0f, chunkMesh->GetPosition().y);
+        const glm::vec2 offset = glm::vec2(viewPosition.x, viewPosition.z) - (float)Chunk::WIDTH * 0.5f;
+        if (glm::length(offset) > SORT_DISTANCE * Chunk::WIDTH ||
+            glm::distance(viewPosition, chunkMesh->GetTranslucentOrder().viewPosition) < SORT_THRESHOLD)
+        {
+            continue;
+        }
+
+        _pendingSorts.insert(key);
+        ThreadPool::Get()->Submit([this, key, faces = chunkMesh->GetTranslucentFaces(),
+            order = chunkMesh->GetTranslucentOrder(), viewPosition]() mutable
+        {
+            ChunkMesher::SortTranslucentFaces(*faces, viewPosition, order);
+
+            std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_sortedFacesMutex);
+            _sortedFaces.push_back({ key, std::move(faces), std::move(order) });
+        });
+    }
+}
+
 void Renderer::ClearBuffers() const
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void Renderer::RenderChunkMesh() const
+void Renderer::BeginFrame(const Camera& camera, const glm::uvec2& windowSize)
+{
+    _frameCamera = camera;
+
+    _frameTimer->Begin();
+    UpdateResolutionScale();
+
+    _sceneSize = glm::max(windowSize, glm::uvec2(1));
+    _scaledSize = glm::max(glm::uvec2(glm::vec2(_sceneSize) * _resolutionScale), glm::uvec2(1));
+    _isSceneScaled = _scaledSize != _sceneSize;
+    if (_isSceneScaled)
+    {
+        UpdateSceneTargets();
+        glBindFramebuffer(GL_FRAMEBUFFER, _sceneFramebuffer);
+    }
+    else
+    {
+        // Kept while the scale may drop again any frame.
+        if (!_isDynamicResolution)
+        {
+            DeleteSceneTargets();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, Window::Get()->GetFramebuffer());
+    }
+    glViewport(0, 0, _scaledSize.x, _scaledSize.y);
+
+    _constants->BeginFrame();
+    _entityInstances->BeginFrame();
+
+    FrameConstants* frameConstants = (FrameConstants*)_constants->GetFrameData();
+    frameConstants->viewProjection = _frameCamera.GetViewProjection();
+    _constants->BindRange(GL_UNIFORM_BUFFER, 0, 0, sizeof(FrameConstants));
+}
+
+void Renderer::EndFrame()
+{
+    if (_isSceneScaled)
+    {
+        const uint32_t windowFramebuffer = Window::Get()->GetFramebuffer();
+        glBlitNamedFramebuffer(_sceneFramebuffer, windowFramebuffer, 0, 0, _scaledSize.x, _scaledSize.y,
+            0, 0, _sceneSize.x, _sceneSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, windowFramebuffer);
+        glViewport(0, 0, _sceneSize.x, _sceneSize.y);
+    }
+
+    _constants->EndFrame();
+    _entityInstances->EndFrame();
+    _frameTimer->End();
+
+    UpdateFrameStats();
+}
+
+void Renderer::UpdateSceneTargets()
+{
+    if (_sceneTargetSize == _sceneSize)
+    {
+        return;
+    }
+    DeleteSceneTargets();
+    _sceneTargetSize = _sceneSize;
+
+    glCreateRenderbuffers(1, &_sceneColorBuffer);
+    glNamedRenderbufferStorage(_sceneColorBuffer, GL_RGBA8, _sceneSize.x, _sceneSize.y);
+    glCreateRenderbuffers(1, &_sceneDepthBuffer);
+    glNamedRenderbufferStorage(_sceneDepthBuffer, GL_DEPTH24_STENCIL8, _sceneSize.x, _sceneSize.y);
+
+    glCreateFramebuffers(1, &_sceneFramebuffer);
+    glNamedFramebufferRenderbuffer(_sceneFramebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _sceneColorBuffer);
+    glNamedFramebufferRenderbuffer(_sceneFramebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _sceneDepthBuffer);
+}
+
+void Renderer::DeleteSceneTargets()
 {
+    if (_sceneTargetSize == glm::uvec2(0))
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &_sceneFramebuffer);
+    glDeleteRenderbuffers(1, &_sceneColorBuffer);
+    glDeleteRenderbuffers(1, &_sceneDepthBuffer);
+    _sceneFramebuffer = 0;
+    _sceneColorBuffer = 0;
+    _sceneDepthBuffer = 0;
+    _sceneTargetSize = glm::uvec2(0);
+}
+
+void Renderer::UpdateFrameStats()
+{
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_frameStatsMutex);
+    _frameStats = {
+        .renderState = RenderState::GetFrameStats(),
+        .isShaderFromBinaryCache = _program->IsFromBinaryCache(),
+        .shaderLoadTime = _program->GetLoadTime(),
+        .resolutionScale = _resolutionScale,
+        .scaledSize = _scaledSize,
+        .gpuFrameTime = _frameTimer->GetMilliseconds(),
+        .lodStats = _lodStats,
+        .pendingChunkMeshCount = _pendingChunkMeshes.size(),
+        .pendingSortCount = _pendingSorts.size(),
+        .droppedDrawCount = _droppedDrawCount,
+        .entityStats = _entityStats,
+        .aliveParticleCount = _particles->GetAliveCount(),
+        .emittedParticleCount = _particles->GetEmittedCount(),
+        .particleUpdateTime = _particles->GetUpdateTime(),
+        .particleRenderTime = _particles->GetRenderTime()
+    };
+}
+
+void Renderer::UpdateResolutionScale()
+{
+    const double gpuTime = _frameTimer->GetMilliseconds();
+    const double targetFrameTime = _targetFrameTime;
+    if (!_isDynamicResolution)
+    {
+        _resolutionScale = 1.0f;
+        return;
+    }
+    if (gpuTime <= 0.0)
+    {
+        return;
+    }
+
+    // The GPU time goes roughly with the pixel count, so with the square of
+    // the scale.
+    const double load = gpuTime / targetFrameTime;
+    if (load > 1.0 || load < RESOLUTION_BAND)
+    {
+        const float goal = _resolutionScale * (float)std::sqrt(RESOLUTION_GOAL / load);
+        _resolutionScale = glm::clamp(glm::mix(_resolutionScale, goal, RESOLUTION_SMOOTHING), MIN_RESOLUTION_SCALE, 1.0f);
+    }
+}
+
+void Renderer::RenderChunkMesh()
+{
+    DrawConstants* drawConstants = (DrawConstants*)(_constants->GetFrameData() + _drawConstantsOffset);
+    _constants->BindRange(GL_SHADER_STORAGE_BUFFER, 1, _drawConstantsOffset, MAX_DRAW_COUNT * sizeof(DrawConstants));
+
     _texture->Bind(0);
     _program->Bind();
-    _program->SetUniformMat4(0, _camera.GetViewProjection());
-    _program->SetUniformInt(1, 0);
-    _chunkMesh->Bind();
-    glDrawElements(GL_TRIANGLES, _chunkMesh->GetElementCount(), GL_UNSIGNED_INT, nullptr);
+
+    _lodStats.fill({});
+
+    struct ChunkDraw
+    {
+        const ChunkMesh* chunkMesh;
+        float distance;
+    };
+    std::vector<ChunkDraw> chunkDraws;
+    chunkDraws.reserve(_chunkMeshes.size());
+    const glm::vec2 cameraPosition = glm::vec2(_frameCamera.GetPosition().x, _frameCamera.GetPosition().z);
+    for (const auto& [key, chunkMesh] : _chunkMeshes)
+    {
+        const glm::vec2 center = glm::vec2(chunkMesh->GetPosition()) + (float)Chunk::WIDTH * 0.5f;
+        chunkDraws.push_back({ chunkMesh.get(), glm::distance(center, cameraPosition) });
+    }
+
+    // Should there be more meshes than draws, the nearest ones are kept.
+    _droppedDrawCount = 0;
+    if (chunkDraws.size() > MAX_DRAW_COUNT)
+    {
+        std::nth_element(chunkDraws.begin(), chunkDraws.begin() + MAX_DRAW_COUNT, chunkDraws.end(),
+            [](const ChunkDraw& a, const ChunkDraw& b) { return a.distance < b.distance; });
+        _droppedDrawCount = chunkDraws.size() - MAX_DRAW_COUNT;
+        chunkDraws.resize(MAX_DRAW_COUNT);
+    }
+
+    struct TranslucentDraw
+    {
+        const ChunkMesh* chunkMesh;
+        uint32_t drawIndex;
+        float distance;
+    };
+    std::vector<TranslucentDraw> translucentDraws;
+
+    // Opaque and cutout blocks write depth without blending.
+    glDisable(GL_BLEND);
+
+    uint32_t drawCount = 0;
+    for (const ChunkDraw& draw : chunkDraws)
+    {
+        const ChunkMesh* chunkMesh = draw.chunkMesh;
+        _lodStats[chunkMesh->GetLod()].meshCount++;
+        _lodStats[chunkMesh->GetLod()].triangleCount +=
+            (chunkMesh->GetElementCount() + chunkMesh->GetTranslucentElementCount()) / 3;
+
+        drawConstants[drawCount].origin = glm::vec4(chunkMesh->GetPosition().x, 0.0f, chunkMesh->GetPosition().y, 0.0f);
+
+        if (chunkMesh->GetTranslucentElementCount() > 0)
+        {
+            translucentDraws.push_back({ chunkMesh, drawCount, draw.distance });
+        }
+
+        chunkMesh->Bind();
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, chunkMesh->GetElementCount(), GL_UNSIGNED_INT, nullptr, 1, drawCount);
+        RenderState::RecordDraw(chunkMesh->GetElementCount());
+        drawCount++;
+    }
+
+    // Translucent faces are blended back to front, chunk by chunk, without
+    // hiding each other in the depth buffer.
+    std::sort(translucentDraws.begin(), translucentDraws.end(), [](const TranslucentDraw& a, const TranslucentDraw& b)
+    {
+        return a.distance > b.distance;
+    });
+
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+
+    for (const TranslucentDraw& draw : translucentDraws)
+    {
+        const uintptr_t offset = draw.chunkMesh->GetElementCount() * sizeof(uint32_t);
+
+        draw.chunkMesh->Bind();
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, draw.chunkMesh->GetTranslucentElementCount(),
+            GL_UNSIGNED_INT, (const void*)offset, 1, draw.drawIndex);
+        RenderState::RecordDraw(draw.chunkMesh->GetTranslucentElementCount());
+    }
+
+    glDepthMask(GL_TRUE);
+}
+
+void Renderer::RenderEntities(const EntityInstances& instances, float interpolation)
+{
+    _texture->Bind(0);
+    _entityProgram->Bind();
+    _entityProgram->SetUniformFloat(0, interpolation);
+    glDisable(GL_BLEND);
+
+    // Every model gets its own range of this frame's instance buffer.
+    uint8_t* data = _entityInstances->GetFrameData();
+    size_t offset = 0;
+    size_t remainingCount = MAX_ENTITY_COUNT;
+    for (size_t model = 0; model < ENTITY_MODEL_COUNT; model++)
+    {
+        const uint32_t instanceCount = glm::min(instances[model].size(), remainingCount);
+        _entityStats[model] = { instanceCount, instanceCount > 0 ? 1u : 0u };
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        std::memcpy(data + offset, instances[model].data(), instanceCount * sizeof(EntityInstance));
+        _entityMeshes[model]->Draw(_entityInstances->GetId(), _entityInstances->GetFrameOffset() + offset, instanceCount);
+
+        offset += instanceCount * sizeof(EntityInstance);
+        remainingCount -= instanceCount;
+    }
+}
+
+void Renderer::RenderParticles(float delta)
+{
+    _particles->Update(delta);
+
+    _texture->Bind(0);
+    _particles->Render(_frameCamera);
 }
 
 void Renderer::RenderImGui()
 {
+    FrameStats stats;
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_frameStatsMutex);
+        stats = _frameStats;
+    }
+
     ImGui::Text("OpenGL Details:");
     ImGui::Text("Version: %s", _versionName);
     ImGui::Text("Renderer: %s", _rendererName);
+    ImGui::Text("Anisotropy: %.0fx", _texture->GetAnisotropy());
+    ImGui::Text("Texture: %s, loaded in %.2f ms", _texture->IsCompressed() ? "BC7" : "RGBA8", _texture->GetLoadTime());
+    ImGui::Text("Shader: %s, loaded in %.2f ms", stats.isShaderFromBinaryCache ? "cached" : "compiled", stats.shaderLoadTime);
+
+    ImGui::Text("Draws: %u, Triangles: %llu", stats.renderState.draws, (unsigned long long)stats.renderState.elements / 3);
+    ImGui::Text("Binds: %u issued, %u skipped", stats.renderState.binds, stats.renderState.skippedBinds);
+
+    bool isDynamicResolution = _isDynamicResolution;
+    if (ImGui::Checkbox("Dynamic Resolution", &isDynamicResolution))
+    {
+        _isDynamicResolution = isDynamicResolution;
+    }
+    float targetFrameTime = _targetFrameTime;
+    if (ImGui::SliderFloat("Target GPU Time (ms)", &targetFrameTime, 1.0f, 50.0f))
+    {
+        _targetFrameTime = targetFrameTime;
+    }
+    ImGui::Text("Resolution: %.0f%% (%ux%u), GPU: %.2f ms", stats.resolutionScale * 100.0f,
+        stats.scaledSize.x, stats.scaledSize.y, stats.gpuFrameTime);
+
+    int32_t lodDistance = _lodDistance;
+    if (ImGui::SliderInt("LOD Distance", &lodDistance, 1, 16))
+    {
+        _lodDistance = lodDistance;
+    }
+    for (uint32_t lod = 0; lod < ChunkMesher::LOD_COUNT; lod++)
+    {
+        ImGui::Text("LOD %u (%ux): %u meshes, %llu triangles", lod, 1u << lod,
+            stats.lodStats[lod].meshCount, (unsigned long long)stats.lodStats[lod].triangleCount);
+    }
+    ImGui::Text("Chunk meshes pending: %zu", stats.pendingChunkMeshCount);
+    ImGui::Text("Translucent sorts pending: %zu", stats.pendingSortCount);
+    ImGui::Text("Chunk meshes over the draw limit: %u", stats.droppedDrawCount);
+    static const char* modelNames[] = { "Block", "Mob" };
+    for (size_t model = 0; model < ENTITY_MODEL_COUNT; model++)
+    {
+        ImGui::Text("%s entities: %u instances in %u draws", modelNames[model],
+            stats.entityStats[model].instanceCount, stats.entityStats[model].drawCount);
+    }
+    ImGui::Text("Particles: %u alive, %u emitted this frame", stats.aliveParticleCount, stats.emittedParticleCount);
+    ImGui::Text("Particle GPU time: %.3f ms update, %.3f ms render", stats.particleUpdateTime, stats.particleRenderTime);
 
     ImGui::Separator();
 
@@ -352,11 +1174,67 @@ void Renderer::RenderImGui()
     ImGui::Separator();
 }
 
-Renderer::Renderer()
-    : _camera(glm::vec3(0.0f), glm::radians(80.0f))
+double Renderer::GetGpuFrameTime() const
+{
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_frameStatsMutex);
+    return _frameStats.gpuFrameTime;
+}
+
+uint64_t Renderer::GetChunkTriangleCount() const
+{
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_frameStatsMutex);
+    uint64_t triangleCount = 0;
+    for (const LodStats& lodStats : _frameStats.lodStats)
+    {
+        triangleCount += lodStats.triangleCount;
+    }
+    return triangleCount;
+}
+
+void Renderer::CreateEntityMeshes()
 {
-    gladLoadGL(glfwGetProcAddress);
+    std::vector<InstancedVertex> vertices;
+    std::vector<uint32_t> elements;
+
+    InstancedMesh::AddBox(vertices, elements, glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.5f, 1.0f, 0.5f));
+    _entityMeshes[(size_t)EntityModel::BLOCK] = std::make_shared<InstancedMesh>(vertices, elements);
+
+    // A body with a head sticking out towards +x, so it is clear where a mob
+    // is facing.
+    vertices.clear();
+    elements.clear();
+    InstancedMesh::AddBox(vertices, elements, glm::vec3(-0.5f, 0.0f, -0.4f), glm::vec3(0.4f, 0.75f, 0.4f));
+    InstancedMesh::AddBox(vertices, elements, glm::vec3(0.3f, 0.45f, -0.3f), glm::vec3(0.8f, 1.0f, 0.3f));
+    _entityMeshes[(size_t)EntityModel::MOB] = std::make_shared<InstancedMesh>(vertices, elements);
+
+    _entityInstances = std::make_shared<RingBuffer>(MAX_ENTITY_COUNT * sizeof(EntityInstance));
+}
+
+uint32_t Renderer::SelectLod(float distance, uint32_t currentLod) const
+{
+    const int32_t lodDistance = _lodDistance;
+    auto getLod = [lodDistance](float distance)
+    {
+        return ChunkMesher::GetLod(distance, lodDistance);
+    };
+
+    // Within half a chunk of a boundary the current level is kept, so that
+    // moving along it does not rebuild the chunk over and over.
+    if (currentLod >= getLod(distance - 0.5f) && currentLod <= getLod(distance + 0.5f))
+    {
+        return currentLod;
+    }
+
+    return getLod(distance);
+}
 
+Renderer::Renderer()
+    : _camera(glm::vec3(0.0f), glm::radians(80.0f)), _frameCamera(_camera), _shaderWatcher("assets"), _lodDistance(ChunkMesher::DEFAULT_LOD_DISTANCE),
+    _lodStats{}, _droppedDrawCount(0), _meshedChunkCount(0), _uploadedChunkCount(0), _entityStats{},
+    _sceneFramebuffer(0), _sceneColorBuffer(0), _sceneDepthBuffer(0), _sceneTargetSize(0), _sceneSize(0), _scaledSize(0),
+    _isSceneScaled(false),
+    _isDynamicResolution(false), _targetFrameTime(1000.0f / 60.0f), _resolutionScale(1.0f), _frameStats{}
+{
     _versionName = glGetString(GL_VERSION);
     _rendererName = glGetString(GL_RENDERER);
 
@@ -365,19 +1243,40 @@ Renderer::Renderer()
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
     BlockAtlas::LoadAtlases();
 
     _program = std::make_shared<ShaderProgram>("assets/default.vert.glsl", "assets/default.frag.glsl");
-    _texture = std::make_shared<Texture2D>("assets/texture.png");
-    _chunkMesh = std::make_shared<ChunkMesh>(Chunk(glm::ivec2(0, 0)));
+    _entityProgram = std::make_shared<ShaderProgram>("assets/entity.vert.glsl", "assets/entity.frag.glsl");
+    _texture = std::make_shared<Texture2DArray>("assets/texture.png", "assets/cache/texture.bin", BlockAtlas::TILES_PER_ROW);
+
+    std::vector<uint32_t> drawIndices = std::vector<uint32_t>(MAX_DRAW_COUNT);
+    for (uint32_t i = 0; i < MAX_DRAW_COUNT; i++)
+    {
+        drawIndices[i] = i;
+    }
+    glCreateBuffers(1, &_drawIndexBuffer);
+    glNamedBufferStorage(_drawIndexBuffer, drawIndices.size() * sizeof(uint32_t), drawIndices.data(), 0);
+
+    const size_t alignment = RingBuffer::GetOffsetAlignment();
+    _drawConstantsOffset = (sizeof(FrameConstants) + alignment - 1) / alignment * alignment;
+    _constants = std::make_shared<RingBuffer>(_drawConstantsOffset + MAX_DRAW_COUNT * sizeof(DrawConstants));
+
+    CreateEntityMeshes();
+
+    _particles = std::make_shared<ParticleSystem>();
+    _frameTimer = std::make_shared<GpuTimer>();
 }
 
 Renderer::~Renderer()
 {
+    _frameTimer.reset();
+    _particles.reset();
+    DeleteSceneTargets();
+    _chunkMeshes.clear();
+    glDeleteBuffers(1, &_drawIndexBuffer);
 }
 
 void Renderer::ApiDebugCallback(uint32_t source, uint32_t type, uint32_t id, uint32_t severity, int32_t length, const char* message, const void* userParam)
@@ -4,97 +4,353 @@
 #include <string_view>
 #include <array>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <cstdint>
 
 #include "block.h"
+#include "world.h"
 #include "camera.h"
+#include "chunk_mesher.h"
+#include "entities.h"
+#include "file_watcher.h"
+#include "render_state.h"
 
 namespace Krafter
 {
 
-class Texture2D
+class ParticleSystem;
+
+class Texture2DArray
 {
 public:
-    Texture2D(std::string_view path);
-    ~Texture2D();
+    Texture2DArray(std::string_view atlasPath, std::string_view cachePath, uint32_t tilesPerRow);
+    ~Texture2DArray();
 
     void Bind(uint32_t unit) const;
 
-    inline const glm::ivec2& GetSize() const { return _size; }
+    inline const glm::ivec2& GetTileSize() const { return _tileSize; }
+    inline uint32_t GetLayerCount() const { return _layerCount; }
+    inline uint32_t GetMipLevelCount() const { return _mipLevelCount; }
+    inline float GetAnisotropy() const { return _anisotropy; }
+    inline bool IsCompressed() const { return _isCompressed; }
+    inline double GetLoadTime() const { return _loadTime; }
 
 private:
+    static float GetMaxAnisotropy();
+
     uint32_t _id;
-    glm::ivec2 _size;
+    glm::ivec2 _tileSize;
+    uint32_t _layerCount;
+    uint32_t _mipLevelCount;
+    float _anisotropy;
+    bool _isCompressed;
+    double _loadTime;
 };
 
 class ShaderProgram
 {
 public:
     ShaderProgram(std::string_view vertexShaderPath, std::string_view fragmentShaderPath);
+    // A compute program, run with glDispatchCompute() while bound.
+    ShaderProgram(std::string_view computeShaderPath);
     ~ShaderProgram();
 
+    // Rebuilds the program from its sources, keeping the current one if
+    // they fail to compile or link.
+    bool Reload();
+
     void Bind() const;
 
     void SetUniformInt(int32_t location, int32_t value) const;
+    void SetUniformUint(int32_t location, uint32_t value) const;
+    void SetUniformFloat(int32_t location, float value) const;
     void SetUniformVec4(int32_t location, const glm::vec4& value) const;
     void SetUniformMat4(int32_t location, const glm::mat4& value) const;
 
+    inline bool IsFromBinaryCache() const { return _isFromBinaryCache; }
+    inline double GetLoadTime() const { return _loadTime; }
+
 private:
+    struct Stage
+    {
+        uint32_t type;
+        std::string path;
+    };
+
     static std::string ReadFileAsString(std::string_view path);
-    static uint32_t CreateShader(uint32_t type, const char* source);
+    static uint32_t CreateShader(uint32_t type, const char* source, std::string_view path);
 
+    static std::string GetBinaryCachePath(const std::vector<std::string>& sources);
+    static uint32_t LoadBinary(std::string_view cachePath);
+    static void SaveBinary(uint32_t program, std::string_view cachePath);
+
+    uint32_t Build();
+    std::string GetName() const;
+
+    std::vector<Stage> _stages;
+
+    uint32_t _id;
+    bool _isFromBinaryCache;
+    double _loadTime;
+};
+
+// A persistently mapped buffer split into one region per frame in flight.
+// Each region is fenced after the frame that wrote it, so the CPU only
+// waits if it gets more than FRAME_COUNT frames ahead of the GPU.
+class RingBuffer
+{
+public:
+    static constexpr uint32_t FRAME_COUNT = 3;
+
+    RingBuffer(size_t frameSize);
+    ~RingBuffer();
+
+    void BeginFrame();
+    void EndFrame();
+
+    inline uint8_t* GetFrameData() const { return _data + GetFrameOffset(); }
+    inline size_t GetFrameOffset() const { return _frameIndex * _frameSize; }
+    inline uint32_t GetId() const { return _id; }
+    void BindRange(uint32_t target, uint32_t binding, size_t offset, size_t size) const;
+
+    static size_t GetOffsetAlignment();
+
+private:
     uint32_t _id;
+    uint8_t* _data;
+    size_t _frameSize;
+
+    uint32_t _frameIndex;
+    std::array<GLsync, FRAME_COUNT> _fences;
+};
+
+// Measures the GPU time of the commands between Begin() and End() with a
+// pair of timestamp queries, so timers can overlap and nest. Results are only
+// read when the queries are reused FRAME_COUNT frames later, so measuring
+// does not stall.
+class GpuTimer
+{
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+
+    inline double GetMilliseconds() const { return _milliseconds; }
+
+private:
+    std::array<uint32_t, RingBuffer::FRAME_COUNT> _beginQueries;
+    std::array<uint32_t, RingBuffer::FRAME_COUNT> _endQueries;
+    std::array<bool, RingBuffer::FRAME_COUNT> _isPending;
+    uint32_t _index;
+    double _milliseconds;
 };
 
-enum class BlockFace
+// Per-frame shader constants, bound as a std140 uniform block.
+struct FrameConstants
 {
-    FRONT,
-    BACK,
-    LEFT,
-    RIGHT,
-    BOTTOM,
-    TOP
+    glm::mat4 viewProjection;
 };
 
+// Per-draw shader constants, stored in a std430 storage buffer and indexed
+// by the draw index attribute.
+struct DrawConstants
+{
+    glm::vec4 origin;
+};
+
+struct InstancedVertex
+{
+    glm::vec3 position;
+    glm::vec2 texCoords;
+    float shade;
+};
+
+// A model drawn many times with one call, taking its per-instance
+// transform, texture layer and tint from an EntityInstance buffer.
+class InstancedMesh
+{
+public:
+    InstancedMesh(const std::vector<InstancedVertex>& vertices, const std::vector<uint32_t>& elements);
+    ~InstancedMesh();
+
+    // Adds a box with every face textured over its whole tile.
+    static void AddBox(std::vector<InstancedVertex>& vertices, std::vector<uint32_t>& elements,
+        const glm::vec3& min, const glm::vec3& max);
+
+    // Draws the given number of instances starting at an offset in bytes
+    // into the instance buffer.
+    void Draw(uint32_t instanceBuffer, size_t offset, uint32_t instanceCount) const;
+
+    inline uint32_t GetElementCount() const { return _elementCount; }
+
+private:
+    uint32_t _vertexArray;
+    uint32_t _vertexBuffer;
+    uint32_t _elementBuffer;
+    uint32_t _elementCount;
+};
+
+// Holds the opaque elements of a chunk followed by its translucent ones,
+// which are rewritten whenever they are sorted again.
 class ChunkMesh
 {
 public:
-    ChunkMesh(const Chunk& chunk);
+    ChunkMesh(const ChunkMeshData& data, TranslucentOrder translucentOrder, const glm::ivec2& position,
+        uint32_t lod, uint32_t revision, uint32_t drawIndexBuffer);
     ~ChunkMesh();
 
+    inline const glm::ivec2& GetPosition() const { return _position; }
+    inline uint32_t GetLod() const { return _lod; }
+    inline uint32_t GetRevision() const { return _revision; }
     inline uint32_t GetElementCount() const { return _elementCount; }
+    inline uint32_t GetTranslucentElementCount() const { return _translucentFaces->elements.size(); }
     void Bind() const;
 
-private:
-    static void AddFaceToData(const std::array<glm::vec3, 4>& positionList,
-        const std::array<glm::vec2, 2>& uvCoordsList,
-        std::vector<float>& vertexBufferData, std::vector<uint32_t>& elementBufferData);
-    static void AddFaceToData(const glm::vec3& position,
-        Block block, BlockFace face,
-        std::vector<float>& vertexBufferData, std::vector<uint32_t>& elementBufferData);
+    inline const std::shared_ptr<const TranslucentFaces>& GetTranslucentFaces() const { return _translucentFaces; }
+    inline const TranslucentOrder& GetTranslucentOrder() const { return _translucentOrder; }
+    void SetTranslucentOrder(TranslucentOrder translucentOrder);
 
+private:
+    glm::ivec2 _position;
+    uint32_t _lod;
+    uint32_t _revision;
     uint32_t _elementCount;
 
+    std::shared_ptr<const TranslucentFaces> _translucentFaces;
+    TranslucentOrder _translucentOrder;
+
     uint32_t _vertexArray;
     uint32_t _vertexBuffer;
     uint32_t _elementBuffer;
 };
 
+// Everything but the camera, the settings and the statistics belongs to the
+// render thread, along with the particles.
 class Renderer
 {
 public:
+    // On the render thread.
     static void Init();
     static void Deinit();
     inline static Renderer* Get() { return _instance; }
 
+    // The game thread's camera; every frame renders from a copy of it.
     inline Camera& GetCamera() { return _camera; }
+    inline ParticleSystem& GetParticles() { return *_particles; }
+
+    void ReloadChangedShaders();
+
+    // Uploads the chunk meshes finished in the background and queues new
+    // ones for chunks that are missing one, changed since, or need a
+    // different level of detail around the camera.
+    void UpdateChunkMeshes(const glm::vec3& cameraPosition);
+
+    // Everything rendered in a frame goes between these two, which hand out
+    // and fence the frame's part of the ring buffers. The scene is rendered
+    // from the camera at the resolution scale in between; EndFrame()
+    // stretches a scaled down one over the window, which is left bound for
+    // the interface.
+    // The camera and window size are the ones the frame was recorded with.
+    void BeginFrame(const Camera& camera, const glm::uvec2& windowSize);
+    void EndFrame();
 
     void ClearBuffers() const;
-    void RenderChunkMesh() const;
+
+    void RenderChunkMesh();
+    // Draws every entity with one instanced call per model, placed between
+    // its previous and current transform by the interpolation factor.
+    void RenderEntities(const EntityInstances& instances, float interpolation);
+    // Simulates the particles and draws them; goes after the opaque passes.
+    void RenderParticles(float delta);
+    // On the game thread, from the statistics of the last frame rendered.
     void RenderImGui();
 
+    // Of everything between BeginFrame() and EndFrame(), a few frames late.
+    double GetGpuFrameTime() const;
+    // Of the chunk meshes drawn in the last frame, at every level of detail.
+    uint64_t GetChunkTriangleCount() const;
+    // Off by default, so frames render at the window's size unless asked.
+    inline void SetDynamicResolution(bool isDynamicResolution) { _isDynamicResolution = isDynamicResolution; }
+    // Since the start; meshed counts every mesh built in the background,
+    // uploaded only the ones whose chunk was still loaded when it came back.
+    inline uint64_t GetMeshedChunkCount() const { return _meshedChunkCount; }
+    inline uint64_t GetUploadedChunkCount() const { return _uploadedChunkCount; }
+
 private:
+    // Every chunk that can be loaded at the largest view distance. Should
+    // there be more, the farthest ones are left out.
+    static constexpr uint32_t MAX_DRAW_COUNT = (2 * (World::MAX_VIEW_DISTANCE + 1) + 1) * (2 * (World::MAX_VIEW_DISTANCE + 1) + 1);
+    static constexpr uint32_t MAX_ENTITY_COUNT = 65536;
+
+    // Translucent faces are sorted again once the camera moved this far
+    // from where they were last sorted, and only in the chunks this close.
+    static constexpr float SORT_THRESHOLD = 1.0f;
+    static constexpr float SORT_DISTANCE = 8.0f;
+
+    // The resolution scale only changes once the GPU time leaves the band
+    // between these fractions of the target, and then heads for the goal
+    // between them, so it settles instead of hunting.
+    static constexpr float MIN_RESOLUTION_SCALE = 0.5f;
+    static constexpr double RESOLUTION_BAND = 0.85;
+    static constexpr double RESOLUTION_GOAL = 0.925;
+    static constexpr float RESOLUTION_SMOOTHING = 0.1f;
+
+    struct BuiltChunkMesh
+    {
+        uint64_t key;
+        glm::ivec2 position;
+        uint32_t lod;
+        uint32_t revision;
+        ChunkMeshData data;
+        TranslucentOrder translucentOrder;
+    };
+
+    struct SortedFaces
+    {
+        uint64_t key;
+        std::shared_ptr<const TranslucentFaces> faces;
+        TranslucentOrder order;
+    };
+
+    struct LodStats
+    {
+        uint32_t meshCount;
+        uint64_t triangleCount;
+    };
+
+    struct EntityStats
+    {
+        uint32_t instanceCount;
+        uint32_t drawCount;
+    };
+
+    // What the interface shows of the render thread's state, copied out at
+    // the end of every frame.
+    struct FrameStats
+    {
+        RenderState::Stats renderState;
+        bool isShaderFromBinaryCache;
+        double shaderLoadTime;
+        float resolutionScale;
+        glm::uvec2 scaledSize;
+        double gpuFrameTime;
+        std::array<LodStats, ChunkMesher::LOD_COUNT> lodStats;
+        size_t pendingChunkMeshCount;
+        size_t pendingSortCount;
+        uint32_t droppedDrawCount;
+        std::array<EntityStats, ENTITY_MODEL_COUNT> entityStats;
+        uint32_t aliveParticleCount;
+        uint32_t emittedParticleCount;
+        double particleUpdateTime;
+        double particleRenderTime;
+    };
+
     static void ApiDebugCallback(uint32_t source, uint32_t type, uint32_t id, uint32_t severity, int32_t length, const char* message, const void* userParam);
 
     inline static Renderer* _instance;
@@ -102,14 +358,78 @@ private:
     Renderer();
     ~Renderer();
 
+    void CreateEntityMeshes();
+    uint32_t SelectLod(float distance, uint32_t currentLod) const;
+    void SortTranslucentFaces(const glm::vec3& cameraPosition);
+    // Allocates the scene targets at the scene size, unless they already are.
+    void UpdateSceneTargets();
+    void DeleteSceneTargets();
+    void UpdateResolutionScale();
+    void UpdateFrameStats();
+
     const uint8_t* _versionName;
     const uint8_t* _rendererName;
 
     Camera _camera;
+    Camera _frameCamera;
+    FileWatcher _shaderWatcher;
 
     std::shared_ptr<ShaderProgram> _program;
-    std::shared_ptr<Texture2D> _texture;
-    std::shared_ptr<ChunkMesh> _chunkMesh;
+    std::shared_ptr<ShaderProgram> _entityProgram;
+    std::shared_ptr<Texture2DArray> _texture;
+
+    // Set on the game thread, read on the render thread.
+    std::atomic<int32_t> _lodDistance;
+    std::unordered_map<uint64_t, std::shared_ptr<ChunkMesh>> _chunkMeshes;
+    std::unordered_set<uint64_t> _pendingChunkMeshes;
+    std::array<LodStats, ChunkMesher::LOD_COUNT> _lodStats;
+    uint32_t _droppedDrawCount;
+    std::atomic<uint64_t> _meshedChunkCount;
+    std::atomic<uint64_t> _uploadedChunkCount;
+
+    std::mutex _builtChunkMeshesMutex;
+    std::vector<BuiltChunkMesh> _builtChunkMeshes;
+
+    std::unordered_set<uint64_t> _pendingSorts;
+    std::mutex _sortedFacesMutex;
+    std::vector<SortedFaces> _sortedFaces;
+
+    // Holds 0, 1, 2, ... as a per-instance attribute, so the base instance
+    // of a draw becomes its index into the per-draw constants.
+    uint32_t _drawIndexBuffer;
+    size_t _drawConstantsOffset;
+    std::shared_ptr<RingBuffer> _constants;
+
+    // One mesh per EntityModel, with the instances of all of them streamed
+    // into a ring buffer every frame.
+    std::array<std::shared_ptr<InstancedMesh>, ENTITY_MODEL_COUNT> _entityMeshes;
+    std::array<EntityStats, ENTITY_MODEL_COUNT> _entityStats;
+    std::shared_ptr<RingBuffer> _entityInstances;
+
+    std::shared_ptr<ParticleSystem> _particles;
+
+    std::shared_ptr<GpuTimer> _frameTimer;
+
+    // As big as the window; a scaled down scene is rendered into their lower
+    // left corner, as much of it as the resolution scale takes. At full
+    // scale the scene goes straight into the window's framebuffer instead,
+    // and without dynamic resolution the targets are not kept at all.
+    uint32_t _sceneFramebuffer;
+    uint32_t _sceneColorBuffer;
+    uint32_t _sceneDepthBuffer;
+    glm::uvec2 _sceneTargetSize;
+    glm::uvec2 _sceneSize;
+    glm::uvec2 _scaledSize;
+    bool _isSceneScaled;
+
+    // Set on the game thread like the LOD distance; the target is in
+    // milliseconds of GPU time per frame.
+    std::atomic<bool> _isDynamicResolution;
+    std::atomic<float> _targetFrameTime;
+    float _resolutionScale;
+
+    mutable std::mutex _frameStatsMutex;
+    FrameStats _frameStats;
 };
 
 } // namespace Krafter
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "replay.h"
+
+namespace Krafter
+{
+
+template<typename T>
+static void WriteValue(std::ofstream& file, T value)
+{
+    file.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static bool ReadValue(std::ifstream& file, T& value)
+{
+    return (bool)file.read((char*)&value, sizeof(T));
+}
+
+Replay::Replay(const std::string& path, Mode mode, float fixedDelta)
+    : _path(path), _mode(mode), _fixedDelta(fixedDelta), _isValid(false),
+    _lastInput(Window::Get()->GetInput()), _nextFrame(0)
+{
+    if (_mode == Mode::RECORD)
+    {
+        // Playback starts with nothing held, so anything held now is written
+        // with the first frame.
+        _lastInput.buttons = 0;
+        _output.open(path, std::ios::binary);
+        _output.write("KRRP", 4);
+        WriteValue(_output, VERSION);
+        _isValid = (bool)_output;
+    }
+    else
+    {
+        // The camera only looks at how far the cursor moved, so playback can
+        // start it anywhere.
+        _lastInput = { .buttons = 0, .cursorPosition = glm::vec2(0.0f) };
+        _isValid = Load();
+        Window::Get()->SetInputOverride(_lastInput);
+    }
+
+    if (!_isValid)
+    {
+        std::cerr << "[FILE] Could not " << (_mode == Mode::RECORD ? "write " : "read ") << path << std::endl;
+    }
+}
+
+Replay::~Replay()
+{
+    if (_mode == Mode::PLAYBACK)
+    {
+        Window::Get()->SetInputOverride(std::nullopt);
+    }
+}
+
+bool Replay::Update(float& delta)
+{
+    if (!_isValid)
+    {
+        return false;
+    }
+
+    if (_mode == Mode::RECORD)
+    {
+        Record(delta);
+        return true;
+    }
+
+    if (_nextFrame == _frames.size())
+    {
+        return false;
+    }
+    const Frame& frame = _frames[_nextFrame++];
+    Window::Get()->SetInputOverride(frame.input);
+    delta = _fixedDelta > 0.0f ? _fixedDelta : frame.delta;
+    return true;
+}
+
+void Replay::AddFrameTime(double milliseconds)
+{
+    if (_mode == Mode::PLAYBACK)
+    {
+        _frameTimes.push_back(milliseconds);
+    }
+}
+
+void Replay::PrintReport() const
+{
+    if (_mode == Mode::RECORD)
+    {
+        return;
+    }
+    if (_frameTimes.empty())
+    {
+        std::cout << "[REPLAY] No frames were played back" << std::endl;
+        return;
+    }
+
+    std::vector<double> sorted = _frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double frameTime : sorted)
+    {
+        total += frameTime;
+    }
+    const auto percentile = [&](double fraction)
+    {
+        return sorted[std::min((size_t)(fraction * sorted.size()), sorted.size() - 1)];
+    };
+
+    double recordedTotal = 0.0;
+    for (const Frame& frame : _frames)
+    {
+        recordedTotal += frame.delta;
+    }
+
+    std::cout << "[REPLAY] " << _path << ": " << _frameTimes.size() << " of " << _frames.size() << " frames, "
+        << (_fixedDelta > 0.0f ? "fixed delta " : "recorded deltas, ")
+        << (_fixedDelta > 0.0f ? _fixedDelta * 1000.0f : recordedTotal / _frames.size() * 1000.0) << " ms" << std::endl;
+    std::cout << "[REPLAY] Frame time: avg " << total / sorted.size() << " ms, p50 " << percentile(0.5)
+        << " ms, p99 " << percentile(0.99) << " ms, max " << sorted.back() << " ms" << std::endl;
+    std::cout << "[REPLAY] Total " << total / 1000.0 << " s, " << sorted.size() / (total / 1000.0) << " FPS" << std::endl;
+}
+
+void Replay::Record(float delta)
+{
+    const WindowInput input = Window::Get()->GetInput();
+    const glm::vec2 moved = input.cursorPosition - _lastInput.cursorPosition;
+
+    uint8_t flags = 0;
+    flags |= input.buttons != _lastInput.buttons ? BUTTONS_CHANGED : 0;
+    flags |= moved != glm::vec2(0.0f) ? CURSOR_MOVED : 0;
+
+    WriteValue(_output, flags);
+    WriteValue(_output, delta);
+    if (flags & BUTTONS_CHANGED)
+    {
+        WriteValue(_output, input.buttons);
+    }
+    if (flags & CURSOR_MOVED)
+    {
+        WriteValue(_output, moved.x);
+        WriteValue(_output, moved.y);
+    }
+
+    _lastInput = input;
+}
+
+bool Replay::Load()
+{
+    std::ifstream file = std::ifstream(_path, std::ios::binary);
+    char magic[4];
+    uint32_t version;
+    if (!file.read(magic, 4) || std::memcmp(magic, "KRRP", 4) != 0 || !ReadValue(file, version) || version != VERSION)
+    {
+        return false;
+    }
+
+    WindowInput input = _lastInput;
+    uint8_t flags;
+    while (ReadValue(file, flags))
+    {
+        Frame frame;
+        bool isComplete = ReadValue(file, frame.delta);
+        if (flags & BUTTONS_CHANGED)
+        {
+            isComplete = isComplete && ReadValue(file, input.buttons);
+        }
+        if (flags & CURSOR_MOVED)
+        {
+            glm::vec2 moved;
+            isComplete = isComplete && ReadValue(file, moved.x) && ReadValue(file, moved.y);
+            input.cursorPosition += moved;
+        }
+        // A recording cut short still plays back up to where it ends.
+        if (!isComplete)
+        {
+            break;
+        }
+
+        frame.input = input;
+        _frames.push_back(frame);
+    }
+    return true;
+}
+
+} // namespace Krafter
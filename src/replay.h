@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <optional>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "window.h"
+
+namespace Krafter
+{
+
+// Records the keys, buttons and cursor of every frame along with how long
+// the frame took, or plays a recording back in place of the devices so the
+// same fly-through can be run again and again. Played back, the frame times
+// are measured and reported at the end.
+//
+// A recording is "KRRP", a u32 version and then for every frame a u8 of
+// flags, the f32 delta and, only if they changed since the frame before, the
+// u16 buttons and the f32 x and y the cursor moved by.
+class Replay
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    enum class Mode
+    {
+        RECORD,
+        PLAYBACK
+    };
+
+    // Starts recording or loads the whole recording; check IsValid(). Played
+    // back with a fixed delta, every frame advances the game by it instead
+    // of the recorded delta, which makes the run independent of how fast the
+    // frames actually were.
+    Replay(const std::string& path, Mode mode, float fixedDelta = 0.0f);
+    ~Replay();
+
+    inline bool IsValid() const { return _isValid; }
+    inline Mode GetMode() const { return _mode; }
+
+    // Called once per frame, right after polling the window. Recording, the
+    // input and the measured delta are written out. Playing back, the next
+    // frame's input is put in the window and its delta returned in place of
+    // the measured one; false once the recording is over.
+    bool Update(float& delta);
+    // How long the frame took to run, from polling to swapping, in
+    // milliseconds; only kept while playing back.
+    void AddFrameTime(double milliseconds);
+    void PrintReport() const;
+
+private:
+    struct Frame
+    {
+        float delta;
+        WindowInput input;
+    };
+
+    enum Flags : uint8_t
+    {
+        BUTTONS_CHANGED = 1,
+        CURSOR_MOVED = 2
+    };
+
+    void Record(float delta);
+    bool Load();
+
+    std::string _path;
+    Mode _mode;
+    float _fixedDelta;
+    bool _isValid;
+
+    std::ofstream _output;
+    WindowInput _lastInput;
+
+    std::vector<Frame> _frames;
+    size_t _nextFrame;
+    std::vector<double> _frameTimes;
+};
+
+} // namespace Krafter
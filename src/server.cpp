@@ -0,0 +1,602 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <shared_mutex>
+#include <utility>
+#include <cmath>
+
+#include "thread_pool.h"
+#include "world.h"
+#include "chunk_codec.h"
+#include "camera.h"
+#include "server.h"
+
+namespace Krafter
+{
+
+void Server::Init(uint16_t port, const std::string& saveDirectory, int32_t viewDistance)
+{
+    _instance = new Server(port, saveDirectory, viewDistance);
+}
+
+void Server::Deinit()
+{
+    delete _instance;
+}
+
+void Server::Run()
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(TIMESTEP));
+
+    Clock::time_point nextTick = Clock::now();
+    while (_isRunning.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_until(nextTick);
+
+        // Ticks that fell behind are skipped rather than caught up with.
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > timestep * 4)
+        {
+            nextTick = now;
+        }
+
+        Tick();
+        nextTick += timestep;
+    }
+}
+
+ServerStats Server::GetStats()
+{
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_statsMutex);
+    return _stats;
+}
+
+Server::Server(uint16_t port, const std::string& saveDirectory, int32_t viewDistance)
+    : _port(port), _isRunning(true), _nextClientId(1), _random(std::random_device()()), _lastSaveTime(0.0), _tick(0),
+    _datagramBytesReceived(0)
+{
+    ThreadPool::Init();
+    World::Init();
+    World::Get()->SetViewDistance(viewDistance);
+    if (!saveDirectory.empty())
+    {
+        World::Get()->SetSaveDirectory(saveDirectory);
+    }
+
+    _listener = Socket::Listen(port);
+    if (_listener.IsValid())
+    {
+        _port = _listener.GetLocalAddress().port;
+        _datagrams = Socket::Bind(_port);
+    }
+}
+
+Server::~Server()
+{
+    _clients.clear();
+    World::Get()->Save();
+
+    ThreadPool::Deinit();
+    World::Deinit();
+}
+
+void Server::Tick()
+{
+    Timer timer;
+    World* world = World::Get();
+
+    AcceptClients();
+    ReceiveCommands();
+
+    std::unique_lock<std::shared_mutex> lock = std::unique_lock<std::shared_mutex>(world->GetMutex());
+
+    for (std::unique_ptr<Client>& client : _clients)
+    {
+        ReceiveMessages(*client);
+    }
+
+    _tick++;
+    StepPlayers();
+
+    std::vector<glm::vec3> centers;
+    for (const std::unique_ptr<Client>& client : _clients)
+    {
+        if (client->hasJoined)
+        {
+            centers.push_back(client->player.GetBody().position);
+        }
+    }
+    world->Update(centers);
+
+    EncodeBlockChanges();
+
+    ServerStats tickStats;
+    SendSnapshots(tickStats);
+    for (std::unique_ptr<Client>& client : _clients)
+    {
+        if (client->hasJoined)
+        {
+            SendBlockChanges(*client);
+            UpdateInterest(*client, tickStats);
+            StreamChunks(*client, tickStats);
+            tickStats.queuedChunks += client->pendingChunks.size();
+        }
+        client->connection.Flush();
+
+        tickStats.bytesSent += client->connection.GetBytesSent() - client->countedBytesSent;
+        tickStats.bytesReceived += client->connection.GetBytesReceived() - client->countedBytesReceived;
+        client->countedBytesSent = client->connection.GetBytesSent();
+        client->countedBytesReceived = client->connection.GetBytesReceived();
+    }
+
+    std::erase_if(_clients, [](const std::unique_ptr<Client>& client)
+    {
+        if (!client->connection.IsOpen())
+        {
+            std::cout << "[NET] Client " << client->id << " disconnected" << std::endl;
+            return true;
+        }
+        return false;
+    });
+
+    std::erase_if(_encodedChunks, [world](const auto& item) { return !world->GetChunks().contains(item.first); });
+
+    const double time = _saveTimer.GetElapsedSeconds();
+    if (time - _lastSaveTime >= SAVE_INTERVAL)
+    {
+        world->Save();
+        _lastSaveTime = time;
+    }
+
+    lock.unlock();
+
+    const double tickTime = timer.GetElapsedMilliseconds();
+
+    std::lock_guard<std::mutex> statsLock = std::lock_guard<std::mutex>(_statsMutex);
+    _stats.clientCount = _clients.size();
+    _stats.tickCount++;
+    _stats.totalTickTime += tickTime;
+    _stats.maxTickTime = glm::max(_stats.maxTickTime, tickTime);
+    _stats.bytesSent += tickStats.bytesSent;
+    _stats.bytesReceived += tickStats.bytesReceived + std::exchange(_datagramBytesReceived, 0);
+    _stats.chunksSent += tickStats.chunksSent;
+    _stats.blockChanges += _blockChanges.size();
+    _stats.queuedChunks = tickStats.queuedChunks;
+    _stats.cancelledChunks += tickStats.cancelledChunks;
+    _stats.totalTimeToVisible += tickStats.totalTimeToVisible;
+    _stats.maxTimeToVisible = glm::max(_stats.maxTimeToVisible, tickStats.maxTimeToVisible);
+    _blockChanges.clear();
+}
+
+void Server::AcceptClients()
+{
+    for (Socket socket = _listener.Accept(); socket.IsValid(); socket = _listener.Accept())
+    {
+        const uint32_t id = _nextClientId++;
+        _clients.push_back(std::unique_ptr<Client>(new Client {
+            .id = id,
+            .token = (uint32_t)_random(),
+            .connection = Connection(std::move(socket)),
+            .hasJoined = false,
+            .datagramAddress = {},
+            .hasDatagramAddress = false,
+            .player = Player(SPAWN_POSITION),
+            .yaw = 0.0f,
+            .pitch = 0.0f,
+            .commands = {},
+            .receivedSequence = 0,
+            .steppedSequence = 0,
+            .sentChunks = {},
+            .pendingChunks = {},
+            .interestCenter = glm::ivec2(0),
+            .hasInterest = false,
+            .sendBudget = CLIENT_BURST,
+            .countedBytesSent = 0,
+            .countedBytesReceived = 0
+        }));
+        std::cout << "[NET] Client " << id << " connected" << std::endl;
+    }
+}
+
+void Server::ReceiveMessages(Client& client)
+{
+    World* world = World::Get();
+
+    client.connection.Receive([&](MessageType type, PacketReader& reader)
+    {
+        switch (type)
+        {
+        case MessageType::HELLO:
+        {
+            const uint32_t version = reader.Read<uint32_t>();
+            if (!reader.IsValid() || version != Protocol::VERSION || client.hasJoined)
+            {
+                return false;
+            }
+
+            client.hasJoined = true;
+
+            PacketWriter writer;
+            writer.BeginMessage(MessageType::WELCOME);
+            writer.Write(client.id);
+            writer.Write(client.token);
+            writer.Write<int32_t>(world->GetViewDistance());
+            writer.Write(SPAWN_POSITION);
+            writer.EndMessage();
+            client.connection.Send(writer);
+            return true;
+        }
+        case MessageType::BLOCK_EDIT:
+        {
+            const glm::ivec3 position = reader.ReadIvec3();
+            const uint8_t block = reader.Read<uint8_t>();
+            if (!reader.IsValid() || !client.hasJoined || block >= BLOCK_COUNT)
+            {
+                return false;
+            }
+
+            // Clients can only edit what they were sent.
+            const uint64_t key = World::GetChunkKey(World::GetChunkCoords(position));
+            if (client.sentChunks.contains(key) && world->SetBlock(position, (Block)block))
+            {
+                _blockChanges.push_back({ position, (Block)block });
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    });
+}
+
+void Server::ReceiveCommands()
+{
+    uint8_t buffer[Protocol::MAX_DATAGRAM_SIZE];
+    Socket::Address address;
+    while (size_t size = _datagrams.ReceiveFrom(buffer, sizeof(buffer), address))
+    {
+        _datagramBytesReceived += size;
+
+        PacketReader reader = PacketReader(buffer, size);
+        const MessageType type = reader.Read<MessageType>();
+        const uint32_t id = reader.Read<uint32_t>();
+        const uint32_t token = reader.Read<uint32_t>();
+        const uint8_t count = reader.Read<uint8_t>();
+        if (!reader.IsValid() || type != MessageType::PLAYER_INPUT)
+        {
+            continue;
+        }
+
+        auto it = std::find_if(_clients.begin(), _clients.end(), [id](const std::unique_ptr<Client>& client)
+        {
+            return client->id == id;
+        });
+        if (it == _clients.end() || (*it)->token != token || !(*it)->hasJoined)
+        {
+            continue;
+        }
+
+        Client& client = **it;
+        client.datagramAddress = address;
+        client.hasDatagramAddress = true;
+
+        // Datagrams can arrive out of order and repeat the commands before
+        // their newest one; only the ones after what was received so far are
+        // queued. The difference wraps around along with the sequence.
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const PlayerCommand command = PlayerCommand::Read(reader);
+            const bool isFinite = std::isfinite(command.yaw) && std::isfinite(command.pitch) &&
+                std::isfinite(command.cameraPosition.x) && std::isfinite(command.cameraPosition.y) && std::isfinite(command.cameraPosition.z);
+            if (!reader.IsValid() || !isFinite)
+            {
+                break;
+            }
+
+            if ((int32_t)(command.sequence - client.receivedSequence) > 0)
+            {
+                client.commands.push_back(command);
+                client.receivedSequence = command.sequence;
+                if (client.commands.size() > MAX_QUEUED_COMMANDS)
+                {
+                    client.commands.pop_front();
+                }
+            }
+        }
+    }
+}
+
+void Server::StepPlayers()
+{
+    const World* world = World::Get();
+
+    // A player without new commands stands still, since the client could
+    // not have predicted anything else.
+    for (std::unique_ptr<Client>& client : _clients)
+    {
+        const size_t count = client->commands.size() > MAX_BUFFERED_COMMANDS ? 2 : 1;
+        for (size_t i = 0; i < count && !client->commands.empty(); i++)
+        {
+            const PlayerCommand& command = client->commands.front();
+            client->player.Tick(*world, command.ToInput());
+            client->yaw = command.yaw;
+            client->pitch = command.pitch;
+            client->steppedSequence = command.sequence;
+            client->commands.pop_front();
+        }
+    }
+}
+
+void Server::SendSnapshots(ServerStats& stats)
+{
+    const float viewDistance = (float)(World::Get()->GetViewDistance() * Chunk::WIDTH);
+
+    PacketWriter writer;
+    std::vector<std::pair<float, const Client*>> others;
+    for (const std::unique_ptr<Client>& client : _clients)
+    {
+        if (!client->hasJoined || !client->hasDatagramAddress)
+        {
+            continue;
+        }
+
+        const PhysicsBody& body = client->player.GetBody();
+        PlayerSnapshot snapshot = {
+            .tick = _tick,
+            .sequence = client->steppedSequence,
+            .position = body.position,
+            .velocity = body.velocity,
+            .isOnGround = body.isOnGround,
+            .remotePlayers = {}
+        };
+
+        // The nearest ones within the view distance.
+        others.clear();
+        for (const std::unique_ptr<Client>& other : _clients)
+        {
+            const float distance = glm::length(other->player.GetBody().position - body.position);
+            if (other != client && other->hasJoined && distance <= viewDistance)
+            {
+                others.push_back({ distance, other.get() });
+            }
+        }
+        std::sort(others.begin(), others.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < others.size() && i < MAX_REMOTE_PLAYERS; i++)
+        {
+            snapshot.remotePlayers.push_back({ others[i].second->id, others[i].second->player.GetBody().position, others[i].second->yaw });
+        }
+
+        writer.Clear();
+        writer.Write(MessageType::PLAYER_STATE);
+        snapshot.Write(writer);
+        if (_datagrams.SendTo(writer.GetData().data(), writer.GetData().size(), client->datagramAddress))
+        {
+            stats.bytesSent += writer.GetData().size();
+        }
+    }
+}
+
+void Server::EncodeBlockChanges()
+{
+    _sectionDeltas.clear();
+
+    for (const BlockChange& change : _blockChanges)
+    {
+        const glm::ivec2 chunkCoords = World::GetChunkCoords(change.position);
+        const uint64_t chunkKey = World::GetChunkKey(chunkCoords);
+        const uint32_t section = change.position.y / ChunkCodec::SECTION_HEIGHT;
+
+        auto it = std::find_if(_sectionDeltas.begin(), _sectionDeltas.end(), [&](const SectionDelta& delta)
+        {
+            return delta.chunkKey == chunkKey && delta.section == section;
+        });
+        if (it == _sectionDeltas.end())
+        {
+            it = _sectionDeltas.insert(_sectionDeltas.end(), {
+                .chunkKey = chunkKey,
+                .chunkCoords = chunkCoords,
+                .section = section,
+                .indices = {},
+                .blocks = {},
+                .data = {}
+            });
+        }
+
+        // The block's index within its section, as in Chunk.
+        const glm::ivec3 coords = change.position - glm::ivec3(chunkCoords.x, section, chunkCoords.y) *
+            glm::ivec3(Chunk::WIDTH, ChunkCodec::SECTION_HEIGHT, Chunk::WIDTH);
+        const uint16_t index = (coords.y * Chunk::WIDTH + coords.z) * Chunk::WIDTH + coords.x;
+
+        auto changed = std::find(it->indices.begin(), it->indices.end(), index);
+        if (changed != it->indices.end())
+        {
+            it->blocks[changed - it->indices.begin()] = change.block;
+        }
+        else
+        {
+            it->indices.push_back(index);
+            it->blocks.push_back(change.block);
+        }
+    }
+
+    for (SectionDelta& delta : _sectionDeltas)
+    {
+        PacketWriter writer;
+        writer.Write(delta.chunkCoords.x);
+        writer.Write(delta.chunkCoords.y);
+        writer.Write<uint8_t>(delta.section);
+        writer.WriteVarint(delta.indices.size());
+        for (size_t i = 0; i < delta.indices.size(); i++)
+        {
+            writer.Write(delta.indices[i]);
+            writer.Write(delta.blocks[i]);
+        }
+        delta.data = std::move(writer.GetData());
+    }
+}
+
+void Server::SendBlockChanges(Client& client)
+{
+    std::vector<const SectionDelta*> deltas;
+    for (const SectionDelta& delta : _sectionDeltas)
+    {
+        if (client.sentChunks.contains(delta.chunkKey))
+        {
+            deltas.push_back(&delta);
+        }
+    }
+    if (deltas.empty())
+    {
+        return;
+    }
+
+    PacketWriter writer;
+    writer.BeginMessage(MessageType::BLOCK_CHANGES);
+    writer.WriteVarint(deltas.size());
+    for (const SectionDelta* delta : deltas)
+    {
+        writer.WriteBytes(delta->data.data(), delta->data.size());
+    }
+    writer.EndMessage();
+    client.connection.Send(writer);
+}
+
+void Server::UpdateInterest(Client& client, ServerStats& stats)
+{
+    const int32_t viewDistance = World::Get()->GetViewDistance();
+    const glm::ivec2 center = World::GetChunkCoords(glm::ivec3(glm::floor(client.player.GetBody().position)));
+    if (client.hasInterest && center == client.interestCenter)
+    {
+        return;
+    }
+    client.interestCenter = center;
+    client.hasInterest = true;
+
+    // Dropped a little past the view distance, like the world does.
+    PacketWriter writer;
+    std::erase_if(client.sentChunks, [&](const auto& item)
+    {
+        const glm::ivec2 offset = item.second - center;
+        if (glm::max(glm::abs(offset.x), glm::abs(offset.y)) <= viewDistance + 1)
+        {
+            return false;
+        }
+
+        writer.BeginMessage(MessageType::UNLOAD_CHUNK);
+        writer.Write(item.second.x);
+        writer.Write(item.second.y);
+        writer.EndMessage();
+        return true;
+    });
+    client.connection.Send(writer);
+
+    std::erase_if(client.pendingChunks, [&](const auto& item)
+    {
+        const glm::ivec2 offset = item.second.chunkCoords - center;
+        const bool isCancelled = offset.x * offset.x + offset.y * offset.y > viewDistance * viewDistance;
+        stats.cancelledChunks += isCancelled;
+        return isCancelled;
+    });
+
+    const double time = Timer::GetTime();
+    for (int32_t x = -viewDistance; x <= viewDistance; x++)
+    {
+        for (int32_t z = -viewDistance; z <= viewDistance; z++)
+        {
+            const glm::ivec2 chunkCoords = center + glm::ivec2(x, z);
+            const uint64_t key = World::GetChunkKey(chunkCoords);
+            if (x * x + z * z <= viewDistance * viewDistance && !client.sentChunks.contains(key))
+            {
+                client.pendingChunks.try_emplace(key, PendingChunk { chunkCoords, time });
+            }
+        }
+    }
+}
+
+void Server::StreamChunks(Client& client, ServerStats& stats)
+{
+    const World* world = World::Get();
+
+    client.sendBudget = glm::min(client.sendBudget + CLIENT_BANDWIDTH * TIMESTEP, CLIENT_BURST);
+    if (client.sendBudget <= 0.0 || client.connection.GetQueuedSize() >= MAX_QUEUED_BYTES)
+    {
+        return;
+    }
+
+    std::vector<std::pair<float, uint64_t>> queue;
+    for (const auto& [key, pendingChunk] : client.pendingChunks)
+    {
+        if (world->GetChunks().contains(key))
+        {
+            queue.push_back({ GetChunkPriority(client, pendingChunk.chunkCoords), key });
+        }
+    }
+    std::sort(queue.begin(), queue.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const double time = Timer::GetTime();
+    PacketWriter writer;
+    for (const auto& [priority, key] : queue)
+    {
+        if (client.sendBudget <= 0.0)
+        {
+            break;
+        }
+
+        const PendingChunk pendingChunk = client.pendingChunks.at(key);
+        const EncodedChunk& encodedChunk = GetEncodedChunk(key, *world->GetChunks().at(key));
+
+        const size_t start = writer.GetData().size();
+        writer.BeginMessage(MessageType::CHUNK);
+        writer.Write(pendingChunk.chunkCoords.x);
+        writer.Write(pendingChunk.chunkCoords.y);
+        writer.WriteVarint(encodedChunk.data.size());
+        writer.WriteBytes(encodedChunk.data.data(), encodedChunk.data.size());
+        writer.EndMessage();
+        client.sendBudget -= writer.GetData().size() - start;
+
+        client.sentChunks[key] = pendingChunk.chunkCoords;
+        client.pendingChunks.erase(key);
+
+        const double timeToVisible = (time - pendingChunk.time) * 1000.0;
+        stats.chunksSent++;
+        stats.totalTimeToVisible += timeToVisible;
+        stats.maxTimeToVisible = glm::max(stats.maxTimeToVisible, timeToVisible);
+    }
+
+    client.connection.Send(writer);
+}
+
+float Server::GetChunkPriority(const Client& client, const glm::ivec2& chunkCoords) const
+{
+    const glm::vec3& position = client.player.GetBody().position;
+    const glm::vec2 offset = (glm::vec2(chunkCoords) + 0.5f) * (float)Chunk::WIDTH - glm::vec2(position.x, position.z);
+    const float distance = glm::length(offset) / Chunk::WIDTH;
+
+    // The chunks right around a client are needed whichever way it looks,
+    // and so are all of them when it looks almost straight up or down.
+    const glm::vec3 direction = Camera::GetDirectionOf(client.yaw, client.pitch);
+    const glm::vec2 forward = glm::vec2(direction.x, direction.z);
+    if (distance < 1.5f || glm::length(forward) < 0.1f)
+    {
+        return distance;
+    }
+
+    const bool isInView = glm::dot(offset / glm::length(offset), glm::normalize(forward)) >= VIEW_CONE_COS;
+    return isInView ? distance : distance * OUT_OF_VIEW_WEIGHT;
+}
+
+const Server::EncodedChunk& Server::GetEncodedChunk(uint64_t key, const Chunk& chunk)
+{
+    EncodedChunk& encodedChunk = _encodedChunks[key];
+    if (encodedChunk.data.empty() || encodedChunk.revision != chunk.GetBlockRevision())
+    {
+        encodedChunk.revision = chunk.GetBlockRevision();
+        encodedChunk.data.clear();
+        ChunkCodec::Encode(chunk.GetBlocks(), encodedChunk.data);
+    }
+    return encodedChunk;
+}
+
+} // namespace Krafter
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "timer.h"
+#include "block.h"
+#include "physics.h"
+#include "player.h"
+#include "protocol.h"
+#include "prediction.h"
+
+namespace Krafter
+{
+
+struct ServerStats
+{
+    size_t clientCount = 0;
+    uint64_t tickCount = 0;
+    double totalTickTime = 0.0;
+    double maxTickTime = 0.0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t chunksSent = 0;
+    uint64_t blockChanges = 0;
+
+    // Chunks within the view distance of a client that it does not have
+    // yet, right now, and the ones it walked away from before getting them.
+    size_t queuedChunks = 0;
+    uint64_t cancelledChunks = 0;
+    // From a chunk coming into a client's view distance to it being sent,
+    // including the time to generate it.
+    double totalTimeToVisible = 0.0;
+    double maxTimeToVisible = 0.0;
+};
+
+// Owns the world without a window: clients connect over TCP, get the chunks
+// around them streamed, and send their block edits, which are applied and
+// passed on to every client that has the chunk. Players only move by the
+// commands their clients send, stepped with the same physics as the local
+// simulation and at the same fixed rate, and every tick each client gets a
+// snapshot of where its player and the ones around it ended up.
+class Server
+{
+public:
+    static constexpr double TIMESTEP = Physics::TIMESTEP;
+    static constexpr double SAVE_INTERVAL = 30.0;
+    // Each client earns a budget of this many bytes per second to stream
+    // chunks with and can save up to a burst of it. Nothing is streamed
+    // while its connection still has the byte limit queued, so a slow client
+    // cannot make the server buffer the world for it.
+    static constexpr double CLIENT_BANDWIDTH = 256.0 * 1024.0;
+    static constexpr double CLIENT_BURST = 64.0 * 1024.0;
+    static constexpr size_t MAX_QUEUED_BYTES = 1 << 20;
+    // Chunks within about 70 degrees of where a client looks are sent by
+    // distance; the ones outside wait as if they were this much farther.
+    static constexpr float VIEW_CONE_COS = 0.34f;
+    static constexpr float OUT_OF_VIEW_WEIGHT = 2.0f;
+    // One command is stepped per tick, so jitter on the way in does not
+    // make the player move unevenly. Every tick a command is missing the
+    // queue grows by one, until it covers the jitter; past the limit two
+    // are stepped per tick to catch up again, and a client sending far more
+    // than one per tick has the excess dropped.
+    static constexpr size_t MAX_BUFFERED_COMMANDS = 8;
+    static constexpr size_t MAX_QUEUED_COMMANDS = 32;
+    // As many as fit into a datagram along with the player's own state.
+    static constexpr size_t MAX_REMOTE_PLAYERS = 16;
+    static constexpr glm::vec3 SPAWN_POSITION = glm::vec3(8.0f, 200.0f, 8.0f);
+
+    // An empty save directory keeps the world in memory only.
+    static void Init(uint16_t port, const std::string& saveDirectory, int32_t viewDistance);
+    static void Deinit();
+    inline static Server* Get() { return _instance; }
+
+    // Ticks until Stop() is called, from any thread.
+    void Run();
+    inline void Stop() { _isRunning = false; }
+
+    inline bool IsListening() const { return _listener.IsValid() && _datagrams.IsValid(); }
+    inline uint16_t GetPort() const { return _port; }
+    ServerStats GetStats();
+
+private:
+    struct PendingChunk
+    {
+        glm::ivec2 chunkCoords;
+        // When it came into the view distance, on Timer::GetTime().
+        double time;
+    };
+
+    struct Client
+    {
+        uint32_t id;
+        uint32_t token;
+        Connection connection;
+        bool hasJoined;
+        // Where UDP datagrams from the client come from, once one has.
+        Socket::Address datagramAddress;
+        bool hasDatagramAddress;
+        Player player;
+        // Of the last command stepped, as in Camera.
+        float yaw;
+        float pitch;
+        // Received but not stepped yet, oldest first.
+        std::deque<PlayerCommand> commands;
+        uint32_t receivedSequence;
+        uint32_t steppedSequence;
+        // Every chunk the client has, by key.
+        std::unordered_map<uint64_t, glm::ivec2> sentChunks;
+        // Every chunk within the view distance of interestCenter the client
+        // does not have yet, by key.
+        std::unordered_map<uint64_t, PendingChunk> pendingChunks;
+        glm::ivec2 interestCenter;
+        bool hasInterest;
+        double sendBudget;
+        // What the connection had sent and received at the last tick.
+        uint64_t countedBytesSent;
+        uint64_t countedBytesReceived;
+    };
+
+    struct BlockChange
+    {
+        glm::ivec3 position;
+        Block block;
+    };
+
+    // The changes of a tick to one section, already encoded the way
+    // BLOCK_CHANGES carries them.
+    struct SectionDelta
+    {
+        uint64_t chunkKey;
+        glm::ivec2 chunkCoords;
+        uint32_t section;
+        std::vector<uint16_t> indices;
+        std::vector<Block> blocks;
+        std::vector<uint8_t> data;
+    };
+
+    struct EncodedChunk
+    {
+        uint32_t revision;
+        std::vector<uint8_t> data;
+    };
+
+    inline static Server* _instance;
+
+    Server(uint16_t port, const std::string& saveDirectory, int32_t viewDistance);
+    ~Server();
+
+    void Tick();
+    void AcceptClients();
+    void ReceiveMessages(Client& client);
+    // Queues the commands of every client, dropping the ones it has
+    // already.
+    void ReceiveCommands();
+    void StepPlayers();
+    void SendSnapshots(ServerStats& stats);
+    // Groups the tick's block changes by section, with only the last change
+    // to each block kept.
+    void EncodeBlockChanges();
+    void SendBlockChanges(Client& client);
+    // Once the client entered another chunk, unloads the chunks it left
+    // behind, and queues the ones that came into its view distance and
+    // cancels the queued ones that left it.
+    void UpdateInterest(Client& client, ServerStats& stats);
+    // Sends the queued chunks that are loaded, in order of priority, as far
+    // as the client's budget goes.
+    void StreamChunks(Client& client, ServerStats& stats);
+    // Lower goes first.
+    float GetChunkPriority(const Client& client, const glm::ivec2& chunkCoords) const;
+    const EncodedChunk& GetEncodedChunk(uint64_t key, const Chunk& chunk);
+
+    uint16_t _port;
+    Socket _listener;
+    Socket _datagrams;
+    std::atomic<bool> _isRunning;
+
+    std::vector<std::unique_ptr<Client>> _clients;
+    uint32_t _nextClientId;
+    std::mt19937 _random;
+
+    // Edits applied this tick, sent to the clients at its end.
+    std::vector<BlockChange> _blockChanges;
+    std::vector<SectionDelta> _sectionDeltas;
+    // Clients around the same place get the same chunks, so each one is
+    // only encoded once per block revision.
+    std::unordered_map<uint64_t, EncodedChunk> _encodedChunks;
+
+    Timer _saveTimer;
+    double _lastSaveTime;
+
+    uint32_t _tick;
+    uint64_t _datagramBytesReceived;
+
+    std::mutex _statsMutex;
+    ServerStats _stats;
+};
+
+} // namespace Krafter
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+
+#include "protocol.h"
+#include "server.h"
+#include "load_test.h"
+#include "prediction_test.h"
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && std::string(argv[1]) == "--load-test")
+    {
+        const double duration = argc >= 4 ? std::stod(argv[3]) : 10.0;
+        return Krafter::LoadTest::Run(std::stoul(argv[2]), duration) ? 0 : 1;
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--prediction-test")
+    {
+        const Krafter::NetworkConditions conditions = {
+            .latency = std::stod(argv[2]) / 1000.0,
+            .jitter = std::stod(argv[3]) / 1000.0,
+            .loss = argc >= 5 ? std::stof(argv[4]) / 100.0f : 0.0f
+        };
+        const double duration = argc >= 6 ? std::stod(argv[5]) : 10.0;
+        return Krafter::PredictionTest::Run(conditions, duration) ? 0 : 1;
+    }
+
+    uint16_t port = Krafter::Protocol::DEFAULT_PORT;
+    std::string saveDirectory = "saves/world";
+    int32_t viewDistance = 12;
+    for (int32_t i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (option == "--port")
+        {
+            port = std::stoul(argv[i + 1]);
+        }
+        else if (option == "--save")
+        {
+            saveDirectory = argv[i + 1];
+        }
+        else if (option == "--view-distance")
+        {
+            viewDistance = std::stoi(argv[i + 1]);
+        }
+        else
+        {
+            std::cerr << "[SERVER] Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    Krafter::Server::Init(port, saveDirectory, viewDistance);
+    if (!Krafter::Server::Get()->IsListening())
+    {
+        Krafter::Server::Deinit();
+        return 1;
+    }
+
+    // The world is saved on the way out.
+    std::signal(SIGINT, [](int) { Krafter::Server::Get()->Stop(); });
+    std::signal(SIGTERM, [](int) { Krafter::Server::Get()->Stop(); });
+
+    std::cout << "[SERVER] Listening on port " << Krafter::Server::Get()->GetPort() << std::endl;
+    Krafter::Server::Get()->Run();
+    Krafter::Server::Deinit();
+
+    return 0;
+}
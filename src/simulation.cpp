@@ -0,0 +1,165 @@
+#include <chrono>
+#include <shared_mutex>
+
+#include "imgui.h"
+
+#include "timer.h"
+#include "simulation.h"
+
+namespace Krafter
+{
+
+float SimulationState::GetInterpolation(double currentTime) const
+{
+    return (float)glm::clamp((currentTime - time) / Simulation::TIMESTEP, 0.0, 1.0);
+}
+
+glm::vec3 SimulationState::GetPlayerPosition(double currentTime) const
+{
+    return glm::mix(previousPlayerPosition, playerBody.position, GetInterpolation(currentTime));
+}
+
+void Simulation::Init()
+{
+    _instance = new Simulation();
+}
+
+void Simulation::Deinit()
+{
+    delete _instance;
+}
+
+void Simulation::RenderImGui(const SimulationState& state)
+{
+    const PhysicsBody& body = state.playerBody;
+
+    ImGui::Text("Simulation Details:");
+    ImGui::Text("Tick %llu at %.0f Hz, last took %.3f ms", (unsigned long long)state.tick, 1.0 / TIMESTEP, state.tickTime);
+    ImGui::Text("Player: %s, velocity %.2f, %.2f, %.2f", body.isOnGround ? "on ground" : "in air",
+        body.velocity.x, body.velocity.y, body.velocity.z);
+    ImGui::Text("Entities: %zu in %zu archetypes, updated in %.3f ms", state.entityCount, state.archetypeCount, state.entityTime);
+}
+
+Simulation::Simulation()
+    : _tick(0), _breakCount(0), _placeCount(0), _spawnCount(0), _brokenBlockSequence(0), _isRunning(true)
+{
+    _thread = std::thread(&Simulation::Run, this);
+}
+
+Simulation::~Simulation()
+{
+    _isRunning = false;
+    _thread.join();
+}
+
+void Simulation::Run()
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(TIMESTEP));
+    const Clock::duration maxLag = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(MAX_LAG));
+
+    Clock::time_point nextTick = Clock::now();
+    while (_isRunning.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_until(nextTick);
+
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > maxLag)
+        {
+            nextTick = now;
+        }
+
+        Tick(_input.Read(), std::chrono::duration<double>(nextTick.time_since_epoch()).count());
+        nextTick += timestep;
+    }
+}
+
+void Simulation::Tick(const SimulationInput& input, double time)
+{
+    Timer timer;
+
+    World* world = World::Get();
+    std::unique_lock<std::shared_mutex> lock = std::unique_lock<std::shared_mutex>(world->GetMutex());
+
+    SimulationState& state = _state.GetWriteBuffer();
+
+    _player.Tick(*world, input.player);
+    UpdateBlockInteraction(input, state.target);
+
+    if (input.spawnCount != _spawnCount)
+    {
+        EntitySystems::SpawnMobsAround(_entities, *world, _player.GetBody().position, SPAWN_RADIUS,
+            input.spawnCount - _spawnCount, (uint32_t)_tick);
+        _spawnCount = input.spawnCount;
+    }
+
+    Timer entityTimer;
+    EntitySystems::UpdateOrientation(_entities, Physics::TIMESTEP);
+    EntitySystems::UpdateWander(_entities, Physics::TIMESTEP);
+    EntitySystems::UpdatePhysics(_entities, *world, Physics::TIMESTEP);
+    EntitySystems::Despawn(_entities, *world, _player.GetBody().position, Physics::TIMESTEP);
+    state.entityTime = entityTimer.GetElapsedMilliseconds();
+
+    world->Update(input.player.cameraPosition);
+
+    lock.unlock();
+
+    EntitySystems::CollectInstances(_entities, state.entities);
+    state.entityCount = _entities.GetCount();
+    state.archetypeCount = _entities.GetArchetypeCount();
+
+    state.tick = ++_tick;
+    state.time = time;
+    state.previousPlayerPosition = _player.GetPreviousPosition();
+    state.playerBody = _player.GetBody();
+    state.brokenBlocks = _brokenBlocks;
+    state.tickTime = timer.GetElapsedMilliseconds();
+    _state.Publish();
+}
+
+void Simulation::UpdateBlockInteraction(const SimulationInput& input, std::optional<RaycastHit>& target)
+{
+    World* world = World::Get();
+    auto raycast = [&]()
+    {
+        return world->Raycast(input.player.cameraPosition, input.player.cameraDirection, REACH);
+    };
+    target = raycast();
+
+    // Every click since the last tick is carried out, breaking before
+    // placing, each against whatever the one before left in sight.
+    const uint32_t breakCount = input.isControlled ? input.breakCount - _breakCount : 0;
+    const uint32_t placeCount = input.isControlled ? input.placeCount - _placeCount : 0;
+    _breakCount = input.breakCount;
+    _placeCount = input.placeCount;
+
+    for (uint32_t i = 0; i < breakCount && target; i++)
+    {
+        // The block drops as an item.
+        if (world->SetBlock(target->position, Block::AIR))
+        {
+            EntitySystems::SpawnItem(_entities, glm::vec3(target->position) + glm::vec3(0.5f, 0.25f, 0.5f), target->block);
+
+            if (_brokenBlocks.size() == BROKEN_BLOCK_HISTORY)
+            {
+                _brokenBlocks.erase(_brokenBlocks.begin());
+            }
+            _brokenBlocks.push_back({ ++_brokenBlockSequence, target->position, target->block });
+        }
+        target = raycast();
+    }
+
+    for (uint32_t i = 0; i < placeCount && target; i++)
+    {
+        glm::ivec3 position = target->position + GetNormalOf(target->face);
+        bool isBlocked = BlockInfo::GetInfoOf(input.placedBlock).isSolid &&
+            !input.player.isFlying && Physics::IsOverlapping(_player.GetBody(), position);
+        if (!BlockInfo::GetInfoOf(world->GetBlock(position)).isSolid && !isBlocked)
+        {
+            world->SetBlock(position, input.placedBlock);
+        }
+        target = raycast();
+    }
+}
+
+} // namespace Krafter
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "triple_buffer.h"
+#include "world.h"
+#include "player.h"
+#include "entities.h"
+
+namespace Krafter
+{
+
+struct SimulationInput
+{
+    PlayerInput player;
+    bool isControlled = false;
+    // Clicks are counted rather than sampled, so one that starts and ends
+    // between two ticks still gets through.
+    uint32_t breakCount = 0;
+    uint32_t placeCount = 0;
+    Block placedBlock = Block::DIRT;
+    // Mobs asked for so far, spawned around the player.
+    uint32_t spawnCount = 0;
+};
+
+struct BrokenBlock
+{
+    // Counts up from 1 with every block broken.
+    uint32_t sequence;
+    glm::ivec3 position;
+    Block block;
+};
+
+struct SimulationState
+{
+    uint64_t tick = 0;
+    // When the tick was due on the monotonic clock of Timer::GetTime().
+    double time = 0.0;
+    double tickTime = 0.0;
+    double entityTime = 0.0;
+
+    glm::vec3 previousPlayerPosition = glm::vec3(0.0f);
+    PhysicsBody playerBody = {};
+    std::optional<RaycastHit> target;
+    // The last few blocks broken, so that effects are not lost when the
+    // game thread skips states.
+    std::vector<BrokenBlock> brokenBlocks;
+
+    size_t entityCount = 0;
+    size_t archetypeCount = 0;
+    EntityInstances entities;
+
+    // How far the given time is into the tick after this state was due, from
+    // 0 at the previous positions to 1 at the current ones.
+    float GetInterpolation(double currentTime) const;
+    glm::vec3 GetPlayerPosition(double currentTime) const;
+};
+
+// Steps the player, block edits and chunk streaming at a fixed rate on its
+// own thread. Input goes in and the resulting state comes out through triple
+// buffers, so neither side ever waits on the other; the world itself is held
+// for the length of a tick.
+class Simulation
+{
+public:
+    static constexpr double TIMESTEP = Physics::TIMESTEP;
+    // Longer stalls are skipped instead of caught up with.
+    static constexpr double MAX_LAG = 0.25;
+    static constexpr float REACH = 8.0f;
+    static constexpr float SPAWN_RADIUS = 48.0f;
+    static constexpr size_t BROKEN_BLOCK_HISTORY = 16;
+
+    static void Init();
+    static void Deinit();
+    inline static Simulation* Get() { return _instance; }
+
+    // Only to be called from the game thread, which also reads the state.
+    inline void SubmitInput(const SimulationInput& input)
+    {
+        _input.GetWriteBuffer() = input;
+        _input.Publish();
+    }
+    // The state stays valid until the next call.
+    inline const SimulationState& GetState() { return _state.Read(); }
+    void RenderImGui(const SimulationState& state);
+
+private:
+    inline static Simulation* _instance;
+
+    Simulation();
+    ~Simulation();
+
+    void Run();
+    void Tick(const SimulationInput& input, double time);
+
+    // Breaks the targeted block on every left click and places one against
+    // the targeted face on every right click since the last tick.
+    void UpdateBlockInteraction(const SimulationInput& input, std::optional<RaycastHit>& target);
+
+    TripleBuffer<SimulationInput> _input;
+    TripleBuffer<SimulationState> _state;
+
+    Player _player;
+    EntityRegistry _entities;
+    uint64_t _tick;
+    uint32_t _breakCount;
+    uint32_t _placeCount;
+    uint32_t _spawnCount;
+    std::vector<BrokenBlock> _brokenBlocks;
+    uint32_t _brokenBlockSequence;
+
+    std::atomic<bool> _isRunning;
+    std::thread _thread;
+};
+
+} // namespace Krafter
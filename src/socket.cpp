@@ -0,0 +1,266 @@
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "socket.h"
+
+namespace Krafter
+{
+
+#ifdef _WIN32
+using SocketLength = int;
+
+static bool IsWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+using SocketLength = socklen_t;
+
+static bool IsWouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+#endif
+
+static sockaddr_in ToSocketAddress(const Socket::Address& address)
+{
+    sockaddr_in result = {};
+    result.sin_family = AF_INET;
+    result.sin_addr.s_addr = htonl(address.host);
+    result.sin_port = htons(address.port);
+    return result;
+}
+
+static Socket::Address FromSocketAddress(const sockaddr_in& address)
+{
+    return { ntohl(address.sin_addr.s_addr), ntohs(address.sin_port) };
+}
+
+Socket Socket::Listen(uint16_t port)
+{
+    Socket socket = Create(SOCK_STREAM);
+    if (!socket.IsValid())
+    {
+        return socket;
+    }
+
+    // A restarted server can take its port back right away.
+    int32_t isReused = 1;
+    setsockopt(socket._handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&isReused, sizeof(isReused));
+
+    sockaddr_in address = ToSocketAddress({ INADDR_ANY, port });
+    if (bind(socket._handle, (const sockaddr*)&address, sizeof(address)) != 0 || listen(socket._handle, SOMAXCONN) != 0 ||
+        !socket.SetNonBlocking())
+    {
+        std::cerr << "[NET] Could not listen on port " << port << std::endl;
+        socket.Close();
+    }
+
+    return socket;
+}
+
+Socket Socket::Connect(const Address& address)
+{
+    Socket socket = Create(SOCK_STREAM);
+    if (!socket.IsValid())
+    {
+        return socket;
+    }
+
+    sockaddr_in socketAddress = ToSocketAddress(address);
+    if (connect(socket._handle, (const sockaddr*)&socketAddress, sizeof(socketAddress)) != 0 || !socket.SetNonBlocking())
+    {
+        std::cerr << "[NET] Could not connect to port " << address.port << std::endl;
+        socket.Close();
+    }
+    socket.SetNoDelay();
+
+    return socket;
+}
+
+Socket Socket::Bind(uint16_t port)
+{
+    Socket socket = Create(SOCK_DGRAM);
+    if (!socket.IsValid())
+    {
+        return socket;
+    }
+
+    sockaddr_in address = ToSocketAddress({ INADDR_ANY, port });
+    if (bind(socket._handle, (const sockaddr*)&address, sizeof(address)) != 0 || !socket.SetNonBlocking())
+    {
+        std::cerr << "[NET] Could not bind port " << port << std::endl;
+        socket.Close();
+    }
+
+    return socket;
+}
+
+Socket::Socket()
+    : _handle(INVALID_HANDLE)
+{
+}
+
+Socket::Socket(intptr_t handle)
+    : _handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+    Close();
+}
+
+Socket::Socket(Socket&& other)
+    : _handle(std::exchange(other._handle, INVALID_HANDLE))
+{
+}
+
+Socket& Socket::operator=(Socket&& other)
+{
+    if (this != &other)
+    {
+        Close();
+        _handle = std::exchange(other._handle, INVALID_HANDLE);
+    }
+    return *this;
+}
+
+Socket::Address Socket::GetLocalAddress() const
+{
+    sockaddr_in address = {};
+    SocketLength length = sizeof(address);
+    getsockname(_handle, (sockaddr*)&address, &length);
+    return FromSocketAddress(address);
+}
+
+Socket Socket::Accept()
+{
+    intptr_t handle = (intptr_t)accept(_handle, nullptr, nullptr);
+    if (handle < 0)
+    {
+        return Socket();
+    }
+
+    Socket socket = Socket(handle);
+    socket.SetNoDelay();
+    if (!socket.SetNonBlocking())
+    {
+        socket.Close();
+    }
+    return socket;
+}
+
+int64_t Socket::Send(const void* data, size_t size)
+{
+#ifdef _WIN32
+    int64_t result = send(_handle, (const char*)data, (int)size, 0);
+#else
+    int64_t result = send(_handle, data, size, MSG_NOSIGNAL);
+#endif
+    if (result < 0)
+    {
+        return IsWouldBlock() ? 0 : -1;
+    }
+    return result;
+}
+
+int64_t Socket::Receive(void* data, size_t size)
+{
+    int64_t result = recv(_handle, (char*)data, size, 0);
+    if (result < 0)
+    {
+        return IsWouldBlock() ? 0 : -1;
+    }
+    // An orderly shutdown from the other side.
+    return result == 0 ? -1 : result;
+}
+
+bool Socket::SendTo(const void* data, size_t size, const Address& address)
+{
+    sockaddr_in socketAddress = ToSocketAddress(address);
+    return sendto(_handle, (const char*)data, size, 0, (const sockaddr*)&socketAddress, sizeof(socketAddress)) == (int64_t)size;
+}
+
+size_t Socket::ReceiveFrom(void* data, size_t size, Address& address)
+{
+    sockaddr_in socketAddress = {};
+    SocketLength length = sizeof(socketAddress);
+    int64_t result = recvfrom(_handle, (char*)data, size, 0, (sockaddr*)&socketAddress, &length);
+    if (result <= 0)
+    {
+        return 0;
+    }
+
+    address = FromSocketAddress(socketAddress);
+    return result;
+}
+
+Socket Socket::Create(int32_t type)
+{
+#ifdef _WIN32
+    static const bool isStarted = []
+    {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!isStarted)
+    {
+        return Socket();
+    }
+#endif
+
+    intptr_t handle = (intptr_t)socket(AF_INET, type, 0);
+    if (handle < 0)
+    {
+        std::cerr << "[NET] Could not create a socket" << std::endl;
+        return Socket();
+    }
+    return Socket(handle);
+}
+
+void Socket::Close()
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    closesocket(_handle);
+#else
+    close(_handle);
+#endif
+    _handle = INVALID_HANDLE;
+}
+
+void Socket::SetNoDelay()
+{
+    // Small messages like block edits go out right away instead of waiting
+    // to be coalesced.
+    if (IsValid())
+    {
+        int32_t isNoDelay = 1;
+        setsockopt(_handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&isNoDelay, sizeof(isNoDelay));
+    }
+}
+
+bool Socket::SetNonBlocking()
+{
+#ifdef _WIN32
+    u_long isNonBlocking = 1;
+    return ioctlsocket(_handle, FIONBIO, &isNonBlocking) == 0;
+#else
+    int32_t flags = fcntl(_handle, F_GETFL, 0);
+    return flags >= 0 && fcntl(_handle, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+} // namespace Krafter
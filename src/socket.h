@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Krafter
+{
+
+// A non-blocking IPv4 socket, either a TCP stream or a UDP one.
+class Socket
+{
+public:
+    struct Address
+    {
+        // In host byte order.
+        uint32_t host;
+        uint16_t port;
+
+        inline bool operator==(const Address&) const = default;
+    };
+
+    static constexpr uint32_t LOOPBACK = 0x7F000001;
+
+    // A TCP socket accepting connections on the port, any if it is 0.
+    static Socket Listen(uint16_t port);
+    // Connects over TCP, waiting until the connection is established.
+    static Socket Connect(const Address& address);
+    // A UDP socket receiving on the port, any if it is 0.
+    static Socket Bind(uint16_t port);
+
+    Socket();
+    ~Socket();
+
+    Socket(Socket&& other);
+    Socket& operator=(Socket&& other);
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    inline bool IsValid() const { return _handle != INVALID_HANDLE; }
+    Address GetLocalAddress() const;
+
+    // Returns an invalid socket if no connection is waiting.
+    Socket Accept();
+
+    // Both return how many bytes went through, 0 if the socket is not
+    // ready, and -1 once the connection is closed or broken.
+    int64_t Send(const void* data, size_t size);
+    int64_t Receive(void* data, size_t size);
+
+    bool SendTo(const void* data, size_t size, const Address& address);
+    // Returns the size of the datagram, or 0 if there is none.
+    size_t ReceiveFrom(void* data, size_t size, Address& address);
+
+private:
+    static constexpr intptr_t INVALID_HANDLE = -1;
+
+    static Socket Create(int32_t type);
+
+    explicit Socket(intptr_t handle);
+
+    void Close();
+    void SetNoDelay();
+    bool SetNonBlocking();
+
+    intptr_t _handle;
+};
+
+} // namespace Krafter
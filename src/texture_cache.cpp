@@ -0,0 +1,373 @@
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <limits>
+#include <utility>
+#include <cstring>
+
+#include "stb_image.h"
+
+#include "texture_cache.h"
+
+namespace Krafter
+{
+
+uint64_t TextureArrayImage::GetSourceStamp(std::string_view path)
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return 0;
+    }
+
+    return (uint64_t)time.time_since_epoch().count() ^ ((uint64_t)size << 32);
+}
+
+std::optional<TextureArrayImage> TextureArrayImage::LoadFromCache(std::string_view cachePath, uint64_t sourceStamp)
+{
+    std::ifstream file = std::ifstream(cachePath.data(), std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    std::streamsize size = file.tellg();
+    if (size < (std::streamsize)sizeof(Header))
+    {
+        return std::nullopt;
+    }
+
+    TextureArrayImage image;
+    image._data.resize(size);
+    file.seekg(0, std::ios::beg);
+    file.read((char*)image._data.data(), size);
+
+    const Header& header = image.GetHeader();
+    if (!file || header.magic != MAGIC || header.version != VERSION || header.sourceStamp != sourceStamp)
+    {
+        return std::nullopt;
+    }
+
+    size_t expectedSize = sizeof(Header);
+    for (uint32_t level = 0; level < header.mipLevelCount; level++)
+    {
+        glm::ivec2 mipSize = GetMipSize(image.GetTileSize(), level);
+        expectedSize += GetMipByteSize(mipSize, header.layerCount, header.compressed);
+    }
+    if (expectedSize != (size_t)size)
+    {
+        return std::nullopt;
+    }
+
+    return image;
+}
+
+std::optional<TextureArrayImage> TextureArrayImage::LoadFromAtlas(std::string_view atlasPath, uint32_t tilesPerRow,
+    bool compress, uint64_t sourceStamp)
+{
+    stbi_set_flip_vertically_on_load(true);
+
+    glm::ivec2 size;
+    int32_t channels_in_file;
+    uint8_t* atlas = stbi_load(atlasPath.data(), &size.x, &size.y, &channels_in_file, 4);
+    if (!atlas)
+    {
+        std::cerr << "[FILE] Could not read " << atlasPath << std::endl;
+        return std::nullopt;
+    }
+
+    const glm::ivec2 tileSize = size / (int32_t)tilesPerRow;
+    const uint32_t layerCount = tilesPerRow * tilesPerRow;
+    const uint32_t mipLevelCount = (uint32_t)glm::log2((float)glm::max(tileSize.x, tileSize.y)) + 1;
+
+    Header header = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .sourceStamp = sourceStamp,
+        .compressed = compress,
+        .tileWidth = tileSize.x,
+        .tileHeight = tileSize.y,
+        .layerCount = layerCount,
+        .mipLevelCount = mipLevelCount,
+        .padding = 0
+    };
+
+    TextureArrayImage image;
+    image._data.resize(sizeof(Header));
+    std::memcpy(image._data.data(), &header, sizeof(Header));
+
+    // The uncompressed mip chain of every layer, each level a box filtered
+    // copy of the previous one.
+    std::vector<std::vector<glm::u8vec4>> levels(mipLevelCount);
+    levels[0].resize((size_t)tileSize.x * tileSize.y * layerCount);
+    for (uint32_t layer = 0; layer < layerCount; layer++)
+    {
+        glm::ivec2 tile = glm::ivec2(layer % tilesPerRow, layer / tilesPerRow) * tileSize;
+        for (int32_t y = 0; y < tileSize.y; y++)
+        {
+            std::memcpy(&levels[0][((size_t)layer * tileSize.y + y) * tileSize.x],
+                atlas + ((size_t)(tile.y + y) * size.x + tile.x) * 4, (size_t)tileSize.x * 4);
+        }
+    }
+
+    stbi_image_free(atlas);
+
+    for (uint32_t level = 1; level < mipLevelCount; level++)
+    {
+        glm::ivec2 source = GetMipSize(tileSize, level - 1);
+        glm::ivec2 target = GetMipSize(tileSize, level);
+        levels[level].resize((size_t)target.x * target.y * layerCount);
+
+        for (uint32_t layer = 0; layer < layerCount; layer++)
+        {
+            const glm::u8vec4* sourceLayer = &levels[level - 1][(size_t)layer * source.x * source.y];
+            glm::u8vec4* targetLayer = &levels[level][(size_t)layer * target.x * target.y];
+
+            for (int32_t y = 0; y < target.y; y++)
+            {
+                for (int32_t x = 0; x < target.x; x++)
+                {
+                    glm::uvec4 sum = glm::uvec4(0);
+                    for (int32_t k = 0; k < 4; k++)
+                    {
+                        int32_t sx = glm::min(x * 2 + (k & 1), source.x - 1);
+                        int32_t sy = glm::min(y * 2 + (k >> 1), source.y - 1);
+                        sum += glm::uvec4(sourceLayer[sy * source.x + sx]);
+                    }
+                    targetLayer[y * target.x + x] = glm::u8vec4((sum + 2u) / 4u);
+                }
+            }
+        }
+    }
+
+    for (uint32_t level = 0; level < mipLevelCount; level++)
+    {
+        glm::ivec2 mipSize = GetMipSize(tileSize, level);
+        size_t offset = image._data.size();
+        image._data.resize(offset + GetMipByteSize(mipSize, layerCount, compress));
+
+        if (!compress)
+        {
+            std::memcpy(image._data.data() + offset, levels[level].data(), levels[level].size() * 4);
+            continue;
+        }
+
+        // BC7 works on 4x4 blocks; levels smaller than a block replicate
+        // their edge texels into the unused part of it.
+        uint8_t* block = image._data.data() + offset;
+        for (uint32_t layer = 0; layer < layerCount; layer++)
+        {
+            const glm::u8vec4* layerPixels = &levels[level][(size_t)layer * mipSize.x * mipSize.y];
+            for (int32_t by = 0; by < mipSize.y; by += 4)
+            {
+                for (int32_t bx = 0; bx < mipSize.x; bx += 4)
+                {
+                    glm::u8vec4 pixels[16];
+                    for (int32_t k = 0; k < 16; k++)
+                    {
+                        int32_t x = glm::min(bx + (k & 3), mipSize.x - 1);
+                        int32_t y = glm::min(by + (k >> 2), mipSize.y - 1);
+                        pixels[k] = layerPixels[y * mipSize.x + x];
+                    }
+
+                    EncodeBlockBc7(pixels, block);
+                    block += 16;
+                }
+            }
+        }
+    }
+
+    return image;
+}
+
+bool TextureArrayImage::SaveToCache(std::string_view cachePath) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    std::ofstream file = std::ofstream(cachePath.data(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "[FILE] Could not write " << cachePath << std::endl;
+        return false;
+    }
+
+    file.write((const char*)_data.data(), _data.size());
+    return (bool)file;
+}
+
+TextureArrayImage::MipLevel TextureArrayImage::GetMipLevel(uint32_t level) const
+{
+    const Header& header = GetHeader();
+
+    size_t offset = sizeof(Header);
+    for (uint32_t i = 0; i < level; i++)
+    {
+        offset += GetMipByteSize(GetMipSize(GetTileSize(), i), header.layerCount, header.compressed);
+    }
+
+    glm::ivec2 size = GetMipSize(GetTileSize(), level);
+    return {
+        .size = size,
+        .data = _data.data() + offset,
+        .byteSize = GetMipByteSize(size, header.layerCount, header.compressed)
+    };
+}
+
+glm::ivec2 TextureArrayImage::GetMipSize(const glm::ivec2& tileSize, uint32_t level)
+{
+    return glm::max(tileSize >> glm::ivec2(level), glm::ivec2(1));
+}
+
+size_t TextureArrayImage::GetMipByteSize(const glm::ivec2& size, uint32_t layerCount, bool compressed)
+{
+    if (compressed)
+    {
+        return (size_t)((size.x + 3) / 4) * ((size.y + 3) / 4) * 16 * layerCount;
+    }
+
+    return (size_t)size.x * size.y * 4 * layerCount;
+}
+
+void TextureArrayImage::EncodeBlockBc7(const glm::u8vec4* pixels, uint8_t* block)
+{
+    // Mode 6: a single RGBA line with 7-bit endpoints, a p-bit per endpoint
+    // and 4-bit indices. The line follows the principal axis of the block.
+    constexpr uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    glm::vec4 mean = glm::vec4(0.0f);
+    for (int32_t i = 0; i < 16; i++)
+    {
+        mean += glm::vec4(pixels[i]);
+    }
+    mean /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (int32_t i = 0; i < 16; i++)
+    {
+        glm::vec4 d = glm::vec4(pixels[i]) - mean;
+        for (int32_t r = 0; r < 4; r++)
+        {
+            for (int32_t c = 0; c < 4; c++)
+            {
+                covariance[r][c] += d[r] * d[c];
+            }
+        }
+    }
+
+    glm::vec4 axis = glm::vec4(1.0f);
+    for (int32_t iteration = 0; iteration < 8; iteration++)
+    {
+        glm::vec4 next = glm::vec4(0.0f);
+        for (int32_t r = 0; r < 4; r++)
+        {
+            for (int32_t c = 0; c < 4; c++)
+            {
+                next[r] += covariance[r][c] * axis[c];
+            }
+        }
+
+        float length = glm::length(next);
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        axis = next / length;
+    }
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (int32_t i = 0; i < 16; i++)
+    {
+        float t = glm::dot(glm::vec4(pixels[i]) - mean, axis);
+        minT = glm::min(minT, t);
+        maxT = glm::max(maxT, t);
+    }
+
+    // Quantizes both endpoints to 7 bits plus the p-bit that fits best.
+    glm::ivec4 endpoints[2];
+    uint32_t pBits[2];
+    const glm::vec4 targets[2] = {
+        glm::clamp(mean + axis * minT, 0.0f, 255.0f),
+        glm::clamp(mean + axis * maxT, 0.0f, 255.0f)
+    };
+    for (int32_t e = 0; e < 2; e++)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t p = 0; p < 2; p++)
+        {
+            glm::ivec4 quantized = glm::clamp(glm::ivec4(glm::round((targets[e] - (float)p) / 2.0f)), 0, 127);
+            glm::vec4 d = glm::vec4((quantized << 1) | glm::ivec4(p)) - targets[e];
+            float error = glm::dot(d, d);
+            if (error < bestError)
+            {
+                bestError = error;
+                endpoints[e] = quantized;
+                pBits[e] = p;
+            }
+        }
+    }
+
+    glm::ivec4 palette[16];
+    glm::ivec4 e0 = (endpoints[0] << 1) | glm::ivec4(pBits[0]);
+    glm::ivec4 e1 = (endpoints[1] << 1) | glm::ivec4(pBits[1]);
+    for (int32_t i = 0; i < 16; i++)
+    {
+        palette[i] = ((64 - (int32_t)weights[i]) * e0 + (int32_t)weights[i] * e1 + 32) >> 6;
+    }
+
+    uint32_t indices[16];
+    for (int32_t i = 0; i < 16; i++)
+    {
+        int32_t bestError = std::numeric_limits<int32_t>::max();
+        for (uint32_t j = 0; j < 16; j++)
+        {
+            glm::ivec4 d = palette[j] - glm::ivec4(pixels[i]);
+            int32_t error = d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+    }
+
+    // The most significant bit of the first index is implicitly zero.
+    if (indices[0] & 8)
+    {
+        std::swap(endpoints[0], endpoints[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint32_t& index : indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    std::memset(block, 0, 16);
+    uint32_t bit = 0;
+    auto write = [&](uint32_t value, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++, bit++)
+        {
+            block[bit / 8] |= ((value >> i) & 1) << (bit % 8);
+        }
+    };
+
+    write(1 << 6, 7);
+    for (int32_t channel = 0; channel < 4; channel++)
+    {
+        write(endpoints[0][channel], 7);
+        write(endpoints[1][channel], 7);
+    }
+    write(pBits[0], 1);
+    write(pBits[1], 1);
+    write(indices[0], 3);
+    for (int32_t i = 1; i < 16; i++)
+    {
+        write(indices[i], 4);
+    }
+}
+
+} // namespace Krafter
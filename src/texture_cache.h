@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <type_traits>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+namespace Krafter
+{
+
+// A texture array with its whole mip chain already generated (and optionally
+// BC7-compressed), kept in memory exactly as it is laid out in the cache
+// file so that loading it back is a single read.
+class TextureArrayImage
+{
+public:
+    struct MipLevel
+    {
+        glm::ivec2 size;
+        const uint8_t* data;
+        size_t byteSize;
+    };
+
+    static uint64_t GetSourceStamp(std::string_view path);
+
+    static std::optional<TextureArrayImage> LoadFromCache(std::string_view cachePath, uint64_t sourceStamp);
+    static std::optional<TextureArrayImage> LoadFromAtlas(std::string_view atlasPath, uint32_t tilesPerRow,
+        bool compress, uint64_t sourceStamp);
+
+    bool SaveToCache(std::string_view cachePath) const;
+
+    inline bool IsCompressed() const { return GetHeader().compressed; }
+    inline glm::ivec2 GetTileSize() const { return glm::ivec2(GetHeader().tileWidth, GetHeader().tileHeight); }
+    inline uint32_t GetLayerCount() const { return GetHeader().layerCount; }
+    inline uint32_t GetMipLevelCount() const { return GetHeader().mipLevelCount; }
+
+    MipLevel GetMipLevel(uint32_t level) const;
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceStamp;
+        uint32_t compressed;
+        int32_t tileWidth;
+        int32_t tileHeight;
+        uint32_t layerCount;
+        uint32_t mipLevelCount;
+        // Spelled out, so no uninitialized bytes end up in the file.
+        uint32_t padding;
+    };
+    static_assert(std::has_unique_object_representations_v<Header>);
+
+    static constexpr uint32_t MAGIC = 0x4154524B; // "KRTA"
+    static constexpr uint32_t VERSION = 1;
+
+    static glm::ivec2 GetMipSize(const glm::ivec2& tileSize, uint32_t level);
+    static size_t GetMipByteSize(const glm::ivec2& size, uint32_t layerCount, bool compressed);
+    static void EncodeBlockBc7(const glm::u8vec4* pixels, uint8_t* block);
+
+    inline const Header& GetHeader() const { return *reinterpret_cast<const Header*>(_data.data()); }
+
+    std::vector<uint8_t> _data;
+};
+
+} // namespace Krafter
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "thread_pool.h"
+
+namespace Krafter
+{
+
+void ThreadPool::Init()
+{
+    _instance = new ThreadPool();
+}
+
+void ThreadPool::Deinit()
+{
+    delete _instance;
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_mutex);
+        _jobs.push(std::move(job));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& function)
+{
+    const size_t batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount <= 1)
+    {
+        if (count > 0)
+        {
+            function(0, count);
+        }
+        return;
+    }
+
+    // Workers that only start after every batch was taken still touch the
+    // state, so it outlives this call.
+    struct State
+    {
+        std::atomic<size_t> nextBatch;
+        std::atomic<size_t> remainingBatches;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->nextBatch = 0;
+    state->remainingBatches = batchCount;
+
+    auto runBatches = [state, count, batchSize, batchCount, &function]
+    {
+        for (size_t batch = state->nextBatch++; batch < batchCount; batch = state->nextBatch++)
+        {
+            function(batch * batchSize, std::min(count, (batch + 1) * batchSize));
+            if (--state->remainingBatches == 0)
+            {
+                std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(state->mutex);
+                state->condition.notify_one();
+            }
+        }
+    };
+
+    const size_t helperCount = std::min<size_t>(_threads.size(), batchCount - 1);
+    for (size_t i = 0; i < helperCount; i++)
+    {
+        Submit(runBatches);
+    }
+    runBatches();
+
+    std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(state->mutex);
+    state->condition.wait(lock, [&] { return state->remainingBatches == 0; });
+}
+
+void ThreadPool::RunWorker()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(_mutex);
+            _condition.wait(lock, [this] { return _isStopping || !_jobs.empty(); });
+            if (_isStopping)
+            {
+                return;
+            }
+
+            job = std::move(_jobs.front());
+            _jobs.pop();
+        }
+
+        job();
+    }
+}
+
+ThreadPool::ThreadPool()
+    : _isStopping(false)
+{
+    // One core is left to the main thread.
+    uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        _threads.emplace_back(&ThreadPool::RunWorker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    // Jobs that have not started yet are dropped, running ones finish.
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_mutex);
+        _isStopping = true;
+    }
+    _condition.notify_all();
+
+    for (std::thread& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+} // namespace Krafter
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+namespace Krafter
+{
+
+class ThreadPool
+{
+public:
+    static void Init();
+    static void Deinit();
+    inline static ThreadPool* Get() { return _instance; }
+
+    void Submit(std::function<void()> job);
+
+    // Calls the function for [0, count) in batches, on the workers and the
+    // calling thread alike, and returns once all of them are done. Batches
+    // that busy workers do not get to are run by the caller, so it never
+    // waits behind unrelated jobs.
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& function);
+
+    inline uint32_t GetThreadCount() const { return _threads.size(); }
+
+private:
+    inline static ThreadPool* _instance;
+
+    ThreadPool();
+    ~ThreadPool();
+
+    void RunWorker();
+
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::queue<std::function<void()>> _jobs;
+    bool _isStopping;
+};
+
+} // namespace Krafter
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+
+namespace Krafter
+{
+
+class Timer
+{
+public:
+    // Seconds on the monotonic clock; comparable between threads, unlike
+    // the elapsed time of a single timer.
+    static inline double GetTime()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Timer() : _start(std::chrono::steady_clock::now()) {}
+
+    inline void Reset() { _start = std::chrono::steady_clock::now(); }
+
+    inline double GetElapsedSeconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+    inline double GetElapsedMilliseconds() const { return GetElapsedSeconds() * 1000.0; }
+
+private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace Krafter
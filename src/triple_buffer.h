@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Krafter
+{
+
+// Hands the latest value from one writing thread to one reading thread
+// without locks. Each side owns one of the three buffers and the third is
+// swapped between them atomically.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : _shared(1), _writeIndex(0), _readIndex(2) {}
+
+    // The writer fills the whole buffer and then publishes it, the buffer
+    // it gets back holds an older value.
+    inline T& GetWriteBuffer() { return _buffers[_writeIndex]; }
+
+    inline void Publish()
+    {
+        _writeIndex = _shared.exchange(_writeIndex | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Returns the latest published value, or the one read last time if
+    // nothing new was published since.
+    inline const T& Read()
+    {
+        if (_shared.load(std::memory_order_relaxed) & DIRTY)
+        {
+            _readIndex = _shared.exchange(_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return _buffers[_readIndex];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 3;
+    static constexpr uint8_t DIRTY = 4;
+
+    std::array<T, 3> _buffers;
+    std::atomic<uint8_t> _shared;
+    uint8_t _writeIndex;
+    uint8_t _readIndex;
+};
+
+} // namespace Krafter
@@ -1,15 +1,26 @@
+#include <iterator>
+#include <vector>
+#include <iostream>
+
 #include "glad/gl.h"
 #include "GLFW/glfw3.h"
 
+#ifdef KRAFTER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "timer.h"
+#include "png_writer.h"
 #include "renderer.h"
 #include "window.h"
 
 namespace Krafter
 {
 
-void Window::Init()
+void Window::Init(WindowMode mode)
 {
-    _instance = new Window();
+    _instance = new Window(mode);
 }
 
 void Window::Deinit()
@@ -19,75 +30,325 @@ void Window::Deinit()
 
 bool Window::IsOpen() const
 {
-    return !glfwWindowShouldClose(_id);
+    return _isHeadless ? !_isClosed : !glfwWindowShouldClose(_id);
 }
 
-void Window::Close() const
+void Window::Close()
 {
+    if (_isHeadless)
+    {
+        _isClosed = true;
+        return;
+    }
     glfwSetWindowShouldClose(_id, GLFW_TRUE);
 }
 
 void Window::PollEvents() const
 {
-    glfwPollEvents();
+    if (!_isHeadless)
+    {
+        glfwPollEvents();
+    }
+}
+
+void Window::SetContextCurrent(bool isCurrent) const
+{
+    if (_isHeadless)
+    {
+#ifdef KRAFTER_EGL
+        eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, isCurrent ? _context : EGL_NO_CONTEXT);
+#endif
+        return;
+    }
+    glfwMakeContextCurrent(isCurrent ? _id : nullptr);
 }
 
 void Window::SwapBuffers() const
 {
+    // Headless, nothing is shown, but the frame is still sent off.
+    if (_isHeadless)
+    {
+        glFlush();
+        return;
+    }
     glfwSwapBuffers(_id);
 }
 
-float Window::GetTime() const
+void Window::SetVsync(VsyncMode mode)
+{
+    _vsyncMode = mode;
+    if (_isHeadless)
+    {
+        return;
+    }
+
+    // A negative interval is adaptive, where the swap control tear
+    // extension is there.
+    const bool isAdaptive = mode == VsyncMode::ADAPTIVE &&
+        (glfwExtensionSupported("GLX_EXT_swap_control_tear") || glfwExtensionSupported("WGL_EXT_swap_control_tear"));
+    glfwSwapInterval(mode == VsyncMode::OFF ? 0 : (isAdaptive ? -1 : 1));
+}
+
+double Window::GetTime() const
 {
-    return glfwGetTime();
+    return _isHeadless ? Timer::GetTime() : glfwGetTime();
 }
 
 bool Window::IsKeyDown(Key key) const
 {
-    return glfwGetKey(_id, (int)key) == GLFW_PRESS;
+    if (_inputOverride)
+    {
+        return _inputOverride->buttons & GetBit(key);
+    }
+    return !_isHeadless && glfwGetKey(_id, (int)key) == GLFW_PRESS;
+}
+
+bool Window::IsMouseButtonDown(MouseButton button) const
+{
+    if (_inputOverride)
+    {
+        return _inputOverride->buttons & GetBit(button);
+    }
+    return !_isHeadless && glfwGetMouseButton(_id, (int)button) == GLFW_PRESS;
 }
 
 void Window::EnableCursor(bool state) const
 {
+    if (_isHeadless)
+    {
+        return;
+    }
     glfwSetInputMode(_id, GLFW_CURSOR, state ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
 }
 
 glm::vec2 Window::GetCursorPosition() const
 {
+    if (_inputOverride)
+    {
+        return _inputOverride->cursorPosition;
+    }
+    if (_isHeadless)
+    {
+        return glm::vec2(0.0f);
+    }
+
     double x;
     double y;
     glfwGetCursorPos(_id, &x, &y);
     return glm::vec2(x, y);
 }
 
+WindowInput Window::GetInput() const
+{
+    WindowInput input = { .buttons = 0, .cursorPosition = glm::vec2(0.0f) };
+    if (_isHeadless)
+    {
+        return input;
+    }
+
+    for (Key key : KEYS)
+    {
+        input.buttons |= glfwGetKey(_id, (int)key) == GLFW_PRESS ? GetBit(key) : 0;
+    }
+    for (MouseButton button : MOUSE_BUTTONS)
+    {
+        input.buttons |= glfwGetMouseButton(_id, (int)button) == GLFW_PRESS ? GetBit(button) : 0;
+    }
+
+    double x;
+    double y;
+    glfwGetCursorPos(_id, &x, &y);
+    input.cursorPosition = glm::vec2(x, y);
+    return input;
+}
+
+bool Window::Capture(const std::string& path, const glm::uvec2& size) const
+{
+    std::vector<uint8_t> pixels = std::vector<uint8_t>((size_t)size.x * size.y * 4);
+    glReadBuffer(_isHeadless ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    // OpenGL reads from the bottom up, PNG from the top down.
+    const size_t stride = (size_t)size.x * 4;
+    std::vector<uint8_t> row = std::vector<uint8_t>(stride);
+    for (uint32_t y = 0; y < size.y / 2; y++)
+    {
+        uint8_t* top = pixels.data() + y * stride;
+        uint8_t* bottom = pixels.data() + (size.y - 1 - y) * stride;
+        std::copy(top, top + stride, row.data());
+        std::copy(bottom, bottom + stride, top);
+        std::copy(row.data(), row.data() + stride, bottom);
+    }
+    // Whatever was left in alpha by blending would show through.
+    for (size_t i = 3; i < pixels.size(); i += 4)
+    {
+        pixels[i] = 255;
+    }
+
+    if (!PngWriter::Write(path, size.x, size.y, pixels.data()))
+    {
+        std::cerr << "[FILE] Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint16_t Window::GetBit(Key key)
+{
+    for (size_t i = 0; i < std::size(KEYS); i++)
+    {
+        if (KEYS[i] == key)
+        {
+            return 1 << i;
+        }
+    }
+    return 0;
+}
+
+uint16_t Window::GetBit(MouseButton button)
+{
+    return 1 << (std::size(KEYS) + (size_t)button);
+}
+
 void Window::FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
     Window* win = Window::Get();
     win->_size.x = width;
     win->_size.y = height;
 
-    glViewport(0, 0, win->GetSize().x, win->GetSize().y);
-
+    // The renderer picks the new size up with the next frame it records.
     Renderer::Get()->GetCamera().UpdateProjection();
 }
 
-Window::Window()
-    : _size(1280, 720)
+bool Window::CreateHeadlessContext()
 {
+#ifdef KRAFTER_EGL
+    // Mesa renders without any display through its surfaceless platform,
+    // on llvmpipe if there is no GPU; other drivers may still offer a
+    // default display.
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY)
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    {
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+    if (configCount == 0)
+    {
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = EGL_NO_CONTEXT;
+    if (eglBindAPI(EGL_OPENGL_API))
+    {
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    }
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        if (context != EGL_NO_CONTEXT)
+        {
+            eglDestroyContext(display, context);
+        }
+        eglTerminate(display);
+        return false;
+    }
+
+    _display = display;
+    _context = context;
+    gladLoadGL(eglGetProcAddress);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Window::CreateFramebuffer()
+{
+    glCreateRenderbuffers(1, &_colorBuffer);
+    glNamedRenderbufferStorage(_colorBuffer, GL_RGBA8, _size.x, _size.y);
+    glCreateRenderbuffers(1, &_depthBuffer);
+    glNamedRenderbufferStorage(_depthBuffer, GL_DEPTH24_STENCIL8, _size.x, _size.y);
+
+    glCreateFramebuffers(1, &_framebuffer);
+    glNamedFramebufferRenderbuffer(_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    glNamedFramebufferRenderbuffer(_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+
+    // Rendering goes here unless the renderer draws a scaled down scene into
+    // its own targets first, which it binds this one again after.
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, _size.x, _size.y);
+}
+
+Window::Window(WindowMode mode)
+    : _id(nullptr), _size(1280, 720), _vsyncMode(VsyncMode::ON), _isHeadless(false), _isClosed(false), _display(nullptr), _context(nullptr),
+    _framebuffer(0), _colorBuffer(0), _depthBuffer(0)
+{
+    if (mode == WindowMode::HEADLESS)
+    {
+        if (CreateHeadlessContext())
+        {
+            _isHeadless = true;
+            CreateFramebuffer();
+            return;
+        }
+        std::cerr << "[WINDOW] Could not render headless, opening a hidden window instead" << std::endl;
+        mode = WindowMode::HIDDEN;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, mode == WindowMode::HIDDEN ? GLFW_FALSE : GLFW_TRUE);
     _id = glfwCreateWindow(_size.x, _size.y, "Krafter", nullptr, nullptr);
     glfwMakeContextCurrent(_id);
+    gladLoadGL(glfwGetProcAddress);
 
     glfwSetFramebufferSizeCallback(_id, FramebufferSizeCallback);
 
+    // Whatever the driver would default to otherwise.
+    SetVsync(VsyncMode::ON);
     EnableCursor(false);
 }
 
 Window::~Window()
 {
+    if (_isHeadless)
+    {
+        glDeleteFramebuffers(1, &_framebuffer);
+        glDeleteRenderbuffers(1, &_colorBuffer);
+        glDeleteRenderbuffers(1, &_depthBuffer);
+#ifdef KRAFTER_EGL
+        eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(_display, _context);
+        eglTerminate(_display);
+#endif
+        return;
+    }
+
     glfwDestroyWindow(_id);
     glfwTerminate();
 }
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <string>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+
 #include "glm/glm.hpp"
 
 typedef struct GLFWwindow GLFWwindow;
@@ -16,29 +21,91 @@ enum class Key : int
     S = 83,
     D = 68,
     A = 65,
+    E = 69,
+    F = 70,
+};
+
+enum class MouseButton : int
+{
+    LEFT = 0,
+    RIGHT = 1,
+};
+
+enum class WindowMode
+{
+    VISIBLE,
+    // Still needs a display, but nothing shows up on it.
+    HIDDEN,
+    // Renders into an offscreen framebuffer through EGL, without a display
+    // or even a GPU, where built with EGL. There is no input then.
+    HEADLESS
+};
+
+enum class VsyncMode : int
+{
+    OFF,
+    ON,
+    // Waits for the refresh unless the frame is already late, then tears
+    // rather than waiting for the next one. Same as ON where the driver
+    // does not support it.
+    ADAPTIVE
+};
+
+// Every key and button the game reads, and where the cursor is.
+struct WindowInput
+{
+    // Bit i for Window::KEYS[i], then one bit per mouse button.
+    uint16_t buttons;
+    glm::vec2 cursorPosition;
 };
 
 class Window
 {
 public:
-    static void Init();
+    static constexpr Key KEYS[] = { Key::ESCAPE, Key::SPACE, Key::W, Key::S, Key::D, Key::A, Key::E, Key::F };
+    static constexpr MouseButton MOUSE_BUTTONS[] = { MouseButton::LEFT, MouseButton::RIGHT };
+
+    // Falls back to a hidden window if headless rendering is not available.
+    static void Init(WindowMode mode = WindowMode::VISIBLE);
     static void Deinit();
     inline static Window* Get() { return _instance; }
 
     bool IsOpen() const;
-    void Close() const;
+    void Close();
 
     void PollEvents() const;
+    // The GL context can only be current on one thread at a time; the
+    // render thread takes it over from the one that opened the window.
+    void SetContextCurrent(bool isCurrent) const;
+    // With the context current, like the rest of GL.
     void SwapBuffers() const;
+    void SetVsync(VsyncMode mode);
+    inline VsyncMode GetVsync() const { return _vsyncMode; }
 
-    float GetTime() const;
+    double GetTime() const;
 
     bool IsKeyDown(Key key) const;
+    bool IsMouseButtonDown(MouseButton button) const;
 
     void EnableCursor(bool state) const;
     glm::vec2 GetCursorPosition() const;
 
+    // Samples the devices, whatever the override.
+    WindowInput GetInput() const;
+    // While set, the keys, buttons and cursor are read from the override
+    // instead of the devices, to play a recording back.
+    inline void SetInputOverride(const std::optional<WindowInput>& input) { _inputOverride = input; }
+
+    // Writes what has been rendered into the back buffer so far to a PNG
+    // file, so before swapping. The size is the window's when the frame was
+    // recorded.
+    bool Capture(const std::string& path, const glm::uvec2& size) const;
+
+    // Null when headless.
     inline WindowId GetId() const { return _id; }
+    inline bool IsHeadless() const { return _isHeadless; }
+    // What ends up on screen or captured; 0 unless headless.
+    inline uint32_t GetFramebuffer() const { return _framebuffer; }
     inline const glm::uvec2& GetSize() const { return _size; }
 
 private:
@@ -46,11 +113,32 @@ private:
 
     inline static Window* _instance;
 
-    Window();
+    Window(WindowMode mode);
     ~Window();
 
+    // Returns false if there is no EGL or it could not make a context.
+    bool CreateHeadlessContext();
+    void CreateFramebuffer();
+
+    // Returns the bit of the key or button in WindowInput::buttons.
+    static uint16_t GetBit(Key key);
+    static uint16_t GetBit(MouseButton button);
+
     WindowId _id;
     glm::uvec2 _size;
+    std::optional<WindowInput> _inputOverride;
+    // Set on the render thread, shown on the game thread.
+    std::atomic<VsyncMode> _vsyncMode;
+
+    // Headless, EGL's display and context, and the framebuffer rendered
+    // into in place of a window.
+    bool _isHeadless;
+    bool _isClosed;
+    void* _display;
+    void* _context;
+    uint32_t _framebuffer;
+    uint32_t _colorBuffer;
+    uint32_t _depthBuffer;
 };
 
 } // namespace Krafter
@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstring>
+
+#include "thread_pool.h"
+#include "timer.h"
+#include "chunk_codec.h"
+#include "world.h"
+
+namespace Krafter
+{
+
+void World::Init()
+{
+    _instance = new World();
+}
+
+void World::Deinit()
+{
+    delete _instance;
+}
+
+glm::ivec2 World::GetChunkCoords(const glm::ivec3& position)
+{
+    // Rounds towards negative infinity so that negative positions land in
+    // the right chunk.
+    auto floorDiv = [](int32_t a, int32_t b) { return (a >= 0 ? a : a - b + 1) / b; };
+    return glm::ivec2(floorDiv(position.x, Chunk::WIDTH), floorDiv(position.z, Chunk::WIDTH));
+}
+
+uint64_t World::GetChunkKey(const glm::ivec2& chunkCoords)
+{
+    return ((uint64_t)(uint32_t)chunkCoords.x << 32) | (uint32_t)chunkCoords.y;
+}
+
+void World::Update(std::span<const glm::vec3> centers)
+{
+    {
+        std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_generatedChunksMutex);
+        for (std::shared_ptr<Chunk>& chunk : _generatedChunks)
+        {
+            _pendingChunks.erase(GetChunkKey(chunk->GetPosition() / (int32_t)Chunk::WIDTH));
+            AddChunk(std::move(chunk));
+            _generatedChunkCount++;
+        }
+        _generatedChunks.clear();
+    }
+
+    std::vector<glm::ivec2> centerCoords;
+    for (const glm::vec3& center : centers)
+    {
+        centerCoords.push_back(GetChunkCoords(glm::ivec3(glm::floor(center))));
+    }
+    const int32_t viewDistance = _viewDistance;
+
+    // Chunks are kept a little past the view distance, so moving back and
+    // forth over a chunk border does not regenerate them. Without any
+    // centers, like on a server nobody joined yet, they are all kept for
+    // whoever comes next.
+    if (!centerCoords.empty())
+    {
+        std::erase_if(_chunks, [&](const auto& item)
+        {
+            for (const glm::ivec2& coords : centerCoords)
+            {
+                glm::ivec2 offset = item.second->GetPosition() / (int32_t)Chunk::WIDTH - coords;
+                if (glm::max(glm::abs(offset.x), glm::abs(offset.y)) <= viewDistance + 1)
+                {
+                    return false;
+                }
+            }
+
+            if (_modifiedChunks.erase(item.first))
+            {
+                SaveChunk(*item.second);
+            }
+            return true;
+        });
+    }
+    _loadedChunkCount = _chunks.size();
+
+    // Only a few chunks are queued at a time, so the nearest ones are always
+    // generated first even while the camera keeps moving.
+    const size_t maxPendingChunks = ThreadPool::Get()->GetThreadCount() * 2;
+    _pendingChunkCount = _pendingChunks.size();
+    if (_pendingChunks.size() >= maxPendingChunks)
+    {
+        return;
+    }
+
+    // Each missing chunk with its squared distance to the nearest center.
+    std::unordered_map<uint64_t, std::pair<glm::ivec2, int32_t>> missingChunks;
+    for (const glm::ivec2& coords : centerCoords)
+    {
+        for (int32_t x = -viewDistance; x <= viewDistance; x++)
+        {
+            for (int32_t z = -viewDistance; z <= viewDistance; z++)
+            {
+                glm::ivec2 chunkCoords = coords + glm::ivec2(x, z);
+                uint64_t key = GetChunkKey(chunkCoords);
+                int32_t distance = x * x + z * z;
+                if (distance > viewDistance * viewDistance || _chunks.contains(key) || _pendingChunks.contains(key))
+                {
+                    continue;
+                }
+
+                auto [it, isNew] = missingChunks.try_emplace(key, chunkCoords, distance);
+                it->second.second = glm::min(it->second.second, distance);
+            }
+        }
+    }
+
+    std::vector<std::pair<glm::ivec2, int32_t>> sortedChunks;
+    sortedChunks.reserve(missingChunks.size());
+    for (const auto& [key, chunk] : missingChunks)
+    {
+        sortedChunks.push_back(chunk);
+    }
+    std::sort(sortedChunks.begin(), sortedChunks.end(), [](const auto& a, const auto& b)
+    {
+        return a.second < b.second;
+    });
+
+    for (const auto& [chunkCoords, distance] : sortedChunks)
+    {
+        if (_pendingChunks.size() >= maxPendingChunks)
+        {
+            break;
+        }
+
+        _pendingChunks.insert(GetChunkKey(chunkCoords));
+        ThreadPool::Get()->Submit([this, chunkCoords]
+        {
+            std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(chunkCoords * (int32_t)Chunk::WIDTH);
+            LoadSavedBlocks(*chunk);
+            LightEngine::LightChunk(*chunk);
+
+            std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(_generatedChunksMutex);
+            _generatedChunks.push_back(std::move(chunk));
+        });
+    }
+    _pendingChunkCount = _pendingChunks.size();
+}
+
+void World::LoadChunk(const glm::ivec2& chunkCoords)
+{
+    std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(chunkCoords * (int32_t)Chunk::WIDTH);
+    LoadSavedBlocks(*chunk);
+    LightEngine::LightChunk(*chunk);
+    AddChunk(std::move(chunk));
+}
+
+std::shared_ptr<const Chunk> World::GetChunk(const glm::ivec2& chunkCoords) const
+{
+    auto it = _chunks.find(GetChunkKey(chunkCoords));
+    return it != _chunks.end() ? it->second : nullptr;
+}
+
+Block World::GetBlock(const glm::ivec3& position) const
+{
+    if (position.y < 0 || position.y >= Chunk::HEIGHT)
+    {
+        return Block::AIR;
+    }
+
+    glm::ivec2 chunkCoords = GetChunkCoords(position);
+    const Chunk* chunk = FindChunk(chunkCoords);
+    if (!chunk)
+    {
+        return Block::AIR;
+    }
+
+    return chunk->GetBlock(position - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH);
+}
+
+bool World::SetBlock(const glm::ivec3& position, Block block)
+{
+    if (position.y < 0 || position.y >= Chunk::HEIGHT)
+    {
+        return false;
+    }
+
+    glm::ivec2 chunkCoords = GetChunkCoords(position);
+    Chunk* chunk = FindChunk(chunkCoords);
+    if (!chunk)
+    {
+        return false;
+    }
+
+    glm::ivec3 coords = position - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH;
+    if (chunk->GetBlock(coords) == block)
+    {
+        return false;
+    }
+
+    chunk->SetBlock(coords, block);
+    MarkBorderChanged(position);
+    if (!_saveDirectory.empty())
+    {
+        _modifiedChunks.insert(GetChunkKey(chunkCoords));
+    }
+
+    Timer timer;
+    _lightEngine.UpdateBlock(position);
+    _lastRelightTime = timer.GetElapsedMilliseconds();
+
+    return true;
+}
+
+bool World::IsSolid(const glm::ivec3& position) const
+{
+    if (position.y < 0)
+    {
+        return true;
+    }
+    if (position.y >= Chunk::HEIGHT)
+    {
+        return false;
+    }
+
+    glm::ivec2 chunkCoords = GetChunkCoords(position);
+    const Chunk* chunk = FindChunk(chunkCoords);
+    if (!chunk)
+    {
+        return true;
+    }
+
+    Block block = chunk->GetBlock(position - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH);
+    return BlockInfo::GetInfoOf(block).isSolid;
+}
+
+std::optional<RaycastHit> World::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+    // Amanatides and Woo: step into whichever neighboring block the ray
+    // reaches first, tracking the distance to the next border per axis.
+    glm::ivec3 position = glm::ivec3(glm::floor(origin));
+    glm::ivec3 step;
+    glm::vec3 nextBorder;
+    glm::vec3 borderDistance;
+    for (int32_t i = 0; i < 3; i++)
+    {
+        if (direction[i] > 0.0f)
+        {
+            step[i] = 1;
+            borderDistance[i] = 1.0f / direction[i];
+            nextBorder[i] = (position[i] + 1.0f - origin[i]) / direction[i];
+        }
+        else if (direction[i] < 0.0f)
+        {
+            step[i] = -1;
+            borderDistance[i] = -1.0f / direction[i];
+            nextBorder[i] = (position[i] - origin[i]) / direction[i];
+        }
+        else
+        {
+            step[i] = 0;
+            borderDistance[i] = std::numeric_limits<float>::infinity();
+            nextBorder[i] = std::numeric_limits<float>::infinity();
+        }
+    }
+
+    // Entering a block across an axis means going through the face looking
+    // back against the step.
+    constexpr BlockFace enteredFaces[3][2] = {
+        { BlockFace::BACK, BlockFace::FRONT },
+        { BlockFace::TOP, BlockFace::BOTTOM },
+        { BlockFace::RIGHT, BlockFace::LEFT }
+    };
+
+    glm::ivec2 chunkCoords = GetChunkCoords(position);
+    const Chunk* chunk = FindChunk(chunkCoords);
+
+    BlockFace face = BlockFace::TOP;
+    float distance = 0.0f;
+    while (distance <= maxDistance)
+    {
+        if (position.y >= 0 && position.y < Chunk::HEIGHT)
+        {
+            glm::ivec2 coords = GetChunkCoords(position);
+            if (coords != chunkCoords)
+            {
+                chunkCoords = coords;
+                chunk = FindChunk(chunkCoords);
+            }
+
+            if (chunk)
+            {
+                Block block = chunk->GetBlock(position - glm::ivec3(chunkCoords.x, 0, chunkCoords.y) * (int32_t)Chunk::WIDTH);
+                if (BlockInfo::GetInfoOf(block).isSolid)
+                {
+                    return RaycastHit{ position, block, face, distance };
+                }
+            }
+        }
+        else if ((position.y < 0 && step.y <= 0) || (position.y >= Chunk::HEIGHT && step.y >= 0))
+        {
+            break;
+        }
+
+        int32_t axis = nextBorder.x < nextBorder.y
+            ? (nextBorder.x < nextBorder.z ? 0 : 2)
+            : (nextBorder.y < nextBorder.z ? 1 : 2);
+
+        distance = nextBorder[axis];
+        position[axis] += step[axis];
+        nextBorder[axis] += borderDistance[axis];
+        face = enteredFaces[axis][step[axis] > 0];
+    }
+
+    return std::nullopt;
+}
+
+Chunk* World::FindChunk(const glm::ivec2& chunkCoords) const
+{
+    auto it = _chunks.find(GetChunkKey(chunkCoords));
+    return it != _chunks.end() ? it->second.get() : nullptr;
+}
+
+void World::AddChunk(std::shared_ptr<Chunk> chunk)
+{
+    glm::ivec2 chunkCoords = chunk->GetPosition() / (int32_t)Chunk::WIDTH;
+    _chunks[GetChunkKey(chunkCoords)] = std::move(chunk);
+    _loadedChunkCount = _chunks.size();
+
+    // The borders of the neighbors' meshes looked into nothing so far.
+    for (int32_t x = -1; x <= 1; x++)
+    {
+        for (int32_t z = -1; z <= 1; z++)
+        {
+            Chunk* neighbor = FindChunk(chunkCoords + glm::ivec2(x, z));
+            if (neighbor && (x != 0 || z != 0))
+            {
+                neighbor->MarkChanged();
+            }
+        }
+    }
+
+    Timer timer;
+    _lightEngine.StitchChunk(chunkCoords);
+    _lastStitchTime = timer.GetElapsedMilliseconds();
+}
+
+void World::SetSaveDirectory(const std::string& directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        std::cerr << "[FILE] Could not create " << directory << std::endl;
+        return;
+    }
+
+    _saveDirectory = directory;
+}
+
+void World::Save()
+{
+    for (uint64_t key : _modifiedChunks)
+    {
+        SaveChunk(*_chunks.at(key));
+    }
+    _modifiedChunks.clear();
+}
+
+std::string World::GetChunkPath(const glm::ivec2& chunkCoords) const
+{
+    return _saveDirectory + "/" + std::to_string(chunkCoords.x) + "." + std::to_string(chunkCoords.y) + ".chunk";
+}
+
+void World::SaveChunk(const Chunk& chunk) const
+{
+    const std::string path = GetChunkPath(chunk.GetPosition() / (int32_t)Chunk::WIDTH);
+
+    std::vector<uint8_t> data = { 'K', 'R', 'C', 'H', ChunkCodec::VERSION };
+    ChunkCodec::Encode(chunk.GetBlocks(), data);
+
+    // Written next to it and moved over it once complete, so a crash or a
+    // full disk leaves the last save intact.
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file = std::ofstream(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), data.size());
+        file.close();
+        if (!file)
+        {
+            std::cerr << "[FILE] Could not write " << temporaryPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cerr << "[FILE] Could not write " << path << ": " << error.message() << std::endl;
+    }
+}
+
+void World::LoadSavedBlocks(Chunk& chunk) const
+{
+    if (_saveDirectory.empty())
+    {
+        return;
+    }
+
+    const std::string path = GetChunkPath(chunk.GetPosition() / (int32_t)Chunk::WIDTH);
+    std::ifstream file = std::ifstream(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return;
+    }
+
+    std::vector<uint8_t> data = std::vector<uint8_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    file.read((char*)data.data(), data.size());
+
+    std::vector<Block> blocks = std::vector<Block>(Chunk::VOLUME);
+    if (!file || data.size() < 5 || std::memcmp(data.data(), "KRCH", 4) != 0 || data[4] != ChunkCodec::VERSION ||
+        !ChunkCodec::Decode(data.data() + 5, data.size() - 5, blocks.data()))
+    {
+        std::cerr << "[FILE] Could not read " << path << std::endl;
+        return;
+    }
+
+    chunk.SetBlocks(blocks.data());
+}
+
+void World::MarkBorderChanged(const glm::ivec3& position)
+{
+    glm::ivec2 chunkCoords = GetChunkCoords(position);
+    glm::ivec2 coords = glm::ivec2(position.x, position.z) - chunkCoords * (int32_t)Chunk::WIDTH;
+
+    glm::ivec2 offset = glm::ivec2(
+        coords.x == 0 ? -1 : (coords.x == Chunk::WIDTH - 1 ? 1 : 0),
+        coords.y == 0 ? -1 : (coords.y == Chunk::WIDTH - 1 ? 1 : 0)
+    );
+
+    const glm::ivec2 neighbors[] = {
+        glm::ivec2(offset.x, 0), glm::ivec2(0, offset.y), offset
+    };
+    for (const glm::ivec2& neighbor : neighbors)
+    {
+        if (neighbor == glm::ivec2(0))
+        {
+            continue;
+        }
+
+        if (Chunk* chunk = FindChunk(chunkCoords + neighbor))
+        {
+            chunk->MarkChanged();
+        }
+    }
+}
+
+World::World()
+    : _viewDistance(16), _loadedChunkCount(0), _pendingChunkCount(0), _generatedChunkCount(0),
+    _lastRelightTime(0.0), _lastStitchTime(0.0), _lightEngine(*this)
+{
+}
+
+World::~World()
+{
+}
+
+} // namespace Krafter
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <span>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "block.h"
+#include "light_engine.h"
+
+namespace Krafter
+{
+
+struct RaycastHit
+{
+    glm::ivec3 position;
+    Block block;
+    // The face the ray entered the block through.
+    BlockFace face;
+    float distance;
+};
+
+class World
+{
+public:
+    // In chunks. Chunks stay loaded up to one past it.
+    static constexpr int32_t MAX_VIEW_DISTANCE = 32;
+
+    static void Init();
+    static void Deinit();
+    inline static World* Get() { return _instance; }
+
+    static glm::ivec2 GetChunkCoords(const glm::ivec3& position);
+    static uint64_t GetChunkKey(const glm::ivec2& chunkCoords);
+
+    // Generates the missing chunks within the view distance of the given
+    // positions in the background, nearest first, and unloads the ones that
+    // went out of all of them.
+    void Update(std::span<const glm::vec3> centers);
+    inline void Update(const glm::vec3& center) { Update(std::span<const glm::vec3>(&center, 1)); }
+    void RenderImGui();
+
+    // Generates, lights and adds a chunk right away, unlike Update().
+    void LoadChunk(const glm::ivec2& chunkCoords);
+
+    std::shared_ptr<const Chunk> GetChunk(const glm::ivec2& chunkCoords) const;
+    inline const std::unordered_map<uint64_t, std::shared_ptr<Chunk>>& GetChunks() const { return _chunks; }
+
+    // Positions are in world space. Blocks outside of the loaded chunks read
+    // as air and cannot be set.
+    Block GetBlock(const glm::ivec3& position) const;
+    bool SetBlock(const glm::ivec3& position, Block block);
+
+    // Unloaded chunks and everything below the world count as solid, so
+    // that nothing falls out of the loaded area.
+    bool IsSolid(const glm::ivec3& position) const;
+
+    // Walks the blocks along a ray, which must have a normalized direction,
+    // until it hits a solid one. Unloaded chunks are passed through. Does
+    // not allocate, so it is cheap enough for line of sight checks.
+    std::optional<RaycastHit> Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+    // Since the start, whether generated or read back from the save.
+    inline uint64_t GetGeneratedChunkCount() const { return _generatedChunkCount; }
+
+    inline int32_t GetViewDistance() const { return _viewDistance; }
+    inline void SetViewDistance(int32_t viewDistance) { _viewDistance = glm::min(viewDistance, MAX_VIEW_DISTANCE); }
+
+    // Once set, edited chunks are written to the directory when they unload
+    // or on Save(), and read back from it instead of being generated again.
+    // Has to be set before the first Update().
+    void SetSaveDirectory(const std::string& directory);
+    void Save();
+
+    // The simulation thread holds this exclusively while it ticks; anything
+    // else reading the chunks shares it.
+    inline std::shared_mutex& GetMutex() const { return _mutex; }
+
+private:
+    friend class LightEngine;
+
+    inline static World* _instance;
+
+    World();
+    ~World();
+
+    Chunk* FindChunk(const glm::ivec2& chunkCoords) const;
+    void AddChunk(std::shared_ptr<Chunk> chunk);
+
+    std::string GetChunkPath(const glm::ivec2& chunkCoords) const;
+    void SaveChunk(const Chunk& chunk) const;
+    // Replaces the generated blocks with the saved ones, if there are any.
+    void LoadSavedBlocks(Chunk& chunk) const;
+
+    // Marks the neighbors that see the given position along their border as
+    // changed, since their meshes sample it.
+    void MarkBorderChanged(const glm::ivec3& position);
+
+    mutable std::shared_mutex _mutex;
+
+    // Shown and changed from the render thread without holding the world.
+    std::atomic<int32_t> _viewDistance;
+    std::atomic<size_t> _loadedChunkCount;
+    std::atomic<size_t> _pendingChunkCount;
+    std::atomic<uint64_t> _generatedChunkCount;
+    std::atomic<double> _lastRelightTime;
+    std::atomic<double> _lastStitchTime;
+
+    LightEngine _lightEngine;
+
+    std::unordered_map<uint64_t, std::shared_ptr<Chunk>> _chunks;
+    std::unordered_set<uint64_t> _pendingChunks;
+
+    std::string _saveDirectory;
+    std::unordered_set<uint64_t> _modifiedChunks;
+
+    std::mutex _generatedChunksMutex;
+    std::vector<std::shared_ptr<Chunk>> _generatedChunks;
+};
+
+} // namespace Krafter
@@ -0,0 +1,21 @@
+#include "imgui.h"
+
+#include "world.h"
+
+namespace Krafter
+{
+
+// Kept apart from world.cpp, so the server builds the world without ImGui.
+void World::RenderImGui()
+{
+    ImGui::Text("World Details:");
+    int32_t viewDistance = _viewDistance;
+    if (ImGui::SliderInt("View Distance", &viewDistance, 2, MAX_VIEW_DISTANCE))
+    {
+        _viewDistance = viewDistance;
+    }
+    ImGui::Text("Chunks: %zu loaded, %zu pending", _loadedChunkCount.load(), _pendingChunkCount.load());
+    ImGui::Text("Last relight: %.3f ms, last stitch: %.3f ms", _lastRelightTime.load(), _lastStitchTime.load());
+}
+
+} // namespace Krafter